@@ -0,0 +1,82 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gc.h>
+#include <runtime.h>
+
+// Field-read throughput: walks a list of cons cells and reads both fields of
+// every cell through STELLA_OBJECT_READ_FIELD, so the cost of the read barrier
+// dominates the loop.
+//
+// Usage: bench_field_reads [list length] [rounds]
+
+#define DEFAULT_LIST_LENGTH 1000
+#define DEFAULT_ROUNDS 100000
+
+static const char *barriers_name(void) {
+  switch (STELLA_GC_BARRIERS) {
+  case GC_BARRIERS_NONE:
+    return "none";
+  case GC_BARRIERS_RANGE:
+    return "range";
+  default:
+    return "call";
+  }
+}
+
+static stella_object *build_list(int length) {
+  stella_object *list = &the_EMPTY;
+  stella_object *cell = NULL;
+  gc_push_root((void **)&list);
+  gc_push_root((void **)&cell);
+  for (int i = 0; i < length; i++) {
+    cell = alloc_stella_object(TAG_CONS, 2);
+    STELLA_OBJECT_INIT_FIELD(cell, 0, &the_ZERO);
+    STELLA_OBJECT_INIT_FIELD(cell, 1, list);
+    list = cell;
+  }
+  gc_pop_root((void **)&cell);
+  gc_pop_root((void **)&list);
+  return list;
+}
+
+static uint64_t clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  int length = argc > 1 ? atoi(argv[1]) : DEFAULT_LIST_LENGTH;
+  int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+  stella_object *list = build_list(length);
+  gc_push_root((void **)&list);
+
+  uint64_t n_zeros = 0;
+  uint64_t start_ns = clock_ns();
+  for (int round = 0; round < rounds; round++) {
+    stella_object *cell = list;
+    while (STELLA_OBJECT_HEADER_TAG(cell->object_header) == TAG_CONS) {
+      stella_object *head = STELLA_OBJECT_READ_FIELD(cell, 0);
+      n_zeros += head == &the_ZERO;
+      cell = STELLA_OBJECT_READ_FIELD(cell, 1);
+    }
+  }
+  uint64_t elapsed_ns = clock_ns() - start_ns;
+
+  uint64_t n_reads = 2 * (uint64_t)length * (uint64_t)rounds;
+  if (n_zeros != (uint64_t)length * (uint64_t)rounds) {
+    printf("Unexpected list contents\n");
+    return 1;
+  }
+  printf("Barriers:    %s\n", barriers_name());
+  printf("Field reads: %llu\n", (unsigned long long)n_reads);
+  printf("Time:        %.3f ms\n", (double)elapsed_ns / 1e6);
+  printf("Throughput:  %.1f M reads/s (%.2f ns per read)\n",
+         (double)n_reads * 1e3 / (double)elapsed_ns,
+         (double)elapsed_ns / (double)n_reads);
+  gc_pop_root((void **)&list);
+  return 0;
+}
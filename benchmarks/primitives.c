@@ -0,0 +1,341 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gc.h>
+#include <runtime.h>
+
+#include "gc/parameters.h"
+
+// Costs of single GC primitives: allocation of each object size, a root push
+// and pop, a field read and write, a minor collection as a function of the
+// number of survivors and a major collection per byte copied. Every
+// benchmark is run for a few untimed warmup repetitions, then timed over the
+// given number of repetitions, each of which measures one batch of the
+// operation. The summary gives the time per operation over the repetitions.
+//
+// Built as bench_primitives (stella_gc) and bench_primitives_epsilon
+// (stella_epsilon_gc, the baseline which never collects). Collections need a
+// heap of some megabytes (e.g. -DMAX_ALLOC_SIZE=268435456): sizes which do not
+// fit are skipped.
+//
+// Usage: bench_primitives [repetitions] [JSON output file, - for stdout]
+
+#define DEFAULT_REPETITIONS 30
+#define WARMUP_REPETITIONS 5
+#define BATCH_SIZE 10000
+#define LIST_LENGTH 1000
+
+#ifdef BENCH_EPSILON_GC
+#define LIBRARY_NAME "stella_epsilon_gc"
+#else
+#define LIBRARY_NAME "stella_gc"
+#endif
+
+#define CELL_SIZE STELLA_OBJECT_SIZE(2)
+
+struct summary {
+  const char *name;
+  // Parameter of the benchmark (object fields, survivors, live bytes), or -1
+  long parameter;
+  const char *unit;
+  double min;
+  double median;
+  double mean;
+  double stddev;
+  double max;
+};
+
+static struct summary summaries[64];
+static int n_summaries = 0;
+
+static uint64_t clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static const char *barriers_name(void) {
+  switch (STELLA_GC_BARRIERS) {
+  case GC_BARRIERS_NONE:
+    return "none";
+  case GC_BARRIERS_RANGE:
+    return "range";
+  default:
+    return "call";
+  }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Sorts the samples in place
+static void summarize(const char *name, long parameter, const char *unit,
+                      double *samples, int n_samples) {
+  struct summary *s = &summaries[n_summaries++];
+  qsort(samples, n_samples, sizeof(double), compare_doubles);
+  double sum = 0;
+  for (int i = 0; i < n_samples; i++) {
+    sum += samples[i];
+  }
+  double mean = sum / n_samples;
+  double squares = 0;
+  for (int i = 0; i < n_samples; i++) {
+    squares += (samples[i] - mean) * (samples[i] - mean);
+  }
+  s->name = name;
+  s->parameter = parameter;
+  s->unit = unit;
+  s->min = samples[0];
+  s->max = samples[n_samples - 1];
+  s->median = n_samples % 2 == 1 ? samples[n_samples / 2]
+                                 : (samples[n_samples / 2 - 1] +
+                                    samples[n_samples / 2]) /
+                                       2;
+  s->mean = mean;
+  s->stddev = n_samples > 1 ? sqrt(squares / (n_samples - 1)) : 0;
+}
+
+static stella_object *build_list(int length) {
+  stella_object *list = &the_EMPTY;
+  stella_object *cell = NULL;
+  gc_push_root((void **)&list);
+  gc_push_root((void **)&cell);
+  for (int i = 0; i < length; i++) {
+    cell = alloc_stella_object(TAG_CONS, 2);
+    STELLA_OBJECT_INIT_FIELD(cell, 0, &the_ZERO);
+    STELLA_OBJECT_INIT_FIELD(cell, 1, list);
+    list = cell;
+  }
+  gc_pop_root((void **)&cell);
+  gc_pop_root((void **)&list);
+  return list;
+}
+
+// Nanoseconds per gc_alloc of an object with the given number of fields,
+// including the initialization of the object and the collections on the way
+static double alloc_batch(int fields_count) {
+  size_t size = STELLA_OBJECT_SIZE(fields_count);
+  uint64_t start_ns = clock_ns();
+  for (int i = 0; i < BATCH_SIZE; i++) {
+    stella_object *obj = gc_alloc(size);
+    obj->object_header = TAG_TUPLE | fields_count << 4;
+    for (int j = 0; j < fields_count; j++) {
+      STELLA_OBJECT_INIT_FIELD(obj, j, &the_ZERO);
+    }
+  }
+  return (double)(clock_ns() - start_ns) / BATCH_SIZE;
+}
+
+static double push_pop_batch(void) {
+  void *var = NULL;
+  uint64_t start_ns = clock_ns();
+  for (int i = 0; i < BATCH_SIZE; i++) {
+    gc_push_root(&var);
+    gc_pop_root(&var);
+  }
+  return (double)(clock_ns() - start_ns) / BATCH_SIZE;
+}
+
+static double read_batch(stella_object *list) {
+  uint64_t n_zeros = 0;
+  uint64_t start_ns = clock_ns();
+  stella_object *cell = list;
+  while (STELLA_OBJECT_HEADER_TAG(cell->object_header) == TAG_CONS) {
+    stella_object *head = STELLA_OBJECT_READ_FIELD(cell, 0);
+    n_zeros += head == &the_ZERO;
+    cell = STELLA_OBJECT_READ_FIELD(cell, 1);
+  }
+  uint64_t elapsed_ns = clock_ns() - start_ns;
+  if (n_zeros != LIST_LENGTH) {
+    printf("Unexpected list contents\n");
+    exit(1);
+  }
+  return (double)elapsed_ns / (2 * LIST_LENGTH);
+}
+
+static double write_batch(stella_object *list) {
+  uint64_t start_ns = clock_ns();
+  for (stella_object *cell = list;
+       STELLA_OBJECT_HEADER_TAG(cell->object_header) == TAG_CONS;
+       cell = (stella_object *)gc_ref_decode(cell->object_fields[1])) {
+    STELLA_OBJECT_WRITE_FIELD(cell, 0, &the_ZERO);
+  }
+  return (double)(clock_ns() - start_ns) / LIST_LENGTH;
+}
+
+// Nanoseconds of a minor collection whose survivors are a list of the given
+// length, allocated right after a major collection so that all of it is
+// in the nursery and the older generations are empty
+static double minor_gc_once(int survivors) {
+  gc_collect(1);
+  stella_object *list = build_list(survivors);
+  gc_push_root((void **)&list);
+  uint64_t start_ns = clock_ns();
+  gc_collect(0);
+  uint64_t elapsed_ns = clock_ns() - start_ns;
+  gc_pop_root((void **)&list);
+  return (double)elapsed_ns;
+}
+
+typedef double (*batch_function)(long parameter, stella_object *list);
+
+static double run_alloc(long parameter, stella_object *list) {
+  (void)list;
+  return alloc_batch((int)parameter);
+}
+
+static double run_push_pop(long parameter, stella_object *list) {
+  (void)parameter;
+  (void)list;
+  return push_pop_batch();
+}
+
+static double run_read(long parameter, stella_object *list) {
+  (void)parameter;
+  return read_batch(list);
+}
+
+static double run_write(long parameter, stella_object *list) {
+  (void)parameter;
+  return write_batch(list);
+}
+
+static double run_minor_gc(long parameter, stella_object *list) {
+  (void)list;
+  return minor_gc_once((int)parameter);
+}
+
+// Nanoseconds per byte of the live list copied by a major collection
+static double run_major_gc(long parameter, stella_object *list) {
+  (void)list;
+  uint64_t start_ns = clock_ns();
+  gc_collect(1);
+  return (double)(clock_ns() - start_ns) / (double)parameter;
+}
+
+static void bench(const char *name, long parameter, const char *unit,
+                  batch_function batch, stella_object *list,
+                  int repetitions) {
+  double *samples = malloc(repetitions * sizeof(double));
+  for (int i = 0; i < WARMUP_REPETITIONS; i++) {
+    batch(parameter, list);
+  }
+  for (int i = 0; i < repetitions; i++) {
+    samples[i] = batch(parameter, list);
+  }
+  summarize(name, parameter, unit, samples, repetitions);
+  free(samples);
+}
+
+static void print_table(void) {
+  printf("Library:  %s\n", LIBRARY_NAME);
+  printf("Barriers: %s\n", barriers_name());
+  printf("%-14s %10s %-14s %12s %12s %12s %12s %12s\n", "Benchmark",
+         "Parameter", "Unit", "Min", "Median", "Mean", "Stddev", "Max");
+  for (int i = 0; i < n_summaries; i++) {
+    struct summary *s = &summaries[i];
+    printf("%-14s %10ld %-14s %12.3f %12.3f %12.3f %12.3f %12.3f\n", s->name,
+           s->parameter, s->unit, s->min, s->median, s->mean, s->stddev,
+           s->max);
+  }
+}
+
+static void write_json(FILE *out, int repetitions) {
+  const char *collector = getenv("STELLA_GC");
+  fprintf(out, "{\n");
+  fprintf(out, "  \"library\": \"%s\",\n", LIBRARY_NAME);
+  fprintf(out, "  \"collector\": \"%s\",\n",
+          collector != NULL ? collector : "");
+  fprintf(out, "  \"barriers\": \"%s\",\n", barriers_name());
+  fprintf(out, "  \"max_alloc_size\": %zu,\n", (size_t)MAX_ALLOC_SIZE);
+  fprintf(out, "  \"warmup_repetitions\": %d,\n", WARMUP_REPETITIONS);
+  fprintf(out, "  \"repetitions\": %d,\n", repetitions);
+  fprintf(out, "  \"benchmarks\": [\n");
+  for (int i = 0; i < n_summaries; i++) {
+    struct summary *s = &summaries[i];
+    fprintf(out,
+            "    {\"name\": \"%s\", \"parameter\": %ld, \"unit\": \"%s\", "
+            "\"min\": %.4f, \"median\": %.4f, \"mean\": %.4f, "
+            "\"stddev\": %.4f, \"max\": %.4f}%s\n",
+            s->name, s->parameter, s->unit, s->min, s->median, s->mean,
+            s->stddev, s->max, i + 1 < n_summaries ? "," : "");
+  }
+  fprintf(out, "  ]\n");
+  fprintf(out, "}\n");
+}
+
+int main(int argc, char **argv) {
+  int repetitions = argc > 1 ? atoi(argv[1]) : DEFAULT_REPETITIONS;
+  const char *json_path = argc > 2 ? argv[2] : NULL;
+  if (repetitions < 1) {
+    printf("The number of repetitions must be positive\n");
+    return 1;
+  }
+
+  static const int fields_counts[] = {0, 1, 2, 4, 8};
+  for (size_t i = 0; i < sizeof(fields_counts) / sizeof(int); i++) {
+    bench("alloc", fields_counts[i], "ns/alloc", run_alloc, NULL,
+          repetitions);
+  }
+  bench("push_pop_root", -1, "ns/pair", run_push_pop, NULL, repetitions);
+
+  // The list takes at most half of the nursery, like the survivors below
+  stella_object *list = NULL;
+  if (LIST_LENGTH * CELL_SIZE <= GEN0_SPACE_SIZE / 2) {
+    list = build_list(LIST_LENGTH);
+    gc_push_root((void **)&list);
+    bench("read_field", -1, "ns/read", run_read, list, repetitions);
+    bench("write_field", -1, "ns/write", run_write, list, repetitions);
+    gc_pop_root((void **)&list);
+  }
+
+  // Survivors take at most half of the nursery
+  static const long survivor_counts[] = {0, 100, 1000, 10000, 100000};
+  for (size_t i = 0; i < sizeof(survivor_counts) / sizeof(long); i++) {
+    if (survivor_counts[i] * CELL_SIZE <= GEN0_SPACE_SIZE / 2) {
+      bench("minor_gc", survivor_counts[i], "ns/collection", run_minor_gc,
+            NULL, repetitions);
+    }
+  }
+
+  // The live list takes at most a quarter of a semispace. It is copied once
+  // before the warmup, so that every timed collection copies all of it.
+  static const long live_sizes[] = {1 << 16, 1 << 20, 1 << 24};
+  for (size_t i = 0; i < sizeof(live_sizes) / sizeof(long); i++) {
+    if (live_sizes[i] > (long)(GEN1_SPACE_SIZE / 4)) {
+      continue;
+    }
+    int length = (int)(live_sizes[i] / CELL_SIZE);
+    gc_collect(1);
+    list = build_list(length);
+    gc_push_root((void **)&list);
+    gc_collect(1);
+    bench("major_gc", (long)length * CELL_SIZE, "ns/byte", run_major_gc, NULL,
+          repetitions);
+    gc_pop_root((void **)&list);
+  }
+
+  // JSON on stdout replaces the table
+  if (json_path == NULL || strcmp(json_path, "-") != 0) {
+    print_table();
+  }
+  if (json_path != NULL) {
+    FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (out == NULL) {
+      printf("Could not open %s\n", json_path);
+      return 1;
+    }
+    write_json(out, repetitions);
+    if (out != stdout) {
+      fclose(out);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gc/heap.h"
+
+// Operations of a collector. The public API in gc.c dispatches to the
+// collector selected at startup (see STELLA_GC environment variable).
+struct gc_collector {
+  const char *name;
+  void (*initialize)(void);
+  void *(*alloc)(size_t size_in_bytes);
+  size_t (*alloc_many)(size_t object_size, size_t count, void **block);
+  void (*read_barrier)(void *object, int field_index);
+  void (*write_barrier)(void *object, int field_index, void *contents);
+  void (*push_root)(void **root);
+  void (*pop_root)(void **root);
+  void (*collect)(int generation);
+  int (*idle_hint)(uint64_t budget_ns);
+  void (*print_stats)(void);
+  void (*print_state)(void);
+  // Frees all memory of the collector in the current heap
+  void (*destroy)(void);
+};
+
+// Two generations: Gen0 nursery + Gen1 semispaces (default)
+extern const struct gc_collector generational_collector;
+// Gen1 semispaces only, objects are allocated directly in from-space
+extern const struct gc_collector semispace_collector;
+// Bump allocation without collection
+extern const struct gc_collector epsilon_collector;
+
+// Collector of the current heap
+#define gc_current_collector (gc_current_heap->collector)
+
+// Selects the collector of the current heap by name from the STELLA_GC
+// environment variable
+void gc_select_collector(void);
+
+// If the collector is fixed at build time (STELLA_GC_FIXED_COLLECTOR=name),
+// operations are called directly as <name>_<op> instead of through the table.
+#ifdef STELLA_GC_FIXED_COLLECTOR
+#define GC_CONCAT_(prefix, op) prefix##_##op
+#define GC_CONCAT(prefix, op) GC_CONCAT_(prefix, op)
+#define GC_DISPATCH(op) GC_CONCAT(STELLA_GC_FIXED_COLLECTOR, op)
+#define GC_DEFAULT_COLLECTOR (&GC_CONCAT(STELLA_GC_FIXED_COLLECTOR, collector))
+#else
+#define GC_DISPATCH(op) (gc_current_collector->op)
+#define GC_DEFAULT_COLLECTOR (&generational_collector)
+#endif
+
+// Operations of each collector, to be called directly by GC_DISPATCH
+#define GC_DECLARE_COLLECTOR_OPS(prefix)                                       \
+  void prefix##_initialize(void);                                              \
+  void *prefix##_alloc(size_t size_in_bytes);                                  \
+  size_t prefix##_alloc_many(size_t object_size, size_t count, void **block);  \
+  void prefix##_read_barrier(void *object, int field_index);                   \
+  void prefix##_write_barrier(void *object, int field_index, void *contents);  \
+  void prefix##_push_root(void **root);                                        \
+  void prefix##_pop_root(void **root);                                         \
+  void prefix##_collect(int generation);                                       \
+  int prefix##_idle_hint(uint64_t budget_ns);                                  \
+  void prefix##_print_stats(void);                                             \
+  void prefix##_print_state(void);                                             \
+  void prefix##_destroy(void)
+
+GC_DECLARE_COLLECTOR_OPS(generational);
+GC_DECLARE_COLLECTOR_OPS(semispace);
+GC_DECLARE_COLLECTOR_OPS(epsilon);
+
+#define GC_DEFINE_COLLECTOR(prefix)                                            \
+  const struct gc_collector prefix##_collector = {                             \
+      .name = #prefix,                                                         \
+      .initialize = prefix##_initialize,                                       \
+      .alloc = prefix##_alloc,                                                 \
+      .alloc_many = prefix##_alloc_many,                                       \
+      .read_barrier = prefix##_read_barrier,                                   \
+      .write_barrier = prefix##_write_barrier,                                 \
+      .push_root = prefix##_push_root,                                         \
+      .pop_root = prefix##_pop_root,                                           \
+      .collect = prefix##_collect,                                             \
+      .idle_hint = prefix##_idle_hint,                                         \
+      .print_stats = prefix##_print_stats,                                     \
+      .print_state = prefix##_print_state,                                     \
+      .destroy = prefix##_destroy,                                             \
+  }
+
+#endif // COLLECTOR_H
@@ -0,0 +1,31 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <stella/runtime.h>
+
+#include "gc/heap.h"
+
+// Deduplication (enabled by the STELLA_GC_DEDUP environment variable) runs
+// after the Cheney scan of a Gen1 collection. Immutable objects of to-space
+// (all but TAG_REF) are hashed bottom-up by their header and the canonical
+// copies of their fields, and each duplicate becomes a forward pointer to the
+// first copy. The space taken by duplicates is reclaimed by the next Gen1
+// collection.
+#define dedup_enabled (gc_current_heap->dedup.enabled)
+
+void dedup_initialize(void);
+
+// Deduplicates the objects of [start, end), whose fields are all forwarded,
+// and redirects the fields of the space to canonical copies
+void dedup_space(uint8_t *start, uint8_t *end);
+
+// The canonical copy of obj after dedup_space, for references from outside of
+// the space
+stella_object *dedup_canonical(stella_object *obj);
+
+void print_dedup_stats(void);
+
+#endif // DEDUP_H
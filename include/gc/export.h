@@ -0,0 +1,40 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "gc/stats.h"
+
+// Export of the statistics outside of stdout, configured by environment
+// variables at the first initialization of a heap:
+//
+// - STELLA_GC_EXPORT: a file path, or fd:<n> for an open file descriptor.
+//   A JSON object per line is written on SIGUSR1 and at exit.
+// - STELLA_GC_EXPORT_PAGE: a file path (e.g. under /dev/shm). The file is
+//   mapped as a struct gc_export_page, refreshed after every collection and
+//   on SIGUSR1, so that other processes can poll it without system calls.
+//
+// With several heaps the statistics are those of the heap that is current in
+// the thread which collects or receives the signal.
+
+#define GC_EXPORT_PAGE_MAGIC 0x53544c47u // "STLG"
+#define GC_EXPORT_PAGE_VERSION 5u
+
+// Readers retry while the sequence number is odd or has changed during the
+// read
+struct gc_export_page {
+  uint32_t magic;
+  uint32_t version;
+  _Atomic uint64_t sequence;
+  // Number of updates of the page
+  uint64_t n_updates;
+  struct gc_stats_snapshot stats;
+};
+
+void export_initialize(void);
+
+// Refreshes the page after a collection of the current heap
+void export_record_collection(void);
+
+#endif // EXPORT_H
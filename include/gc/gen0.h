@@ -2,17 +2,40 @@
 #define GEN0_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-extern bool gen0_gc_initialized;
+#include "gc/heap.h"
 
-extern uint8_t *gen0_space;
+#define gen0_gc_initialized (gc_current_heap->gen0.initialized)
 
-extern uint8_t *gen0_alloc_ptr;
-extern uint8_t *gen0_scan_ptr;
+#define gen0_space (gc_current_heap->gen0.space)
+#define gen0_space_size (gc_current_heap->gen0.space_size)
+
+// With the Appel layout (STELLA_GC_APPEL_NURSERY) Gen0 has no space of its
+// own. The nursery is the part of the idle Gen1 to-space that a Gen0
+// collection can always promote into the free part of from-space, so it
+// grows and shrinks with Gen1, and Gen0 collections never need a nested Gen1
+// collection. Major collections empty the nursery before Gen1 is copied.
+#define gen0_in_tospace (gc_current_heap->gen0.in_tospace)
+
+#define gen0_alloc_ptr (gc_current_heap->gen0.alloc_ptr)
+#define gen0_alloc_limit (gc_current_heap->gen0.alloc_limit)
+#define gen0_scan_ptr (gc_current_heap->gen0.scan_ptr)
 
 void gen0_initialize(void);
 
+void gen0_destroy(void);
+
 void *gen0_alloc(size_t size_in_bytes);
 
+// Allocates up to count objects as one block, collecting at most once.
+// Returns the number of allocated objects, at least one.
+size_t gen0_alloc_many(size_t object_size, size_t count, void **block);
+
+void gen0_collect(void);
+
+// Places the nursery into to-space with the Appel layout, after a collection
+void gen0_place_nursery(void);
+
 #endif // GEN0_H
@@ -2,19 +2,37 @@
 #define GEN1_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-extern bool gen1_gc_initialized;
+#include "gc/heap.h"
 
-extern uint8_t *gen1_fromspace;
-extern uint8_t *gen1_tospace;
+#define gen1_gc_initialized (gc_current_heap->gen1.initialized)
 
-extern uint8_t *gen1_alloc_ptr;
-extern uint8_t *gen1_next_ptr;
-extern uint8_t *gen1_scan_ptr;
+#define gen1_region (gc_current_heap->gen1.region)
+#define gen1_fromspace (gc_current_heap->gen1.fromspace)
+#define gen1_tospace (gc_current_heap->gen1.tospace)
+
+#define gen1_alloc_ptr (gc_current_heap->gen1.alloc_ptr)
+#define gen1_next_ptr (gc_current_heap->gen1.next_ptr)
+#define gen1_scan_ptr (gc_current_heap->gen1.scan_ptr)
+#define gen1_alloc_limit (gc_current_heap->gen1.alloc_limit)
+#define gen1_next_limit (gc_current_heap->gen1.next_limit)
+#define gen1_residency_bytes (gc_current_heap->gen1.residency_bytes)
 
 void gen1_initialize(void);
 
+void gen1_destroy(void);
+
 void *gen1_alloc(size_t size_in_bytes);
 
+// Allocates up to count objects as one block, collecting at most once.
+// Returns the number of allocated objects, at least one.
+size_t gen1_alloc_many(size_t object_size, size_t count, void **block);
+
+void gen1_collect(void);
+
+// Collects Gen0 and Gen1 in a single pass, evacuating both into Gen1
+void gen1_collect_full(void);
+
 #endif // GEN1_H
@@ -0,0 +1,114 @@
+#ifndef GEN2_H
+#define GEN2_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <stella/runtime.h>
+
+#include "gc/heap.h"
+#include "gc/parameters.h"
+
+// Gen2 (enabled by the STELLA_GC_TENURE_AGE environment variable) holds the
+// objects which survived that many Gen1 collections: instead of being copied
+// into to-space once more they are tenured, and never moved again. Gen2 is
+// collected by mark-sweep together with a full-heap collection, once the
+// objects tenured since the last one take half of the space that was free
+// then, or when tenuring fails for lack of space. Dead objects are turned
+// into fillers, which later tenured objects reuse through free lists per size.
+//
+// Gen2 is collected only together with the younger generations, so it needs
+// no roots from them. Its objects pointing to younger generations are roots of
+// their collections: with a write barrier (STELLA_GC_BARRIERS=range or call)
+// they are kept in a remembered set, otherwise the whole of Gen2 is scanned.
+//
+// With a write barrier and STELLA_GC_CONCURRENT_MARK=1, Gen2 collections
+// started by the trigger mark concurrently. The full-heap collection which
+// starts a cycle only marks the Gen2 objects referenced by the roots and the
+// younger generations, and a marker thread marks the rest while the program
+// runs. The write barrier logs the Gen2 objects whose pointers are overwritten
+// meanwhile, so that everything reachable when the cycle started is marked
+// (snapshot at the beginning); objects tenured during the cycle are marked
+// when they are. The collection after the marker thread is done marks from
+// the log and sweeps. Collections requested explicitly or because Gen2 is
+// full mark in the pause.
+
+#define gen2_enabled (gc_current_heap->gen2.enabled)
+#define gen2_tenure_age (gc_current_heap->gen2.tenure_age)
+#define gen2_space (gc_current_heap->gen2.space)
+#define gen2_top (gc_current_heap->gen2.top)
+#define gen2_marking (gc_current_heap->gen2.marking)
+#define gen2_marking_concurrently (gc_current_heap->gen2.marking_concurrently)
+
+// Header bits above the pin bit: the number of Gen1 collections survived
+// (Gen1 objects), the mark of a Gen2 collection and membership in the
+// remembered set (Gen2 objects)
+#define GEN2_AGE_SHIFT 11
+#define GEN2_AGE_MASK (0xF << GEN2_AGE_SHIFT)
+#define GEN2_MAX_TENURE_AGE 15
+#define GEN2_MARK_BIT (1 << 15)
+#define GEN2_REMEMBERED_BIT (1 << 16)
+
+static inline bool points_to_gen2(void *ptr) {
+  return (uintptr_t)ptr - (uintptr_t)gen2_space < GEN2_SPACE_SIZE;
+}
+
+static inline int gen2_age(stella_object *obj) {
+  return (obj->object_header & GEN2_AGE_MASK) >> GEN2_AGE_SHIFT;
+}
+
+static inline void gen2_set_age(stella_object *obj, int age) {
+  obj->object_header =
+      (obj->object_header & ~GEN2_AGE_MASK) | age << GEN2_AGE_SHIFT;
+}
+
+// Takes the last slot of the region of Gen1
+void gen2_initialize(void);
+
+void gen2_destroy(void);
+
+// Moves an object of from-space into Gen2 and queues it for forwarding of its
+// fields. Returns NULL if there is no room (and requests a Gen2 collection).
+stella_object *gen2_tenure(stella_object *obj);
+
+// Whether a full-heap collection starting now should collect Gen2 as well
+bool gen2_collection_due(void);
+
+void gen2_request_collection(void);
+
+// Marking by a full-heap collection. The Gen2 objects it reaches must be
+// passed to gen2_mark, and the queue scanned with a forward_fields which
+// marks as well. gen2_end_marking sweeps the unmarked objects, or starts the
+// marker thread if gen2_marking_concurrently (then Gen2 objects are still
+// roots of the collection).
+void gen2_begin_marking(void);
+
+void gen2_mark(stella_object *obj);
+
+void gen2_end_marking(void);
+
+// Finishes a concurrent cycle if its marker thread is done, or waits for it if
+// a Gen2 collection is requested. Called before every collection.
+void gen2_poll_marking(void);
+
+// Calls forward_fields on the queued objects until the queue is empty.
+// Returns false if it was empty already.
+bool gen2_scan_queue(void (*forward_fields)(stella_object *obj));
+
+// Calls forward_fields on every Gen2 object which may point to a younger
+// generation
+void gen2_for_each_root(void (*forward_fields)(stella_object *obj));
+
+// Forgets the remembered objects which no longer point to younger
+// generations. Called at the end of every collection.
+void gen2_prune_remembered(void);
+
+// Write barrier, called before the field is overwritten: remembers obj if it
+// is in Gen2 and contents is younger, and logs the overwritten Gen2 object
+// during a concurrent cycle
+void gen2_record_write(void *obj, int field_index, void *contents);
+
+void print_gen2_stats(void);
+
+#endif // GEN2_H
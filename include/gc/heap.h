@@ -0,0 +1,326 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <stella/gc.h>
+#include <stella/runtime.h>
+
+#include "gc/kernels.h"
+#include "gc/parameters.h"
+
+struct gc_collector;
+
+struct gen0_state {
+  bool initialized;
+  // Appel layout: the nursery is a part of Gen1 to-space
+  bool in_tospace;
+  uint8_t *space;
+  // GEN0_SPACE_SIZE, or the current size of a nursery in to-space
+  size_t space_size;
+  uint8_t *alloc_ptr;
+  // Start of the first pinned object at or after alloc_ptr, or the end of the
+  // space
+  uint8_t *alloc_limit;
+  uint8_t *scan_ptr;
+  // Bytes moved to Gen1 by the current collection
+  size_t promoted_bytes;
+  // Time spent scanning Gen1 for roots by the current collection
+  uint64_t remembered_set_ns;
+};
+
+struct gen1_state {
+  bool initialized;
+  // GC_REGION_SIZE bytes holding the semispaces and Gen0
+  uint8_t *region;
+  uint8_t *fromspace;
+  uint8_t *tospace;
+  uint8_t *alloc_ptr;
+  uint8_t *next_ptr;
+  uint8_t *scan_ptr;
+  // Start of the first pinned object at or after alloc_ptr (in from-space)
+  // and next_ptr (in to-space), or the end of the space
+  uint8_t *alloc_limit;
+  uint8_t *next_limit;
+  // During a full-heap collection Gen0 is evacuated together with from-space
+  bool full_collection;
+  // Range evacuated by the current collection: from-space, and Gen0 next to
+  // it in a full-heap collection
+  uint8_t *evacuated_start;
+  size_t evacuated_size;
+  // Bytes moved to to-space by the current collection
+  size_t copied_bytes;
+  // Bytes in from-space at the end of the last collection. Anything above was
+  // promoted or allocated since.
+  size_t residency_bytes;
+};
+
+struct gen2_state {
+  bool enabled;
+  // Gen1 collections an object survives before it is tenured
+  int tenure_age;
+  uint8_t *space;
+  // The space is covered by the range of the write barrier (with
+  // STELLA_GC_BARRIERS=range)
+  bool in_barrier_range;
+  // End of the objects and free cells, bump allocation continues there
+  uint8_t *top;
+  // Free cells (fillers linked through their first field) by fields count
+  stella_object *free_lists[GC_MAX_FIELDS_COUNT + 1];
+  // Objects whose fields are to be forwarded by the current collection
+  stella_object **queue;
+  size_t queue_size;
+  size_t queue_capacity;
+  // Objects which may point to younger generations (with a write barrier)
+  stella_object **remembered;
+  size_t n_remembered;
+  size_t remembered_capacity;
+  // A full-heap collection is marking Gen2
+  bool marking;
+  bool collection_requested;
+  // Bytes of live objects after the last Gen2 collection and of objects
+  // tenured since then, and the value which starts the next collection
+  size_t used_bytes;
+  size_t trigger_bytes;
+  uint64_t tenured_bytes;
+  uint64_t tenured_objects;
+  uint64_t n_collects;
+  uint64_t freed_bytes;
+  size_t max_n_remembered;
+  // Concurrent marking: from the pause which starts a cycle to the one which
+  // finishes it, marks are kept in a bitmap (a bit per GC_REF_ALIGNMENT bytes)
+  // and set by the marker thread
+  bool concurrent;
+  bool marking_concurrently;
+  _Atomic uint64_t *mark_bitmap;
+  // Marked objects whose fields are still to be marked, owned by the marker
+  // thread while it runs
+  stella_object **grey;
+  size_t grey_size;
+  size_t grey_capacity;
+  // Objects whose pointers the write barrier has overwritten during a cycle
+  atomic_flag satb_lock;
+  stella_object **satb_log;
+  size_t satb_log_size;
+  size_t satb_log_capacity;
+  pthread_t marker;
+  atomic_bool marker_done;
+  atomic_bool marker_abort;
+  uint64_t n_concurrent_cycles;
+  uint64_t n_logged;
+  uint64_t max_final_pause_ns;
+};
+
+// A segment of the stack of local roots. Segments are linked both ways, and
+// one emptied segment is kept above the top, so that a stack moving back and
+// forth across a segment boundary does not allocate and free every time.
+struct var_roots_segment {
+  struct var_roots_segment *prev;
+  struct var_roots_segment *next;
+  void **roots[VAR_ROOTS_SEGMENT_SIZE];
+};
+
+struct roots_state {
+  // Number of local roots
+  int var_next_index;
+  // Segment holding the top of the stack and the number of roots in it. Only
+  // the first segment can be empty.
+  struct var_roots_segment *var_top;
+  int var_top_index;
+  struct var_roots_segment var_first;
+  int gen0_to_gen1_next_index;
+  // Remembered fields
+  gc_ref *gen0_to_gen1[MAX_ROOTS_FROM_GEN0_TO_GEN1];
+  int gen1_to_gen0_next_index;
+  gc_ref *gen1_to_gen0[MAX_ROOTS_FROM_GEN0_TO_GEN1];
+};
+
+struct stats_state {
+  size_t allocated_bytes;
+  uint64_t allocated_objects;
+  uint64_t max_n_roots;
+  uint64_t max_gen0_allocated_memory;
+  uint64_t max_gen1_allocated_memory;
+  uint64_t max_allocated_memory;
+  uint64_t gen0_n_collects;
+  uint64_t gen1_n_collects;
+  uint64_t full_n_collects;
+  uint64_t nested_n_collects;
+  // Bytes of objects copied by collections
+  uint64_t copied_bytes;
+};
+
+struct nursery_state {
+  bool is_adaptive;
+  size_t limit_size;
+  uint64_t pause_target_ns;
+  double fixed_ns_ewma;
+  double ns_per_survived_byte_ewma;
+  double survival_rate_ewma;
+  uint64_t n_collects;
+  uint64_t max_pause_ns;
+  uint64_t total_pause_ns;
+  uint64_t n_pauses_over_target;
+  size_t min_limit_size;
+  size_t max_limit_size;
+};
+
+struct scheduler_state {
+  double promotion_rate_ewma;
+  // Measured cost of collections per byte in use when they start (0 until the
+  // first one of the kind)
+  double minor_ns_per_byte_ewma;
+  double major_ns_per_byte_ewma;
+  uint64_t idle_n_collects;
+};
+
+struct lifetime_histogram;
+
+struct lifetime_state {
+  bool initialized;
+  // Bytes allocated by the program, the clock for lifetimes
+  uint64_t clock;
+  // Forced collections (0 if disabled)
+  uint64_t interval;
+  uint64_t next_forced_collection;
+  uint64_t n_forced_collections;
+  // Birth stamps (clock + 1, or 0 if there is no object) per word of the
+  // region of the heap
+  uint64_t *region_births;
+  struct lifetime_histogram *histogram;
+};
+
+struct epsilon_chunk;
+
+struct epsilon_state {
+  uint8_t *alloc_ptr;
+  uint8_t *limit_ptr;
+  struct epsilon_chunk *chunks;
+  size_t allocated_bytes;
+  uint64_t allocated_objects;
+  uint64_t n_chunks;
+};
+
+struct dedup_state {
+  bool enabled;
+  // Space of the current deduplication pass
+  uint8_t *space_start;
+  uint8_t *space_end;
+  uint64_t n_objects;
+  uint64_t n_bytes;
+  uint64_t total_ns;
+};
+
+struct pinned_object {
+  stella_object *obj;
+  // Number of gc_pin calls not matched by gc_unpin yet
+  uint64_t count;
+};
+
+struct pin_state {
+  struct pinned_object *objects;
+  size_t n_objects;
+  size_t capacity;
+  uint64_t n_pins;
+  uint64_t max_n_objects;
+  // Bytes turned into fillers by allocation skipping pinned objects
+  uint64_t filled_bytes;
+  // Objects released by the current Gen0 collection, which may lie past
+  // the Gen0 allocation pointer
+  stella_object **released;
+  size_t n_released;
+  size_t released_capacity;
+};
+
+struct trace_state {
+  bool initialized;
+  // TRACE_MODE_* of trace.c
+  int mode;
+  uint64_t next_id;
+  // Ids (0 if there is no object) per word of the region of the heap
+  uint64_t *region_ids;
+  // Recording
+  FILE *output;
+  uint64_t n_events;
+  // Ids of the local roots as last recorded
+  uint64_t *root_ids;
+  size_t root_ids_capacity;
+  size_t n_recorded_roots;
+  // Objects of the last allocation, recorded at the next one
+  uint8_t *pending_block;
+  size_t pending_object_size;
+  size_t pending_count;
+  // Replaying: current location of every object by id
+  stella_object **objects;
+  size_t objects_capacity;
+};
+
+struct profile_sample {
+  stella_object *obj;
+  size_t size;
+  // Index into the stacks of the profile
+  uint32_t stack;
+};
+
+struct profile_stack;
+
+struct profile_state {
+  bool initialized;
+  // Mean number of bytes between samples
+  uint64_t rate;
+  // Bytes left until the next sampling point
+  int64_t bytes_until_sample;
+  uint64_t random_state;
+  // Sampled objects that are still alive
+  struct profile_sample *samples;
+  size_t n_samples;
+  size_t samples_capacity;
+  // Distinct backtraces, indexed by hash (stack index + 1, or 0 if empty)
+  struct profile_stack *stacks;
+  size_t n_stacks;
+  size_t stacks_capacity;
+  uint32_t *stack_index;
+  size_t stack_index_capacity;
+};
+
+// All state of one Stella heap. Modules access the state of the current heap
+// through macros named like the former globals (e.g. gen0_space).
+struct gc_heap {
+  bool initialized;
+  // 0 for the default heap, then counted by gc_heap_create
+  unsigned number;
+  // Next heap which is not destroyed
+  struct gc_heap *next;
+  const struct gc_collector *collector;
+  struct gen0_state gen0;
+  struct gen1_state gen1;
+  struct gen2_state gen2;
+  struct roots_state roots;
+  struct stats_state stats;
+  struct nursery_state nursery;
+  struct scheduler_state scheduler;
+  struct epsilon_state epsilon;
+  struct lifetime_state lifetime;
+  struct dedup_state dedup;
+  struct pin_state pin;
+  struct trace_state trace;
+  struct profile_state profile;
+};
+
+extern _Thread_local struct gc_heap *gc_current_heap;
+
+// Calls report with every heap which is not destroyed made current. Reports
+// of a heap are written by gc_heap_destroy, and for the remaining heaps at
+// exit with this.
+void gc_heap_for_each(void (*report)(void));
+
+// File name of a report of the current heap: path for the default heap, and
+// path.N for the N-th heap created
+void gc_heap_output_path(char *buffer, size_t size, const char *path);
+
+#endif // HEAP_H
@@ -0,0 +1,15 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Loaded images and regions published by gc_publish are read-only regions
+// outside of every GC space, shared by all heaps
+
+// Also true for published regions
+bool points_to_loaded_image(uint8_t *ptr);
+
+void print_image_stats(void);
+
+#endif // IMAGE_H
@@ -0,0 +1,46 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/* Helpers for generating a routine per field count. An object header holds
+ * at most 15 fields, so a table of 16 routines covers every object, and each
+ * routine handles its fields with straight-line code. For example:
+ *
+ *   #define VISIT(obj, i) visit(obj->object_fields[i]);
+ *   #define DEFINE_VISIT_KERNEL(n)                                          \
+ *     static void visit_##n(stella_object *obj GC_KERNEL_UNUSED) {          \
+ *       GC_REPEAT_##n(VISIT, obj)                                           \
+ *     }
+ *   GC_FOR_EACH_FIELDS_COUNT(DEFINE_VISIT_KERNEL)
+ */
+
+#define GC_MAX_FIELDS_COUNT (15)
+
+// Marks the object parameter of a kernel, which the routine for zero fields
+// never reads
+#define GC_KERNEL_UNUSED __attribute__((unused))
+
+// Expands EXPAND(n) for every possible field count n
+#define GC_FOR_EACH_FIELDS_COUNT(EXPAND)                                       \
+  EXPAND(0) EXPAND(1) EXPAND(2) EXPAND(3) EXPAND(4) EXPAND(5) EXPAND(6)        \
+  EXPAND(7) EXPAND(8) EXPAND(9) EXPAND(10) EXPAND(11) EXPAND(12) EXPAND(13)    \
+  EXPAND(14) EXPAND(15)
+
+// GC_REPEAT_<n>(STEP, arg) expands to STEP(arg, 0) ... STEP(arg, n - 1)
+#define GC_REPEAT_0(STEP, arg)
+#define GC_REPEAT_1(STEP, arg) GC_REPEAT_0(STEP, arg) STEP(arg, 0)
+#define GC_REPEAT_2(STEP, arg) GC_REPEAT_1(STEP, arg) STEP(arg, 1)
+#define GC_REPEAT_3(STEP, arg) GC_REPEAT_2(STEP, arg) STEP(arg, 2)
+#define GC_REPEAT_4(STEP, arg) GC_REPEAT_3(STEP, arg) STEP(arg, 3)
+#define GC_REPEAT_5(STEP, arg) GC_REPEAT_4(STEP, arg) STEP(arg, 4)
+#define GC_REPEAT_6(STEP, arg) GC_REPEAT_5(STEP, arg) STEP(arg, 5)
+#define GC_REPEAT_7(STEP, arg) GC_REPEAT_6(STEP, arg) STEP(arg, 6)
+#define GC_REPEAT_8(STEP, arg) GC_REPEAT_7(STEP, arg) STEP(arg, 7)
+#define GC_REPEAT_9(STEP, arg) GC_REPEAT_8(STEP, arg) STEP(arg, 8)
+#define GC_REPEAT_10(STEP, arg) GC_REPEAT_9(STEP, arg) STEP(arg, 9)
+#define GC_REPEAT_11(STEP, arg) GC_REPEAT_10(STEP, arg) STEP(arg, 10)
+#define GC_REPEAT_12(STEP, arg) GC_REPEAT_11(STEP, arg) STEP(arg, 11)
+#define GC_REPEAT_13(STEP, arg) GC_REPEAT_12(STEP, arg) STEP(arg, 12)
+#define GC_REPEAT_14(STEP, arg) GC_REPEAT_13(STEP, arg) STEP(arg, 13)
+#define GC_REPEAT_15(STEP, arg) GC_REPEAT_14(STEP, arg) STEP(arg, 14)
+
+#endif // KERNELS_H
@@ -0,0 +1,51 @@
+#ifndef LIFETIME_H
+#define LIFETIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <stella/runtime.h>
+
+// Lifetime tracing (STELLA_GC_LIFETIME_TRACING) measures the age of objects
+// in bytes allocated by the program since their birth. Every object gets a
+// birth stamp in a side table, which follows the object when it is moved.
+// Objects that were not moved by a collection of their space are dead, and
+// their age is added to per-tag histograms. The report of a heap is written
+// when the heap is destroyed or at exit (see gc_heap_output_path).
+
+// Stamps an object allocated by the program
+void lifetime_record_birth(void *obj, size_t size_in_bytes);
+
+// Moves the stamp of an object copied by a collection
+void lifetime_record_move(void *obj, void *new_location);
+
+// Records every object of [start, end) that was not moved as dead. Must be
+// called after the collection which evacuated the range.
+void lifetime_record_deaths(uint8_t *start, uint8_t *end);
+
+// True if a collection should be forced before the next allocation
+// (STELLA_GC_LIFETIME_INTERVAL), to find deaths more precisely
+bool lifetime_collection_due(void);
+
+// Writes the report of the current heap, if it traces lifetimes
+void lifetime_write_report(void);
+
+void lifetime_destroy(void);
+
+void print_lifetime_stats(void);
+
+#ifdef STELLA_GC_LIFETIME_TRACING
+#define GC_LIFETIME_RECORD_BIRTH(obj, size) lifetime_record_birth(obj, size)
+#define GC_LIFETIME_RECORD_MOVE(obj, new_location)                             \
+  lifetime_record_move(obj, new_location)
+#define GC_LIFETIME_RECORD_DEATHS(start, end) lifetime_record_deaths(start, end)
+#define GC_LIFETIME_COLLECTION_DUE() lifetime_collection_due()
+#else
+#define GC_LIFETIME_RECORD_BIRTH(obj, size) ((void)0)
+#define GC_LIFETIME_RECORD_MOVE(obj, new_location) ((void)0)
+#define GC_LIFETIME_RECORD_DEATHS(start, end) ((void)0)
+#define GC_LIFETIME_COLLECTION_DUE() false
+#endif
+
+#endif // LIFETIME_H
@@ -0,0 +1,29 @@
+#ifndef NURSERY_H
+#define NURSERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gc/heap.h"
+
+// Effective size of Gen0: allocation in Gen0 stops at
+// gen0_space + gen0_limit_size, which never exceeds gen0_space_size
+#define gen0_limit_size (gc_current_heap->nursery.limit_size)
+
+// Adaptive sizing is enabled by the STELLA_GC_PAUSE_TARGET_US environment
+// variable. Otherwise the whole gen0_space_size is used.
+#define nursery_is_adaptive (gc_current_heap->nursery.is_adaptive)
+
+void nursery_initialize(void);
+
+uint64_t nursery_clock_ns(void);
+
+// Resizes the nursery after a Gen0 collection. fixed_ns is the part of the
+// pause that does not depend on the nursery size.
+void nursery_record_collect(uint64_t pause_ns, uint64_t fixed_ns,
+                            size_t used_bytes, size_t survived_bytes);
+
+void print_nursery_stats(void);
+
+#endif // NURSERY_H
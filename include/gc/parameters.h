@@ -7,7 +7,27 @@
 #define MAX_ALLOC_SIZE ((size_t)GIGABYTE)
 #endif
 
-#define GEN0_SPACE_SIZE (((size_t)MAX_ALLOC_SIZE) / 3)
+// Spaces hold whole words, so that the second semispace (and every object in
+// it) stays aligned
+#define GEN0_SPACE_SIZE                                                        \
+  ((((size_t)MAX_ALLOC_SIZE) / 3) & ~(sizeof(void *) - 1))
 #define GEN1_SPACE_SIZE (GEN0_SPACE_SIZE * 2)
 
+// Gen2 (see gc/gen2.h) is as large as a semispace
+#define GEN2_SPACE_SIZE GEN1_SPACE_SIZE
+
+// The spaces of a heap are reserved as one region aligned to GC_SLOT_SIZE, the
+// smallest power of two that holds a Gen1 semispace. The semispaces take the
+// first and the third slot, Gen0 the one between them and Gen2 the last one,
+// so that a space is identified by the address bits above GC_SLOT_SHIFT, and
+// Gen0 together with either semispace is a single range. Memory is only used
+// once it is touched, so the slots of unused spaces cost address space only.
+#define GC_SLOT_SHIFT                                                          \
+  (64 - __builtin_clzll((unsigned long long)GEN1_SPACE_SIZE - 1))
+#define GC_SLOT_SIZE ((size_t)1 << GC_SLOT_SHIFT)
+#define GC_REGION_SIZE (4 * GC_SLOT_SIZE)
+
+#define VAR_ROOTS_SEGMENT_SIZE (1024)
+#define MAX_ROOTS_FROM_GEN0_TO_GEN1 (1024)
+
 #endif // PARAMETERS_H
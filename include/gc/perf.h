@@ -0,0 +1,30 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+
+// Phases of a single collection (of any generation)
+enum gc_phase {
+  GC_PHASE_ROOTS,           // forwarding of variable roots
+  GC_PHASE_REMEMBERED_SET,  // scanning and forwarding inter-generational roots
+  GC_PHASE_SCAN,            // Cheney scan
+  GC_PHASE_DEDUP,           // deduplication of immutable objects
+  GC_PHASE_FLIP,            // swapping spaces and resetting pointers
+  GC_PHASES_COUNT
+};
+
+void perf_phase_begin(int gen_n, enum gc_phase phase);
+
+void perf_phase_end(void);
+
+void print_perf_stats(void);
+
+#ifdef STELLA_GC_PERF_COUNTERS
+#define GC_PERF_PHASE_BEGIN(gen_n, phase) perf_phase_begin(gen_n, phase)
+#define GC_PERF_PHASE_END() perf_phase_end()
+#else
+#define GC_PERF_PHASE_BEGIN(gen_n, phase) ((void)0)
+#define GC_PERF_PHASE_END() ((void)0)
+#endif
+
+#endif // PERF_H
@@ -0,0 +1,72 @@
+#ifndef PIN_H
+#define PIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <stella/runtime.h>
+
+#include "gc/heap.h"
+
+// Pinned objects (gc_pin) are never moved. They are marked by a header bit,
+// so that collections can test it where they would move an object, and are
+// listed in a per-heap table sorted by address with their pin counts.
+//
+// A pinned object stays where it is and acts as a root: its fields are
+// forwarded by every collection. Bump allocation in Gen0 and in Gen1 (and
+// copying into Gen1 to-space) stops at the next pinned object, turns the rest
+// of the gap into filler objects, and continues after the pinned object, so
+// that the spaces stay parsable.
+
+// Unused by the tag and the fields count, nor by deduplication marks
+#define PIN_HEADER_BIT (1 << 10)
+
+// Dead memory in front of a pinned object. Fillers have only NULL fields.
+#define TAG_FILLER ((uint8_t)(TAG_MASK - 1))
+
+static inline bool is_pinned(stella_object *obj) {
+  return (obj->object_header & PIN_HEADER_BIT) != 0;
+}
+
+void pin_object(stella_object *obj);
+
+void unpin_object(stella_object *obj);
+
+// Forgets the unpinned objects of a space about to be evacuated. Unpinned
+// objects elsewhere stay pinned until a collection evacuates their space,
+// because allocation may already be skipping them.
+void pin_release_unpinned(uint8_t *space, size_t space_size);
+
+// Same for Gen0, but the released objects are listed until
+// pin_forget_released. An object released there may lie past the allocation
+// pointer, where a Gen1 collection nested in the Gen0 collection does not
+// scan for roots, so that collection forwards its fields with
+// pin_for_each_released until it is promoted.
+void pin_release_unpinned_gen0(uint8_t *space, size_t space_size);
+
+void pin_for_each_released(void (*forward_fields)(stella_object *obj));
+
+void pin_forget_released(void);
+
+// Calls forward_fields on every pinned object
+void pin_for_each(void (*forward_fields)(stella_object *obj));
+
+// Start of the first pinned object in [ptr, end), or end. Bump allocation from
+// ptr must stop there.
+uint8_t *pin_limit(uint8_t *ptr, uint8_t *end);
+
+// Turns [ptr, pinned) into fillers and returns the end of the pinned object at
+// pinned, where bump allocation continues
+uint8_t *pin_skip(uint8_t *ptr, uint8_t *pinned);
+
+// Upper bound of the bytes of [start, end) that bump allocation can not use
+// because of the pinned objects there: the objects themselves and, in front of
+// each, a gap too small for the largest object
+size_t pin_unusable_bytes(uint8_t *start, uint8_t *end);
+
+void pin_destroy(void);
+
+void print_pin_stats(void);
+
+#endif // PIN_H
@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <stella/runtime.h>
+
+// Heap profiling (STELLA_GC_PROFILING) samples allocations about every
+// STELLA_GC_PROFILE_RATE bytes, at random intervals so that the samples do
+// not follow the allocation pattern of the program. A sample keeps the
+// native backtrace of the allocation and follows the object when it is moved
+// until it dies. The allocation and in-use profiles of a heap are written to
+// STELLA_GC_PROFILE_OUTPUT (see gc_heap_output_path) when the heap is
+// destroyed or at exit, in the heap profile format of gperftools, which pprof
+// reads and symbolizes with the memory map at the end of the file.
+
+// Counts the bytes of an allocation of the program and samples it if a
+// sampling point falls into it
+void profile_record_alloc(void *block, size_t object_size, size_t count);
+
+// Follows the sampled objects of [start, end) to their new locations, and
+// forgets those that were not moved. Must be called after the collection
+// which evacuated the range.
+void profile_record_deaths(uint8_t *start, uint8_t *end);
+
+// Forgets the sampled objects of [start, end) which are not live. Must be
+// called after marking the range, before it is swept.
+void profile_record_sweep(uint8_t *start, uint8_t *end,
+                          bool (*is_live)(stella_object *obj));
+
+// Writes the profile of the current heap, if it samples allocations
+void profile_write(void);
+
+void profile_destroy(void);
+
+void print_profile_stats(void);
+
+#ifdef STELLA_GC_PROFILING
+#define GC_PROFILE_RECORD_ALLOC(block, object_size, count)                     \
+  profile_record_alloc(block, object_size, count)
+#define GC_PROFILE_RECORD_DEATHS(start, end) profile_record_deaths(start, end)
+#define GC_PROFILE_RECORD_SWEEP(start, end, is_live)                           \
+  profile_record_sweep(start, end, is_live)
+#else
+#define GC_PROFILE_RECORD_ALLOC(block, object_size, count) ((void)0)
+#define GC_PROFILE_RECORD_DEATHS(start, end) ((void)0)
+#define GC_PROFILE_RECORD_SWEEP(start, end, is_live) ((void)0)
+#endif
+
+#endif // PROFILE_H
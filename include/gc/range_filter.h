@@ -0,0 +1,16 @@
+#ifndef RANGE_FILTER_H
+#define RANGE_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Maximum number of words tested by one range_filter call
+#define RANGE_FILTER_MAX_WORDS (64)
+
+// Returns a mask where bit i is set if words[i] points into
+// [start, start + size). At most RANGE_FILTER_MAX_WORDS words are tested.
+// Uses AVX2 or SSE2 when the CPU supports them.
+uint64_t range_filter(void *const *words, int n_words, const uint8_t *start,
+                      size_t size);
+
+#endif // RANGE_FILTER_H
@@ -3,19 +3,35 @@
 
 #include <stella/runtime.h>
 
-#define MAX_VAR_ROOTS (1024)
-#define MAX_ROOTS_FROM_GEN0_TO_GEN1 (1024)
-
-extern int var_roots_next_index;
-extern void **var_roots[MAX_VAR_ROOTS];
-
-extern int roots_from_gen0_to_gen1_next_index;
-extern void **roots_from_gen0_to_gen1[MAX_ROOTS_FROM_GEN0_TO_GEN1];
-
-extern int roots_from_gen1_to_gen0_next_index;
-extern void **roots_from_gen1_to_gen0[MAX_ROOTS_FROM_GEN0_TO_GEN1];
+#include "gc/heap.h"
+
+#define var_roots_next_index (gc_current_heap->roots.var_next_index)
+#define var_roots_top (gc_current_heap->roots.var_top)
+#define var_roots_top_index (gc_current_heap->roots.var_top_index)
+#define var_roots_first (gc_current_heap->roots.var_first)
+
+// Walks the local roots from the bottom of the stack: segment->roots[i] is
+// the current root
+#define FOR_EACH_VAR_ROOT(segment, i)                                          \
+  for (struct var_roots_segment *segment = &var_roots_first;                  \
+       segment != NULLPTR;                                                     \
+       segment = segment == var_roots_top ? NULLPTR : segment->next)           \
+    for (int i = 0, segment##_size = segment == var_roots_top                  \
+                                         ? var_roots_top_index                 \
+                                         : VAR_ROOTS_SEGMENT_SIZE;             \
+         i < segment##_size; i++)
+
+#define roots_from_gen0_to_gen1_next_index                                     \
+  (gc_current_heap->roots.gen0_to_gen1_next_index)
+#define roots_from_gen0_to_gen1 (gc_current_heap->roots.gen0_to_gen1)
+
+#define roots_from_gen1_to_gen0_next_index                                     \
+  (gc_current_heap->roots.gen1_to_gen0_next_index)
+#define roots_from_gen1_to_gen0 (gc_current_heap->roots.gen1_to_gen0)
 
 // Local roots
+void initialize_var_roots(void);
+void destroy_var_roots(void);
 void push_var_root(void **root);
 void pop_var_root(void **root);
 
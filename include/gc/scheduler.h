@@ -0,0 +1,22 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Frees Gen0 when it is full. Runs a Gen0 collection, unless Gen1 is
+// predicted to overflow while the survivors are promoted. In that case runs a
+// full-heap collection instead of a Gen1 collection nested in Gen0's one.
+void scheduler_collect(void);
+
+void scheduler_record_promotion(size_t used_bytes, size_t promoted_bytes);
+
+// Runs a minor (generation 0) or a major (full-heap) collection on request.
+// Without Gen0 (semispace) both are Gen1 collections.
+void scheduler_collect_generation(int generation);
+
+// Runs the collection that is most worth doing in budget_ns of idle time, if
+// any. Returns the generation collected, or -1.
+int scheduler_idle_hint(uint64_t budget_ns);
+
+#endif // SCHEDULER_H
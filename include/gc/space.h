@@ -0,0 +1,22 @@
+#ifndef SPACE_H
+#define SPACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory of GC spaces. With STELLA_GC_COMPRESSED_REFS the spaces of all heaps
+// are carved from one region reserved inside the range of compressed
+// references, otherwise they are allocated with malloc, or mapped if they
+// have to be aligned.
+
+uint8_t *space_alloc(size_t size);
+
+void space_free(uint8_t *space, size_t size);
+
+// Allocates a space starting at a multiple of alignment, a power of two.
+// Pages are only backed by memory once they are touched.
+uint8_t *space_alloc_aligned(size_t size, size_t alignment);
+
+void space_free_aligned(uint8_t *space, size_t size);
+
+#endif // SPACE_H
@@ -1,16 +1,69 @@
 #ifndef STATS_H
 #define STATS_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
+// Counters of the current heap exported outside of the process (see
+// gc/export.h). All of them are 64-bit, so the layout of the snapshot is the
+// same for every build.
+#define GC_STATS_SNAPSHOT_FIELDS(FIELD)                                        \
+  FIELD(allocated_bytes)                                                       \
+  FIELD(allocated_objects)                                                     \
+  FIELD(max_residency_bytes)                                                   \
+  FIELD(max_gen0_residency_bytes)                                              \
+  FIELD(max_gen1_residency_bytes)                                              \
+  FIELD(gen0_collects)                                                         \
+  FIELD(gen1_collects)                                                         \
+  FIELD(nested_collects)                                                       \
+  FIELD(full_collects)                                                         \
+  FIELD(copied_bytes)                                                          \
+  FIELD(idle_collects)                                                         \
+  FIELD(roots)                                                                 \
+  FIELD(max_roots)                                                             \
+  FIELD(gen0_used_bytes)                                                       \
+  FIELD(gen0_limit_bytes)                                                      \
+  FIELD(gen0_size_bytes)                                                       \
+  FIELD(gen1_used_bytes)                                                       \
+  FIELD(gen1_size_bytes)                                                       \
+  FIELD(epsilon_chunks)                                                        \
+  FIELD(nursery_max_pause_ns)                                                  \
+  FIELD(nursery_total_pause_ns)                                                \
+  FIELD(nursery_pauses_over_target)                                            \
+  FIELD(dedup_objects)                                                         \
+  FIELD(dedup_bytes)                                                           \
+  FIELD(dedup_ns)                                                              \
+  FIELD(pinned_objects)                                                        \
+  FIELD(pinned_filled_bytes)                                                   \
+  FIELD(gen2_collects)                                                         \
+  FIELD(gen2_used_bytes)                                                       \
+  FIELD(tenured_bytes)
+
+#define GC_STATS_SNAPSHOT_FIELD_DECLARATION(name) uint64_t name;
+
+struct gc_stats_snapshot {
+  GC_STATS_SNAPSHOT_FIELDS(GC_STATS_SNAPSHOT_FIELD_DECLARATION)
+};
+
 void stats_record_push_root(void);
 
 void stats_record_allocation(size_t size_in_bytes);
 
+void stats_record_bulk_allocation(size_t object_size, size_t n_objects);
+
 void stats_record_collect(int gen_n);
 
+void stats_record_full_collect(void);
+
+void stats_record_nested_collect(void);
+
+void stats_record_copied_bytes(size_t size_in_bytes);
+
 void stats_record_max_residency(void);
 
 void print_stats(void);
 
+// Only reads the state of the heap, so it may be called from a signal handler
+void stats_snapshot(struct gc_stats_snapshot *snapshot);
+
 #endif // STATS_H
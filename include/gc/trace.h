@@ -0,0 +1,131 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <stella/runtime.h>
+
+// Allocation traces (STELLA_GC_TRACE) record what the program asks of the
+// collector, so that it can be replayed offline against any configuration
+// (see tools/gc_replay.c). Recording starts at the first allocation if
+// STELLA_GC_TRACE_OUTPUT names a file, for the first heap which allocates.
+//
+// Objects are named by ids in allocation order, kept in a side table per word
+// of Gen0 and of both Gen1 spaces, which follows objects when they are moved.
+// Id 0 is NULL and id 1 is any object outside of the spaces (static objects,
+// heap images). When replaying, the side table is also kept in reverse, so
+// that the replay finds the current location of an object by its id.
+//
+// A trace is a struct trace_header followed by events: an opcode byte and
+// unsigned LEB128 operands.
+
+#define TRACE_MAGIC 0x54474c53u // "SLGT"
+#define TRACE_VERSION 2u
+
+#define TRACE_NULL_ID 0
+#define TRACE_OUTSIDE_ID 1
+#define TRACE_FIRST_ID 2
+
+struct trace_header {
+  uint32_t magic;
+  uint32_t version;
+  // Sizes are only meaningful for the same layout of objects
+  uint32_t ref_size;
+  uint32_t reserved;
+};
+
+enum trace_event {
+  // size: a new object of gc_alloc, with the next id
+  TRACE_ALLOC = 1,
+  // object size, requested count, count: new objects of gc_alloc_many, with
+  // the next ids
+  TRACE_ALLOC_MANY,
+  // header, field ids: contents of the next object of the last allocation,
+  // as seen at the next allocation or collection
+  TRACE_INIT,
+  // object id, field index, value id: a write through the write barrier
+  TRACE_WRITE,
+  // value id: a new local root
+  TRACE_PUSH_ROOT,
+  TRACE_POP_ROOT,
+  // root index, value id: a local root changed since it was last recorded
+  TRACE_SET_ROOT,
+  // generation: gc_collect
+  TRACE_COLLECT,
+  // budget in microseconds: gc_idle_hint
+  TRACE_IDLE_HINT,
+  // object id: gc_pin
+  TRACE_PIN,
+  // object id: gc_unpin
+  TRACE_UNPIN,
+};
+
+// Recording, called by the entry points of the collector. Allocations may
+// move objects, so the new objects of the last allocation and the local roots
+// are recorded before the next one.
+void trace_before_alloc(void);
+void trace_record_alloc(void *obj, size_t size_in_bytes);
+void trace_record_alloc_many(void *block, size_t object_size,
+                             size_t requested_count, size_t count);
+void trace_record_write(void *object, int field_index, void *contents);
+void trace_record_push_root(void **root);
+void trace_record_pop_root(void);
+void trace_record_collect(int generation);
+void trace_record_idle_hint(uint64_t budget_us);
+void trace_record_pin(void *object);
+void trace_record_unpin(void *object);
+
+// Moves the id of an object copied by a collection
+void trace_record_move(void *obj, void *new_location);
+
+// Gives the id of a duplicate merged by deduplication to its canonical copy
+void trace_record_merge(void *obj, void *canonical);
+
+// Replaying, called by the replay driver before its first allocation
+void trace_replay_start(void);
+
+// Current location of the object with an id, while replaying
+stella_object *trace_replay_object(uint64_t id);
+
+// Takes back the ids of the last count objects, which the replay allocated
+// beyond the objects of the trace
+void trace_replay_drop_ids(void *block, size_t object_size, size_t count);
+
+void trace_destroy(void);
+
+#ifdef STELLA_GC_TRACE
+#define GC_TRACE_BEFORE_ALLOC() trace_before_alloc()
+#define GC_TRACE_RECORD_ALLOC(obj, size_in_bytes)                              \
+  trace_record_alloc(obj, size_in_bytes)
+#define GC_TRACE_RECORD_ALLOC_MANY(block, object_size, requested_count, count) \
+  trace_record_alloc_many(block, object_size, requested_count, count)
+#define GC_TRACE_RECORD_WRITE(object, field_index, contents)                   \
+  trace_record_write(object, field_index, contents)
+#define GC_TRACE_RECORD_PUSH_ROOT(root) trace_record_push_root(root)
+#define GC_TRACE_RECORD_POP_ROOT() trace_record_pop_root()
+#define GC_TRACE_RECORD_COLLECT(generation) trace_record_collect(generation)
+#define GC_TRACE_RECORD_IDLE_HINT(budget_us) trace_record_idle_hint(budget_us)
+#define GC_TRACE_RECORD_PIN(object) trace_record_pin(object)
+#define GC_TRACE_RECORD_UNPIN(object) trace_record_unpin(object)
+#define GC_TRACE_RECORD_MOVE(obj, new_location)                                \
+  trace_record_move(obj, new_location)
+#define GC_TRACE_RECORD_MERGE(obj, canonical) trace_record_merge(obj, canonical)
+#else
+#define GC_TRACE_BEFORE_ALLOC() ((void)0)
+#define GC_TRACE_RECORD_ALLOC(obj, size_in_bytes) ((void)0)
+#define GC_TRACE_RECORD_ALLOC_MANY(block, object_size, requested_count, count) \
+  ((void)0)
+#define GC_TRACE_RECORD_WRITE(object, field_index, contents) ((void)0)
+#define GC_TRACE_RECORD_PUSH_ROOT(root) ((void)0)
+#define GC_TRACE_RECORD_POP_ROOT() ((void)0)
+#define GC_TRACE_RECORD_COLLECT(generation) ((void)0)
+#define GC_TRACE_RECORD_IDLE_HINT(budget_us) ((void)0)
+#define GC_TRACE_RECORD_PIN(object) ((void)0)
+#define GC_TRACE_RECORD_UNPIN(object) ((void)0)
+#define GC_TRACE_RECORD_MOVE(obj, new_location) ((void)0)
+#define GC_TRACE_RECORD_MERGE(obj, canonical) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -6,6 +6,10 @@
 
 #include <stella/runtime.h>
 
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/parameters.h"
+
 // Size of stella object
 size_t gc_size_of_object(stella_object *obj);
 
@@ -14,13 +18,33 @@ size_t gc_size_of_object(stella_object *obj);
 
 bool points_to_some_space(uint8_t *space, uint8_t *ptr, size_t space_size);
 
-bool points_to_gen0_space(uint8_t *ptr);
+// The checkers below are inline and compare once, using the layout of the
+// region of a heap (see GC_SLOT_SIZE)
+
+// An Appel nursery only takes a part of its slot
+static inline bool points_to_gen0_space(uint8_t *ptr) {
+  return (uintptr_t)ptr - (uintptr_t)gen0_space < gen0_space_size;
+}
 
-bool points_to_fromspace(uint8_t *ptr);
+// Gen1 must be initialized
+static inline bool points_to_fromspace(uint8_t *ptr) {
+  return (uintptr_t)ptr >> GC_SLOT_SHIFT ==
+         (uintptr_t)gen1_fromspace >> GC_SLOT_SHIFT;
+}
 
-bool points_to_tospace(uint8_t *ptr);
+// Gen1 must be initialized
+static inline bool points_to_tospace(uint8_t *ptr) {
+  return (uintptr_t)ptr >> GC_SLOT_SHIFT ==
+         (uintptr_t)gen1_tospace >> GC_SLOT_SHIFT;
+}
 
-bool is_managed_by_gc(stella_object *obj);
+// Nothing else is allocated in the region, even in the slot of Gen0 when Gen0
+// is not used. The region is NULL before the initialization and with the
+// epsilon GC.
+static inline bool is_managed_by_gc(stella_object *obj) {
+  return gen1_region != NULLPTR &&
+         (uintptr_t)obj - (uintptr_t)gen1_region < GC_REGION_SIZE;
+}
 
 bool is_enough_space_left_for_object(uint8_t *space, size_t space_size,
                                      uint8_t *dest, size_t object_size);
@@ -28,6 +52,12 @@ bool is_enough_space_left_for_object(uint8_t *space, size_t space_size,
 void *try_alloc(uint8_t *space_start, size_t space_size, uint8_t **alloc_ptr,
                 size_t size_in_bytes);
 
+// Allocates up to count objects of object_size bytes as one block at *block.
+// Returns the number of allocated objects, 0 if not even one fits.
+size_t try_alloc_many(uint8_t *space_start, size_t space_size,
+                      uint8_t **alloc_ptr, size_t object_size, size_t count,
+                      void **block);
+
 // ------------------------------------
 // --- Copy Objects
 
@@ -12,6 +12,26 @@ void set_tag(stella_object *obj, uint8_t tag);
 
 uint8_t get_fields_count(stella_object *obj);
 
+// Fields hold encoded references (see gc_ref), these are called for every
+// scanned field so they are inlined
+static inline stella_object *get_field(stella_object *obj, int i) {
+  return (stella_object *)gc_ref_decode(obj->object_fields[i]);
+}
+
+static inline void set_field(stella_object *obj, int i, stella_object *value) {
+  obj->object_fields[i] = gc_ref_encode(value);
+}
+
+// For fields of Gen2 objects, which the concurrent marker of Gen2 may be
+// reading meanwhile. Compiles to the same store as set_field.
+static inline void set_field_relaxed(stella_object *obj, int i,
+                                     stella_object *value) {
+  __atomic_store_n(&obj->object_fields[i], gc_ref_encode(value),
+                   __ATOMIC_RELAXED);
+}
+
+const char *stella_tag_name(uint8_t tag);
+
 void print_stella_tag(stella_object *obj);
 
 void print_stella_object_fields(stella_object *obj);
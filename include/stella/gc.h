@@ -1,16 +1,79 @@
 #ifndef STELLA_GC_H
 #define STELLA_GC_H
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 
-/** This macro is used whenever the runtime wants to READ a heap object's field.
+/** Kinds of barriers, selected at build time with STELLA_GC_BARRIERS.
+ * GC_BARRIERS_NONE: fields are accessed directly. The collectors of this
+ *   library need no barriers, so this is the default.
+ * GC_BARRIERS_RANGE: writes into objects inside the barrier range (see
+ *   gc_barrier_range_start) call gc_write_barrier, other accesses are direct.
+ *   The range check is inlined, and the range is empty unless a collector
+ *   sets it.
+ * GC_BARRIERS_CALL: every access calls gc_read_barrier/gc_write_barrier
+ *   (e.g. to count reads and writes with the reference epsilon GC).
  */
-#define GC_READ_BARRIER(object, field_index, read_code) (void *)(gc_read_barrier(object, field_index), read_code) // NO BARRIER
-/** This macro is used whenever the runtime wants to OVERWRITE a heap object's field.
+#define GC_BARRIERS_NONE 0
+#define GC_BARRIERS_RANGE 1
+#define GC_BARRIERS_CALL 2
+
+#ifndef STELLA_GC_BARRIERS
+#define STELLA_GC_BARRIERS GC_BARRIERS_NONE
+#endif
+
+/** References stored in object fields.
+ * With STELLA_GC_COMPRESSED_REFS a field holds a 32-bit offset from
+ * GC_REF_BASE (the start of the executable) in units of GC_REF_ALIGNMENT
+ * bytes, and 0 stands for NULL. So every object must live in the 32 GB above
+ * the start of the executable: the heap is reserved there, and static objects
+ * and functions are part of the executable. Functions stored in fields must be
+ * aligned to GC_REF_ALIGNMENT as well (see -falign-functions).
+ * Otherwise a field holds a plain pointer.
+ */
+#ifdef STELLA_GC_COMPRESSED_REFS
+typedef uint32_t gc_ref;
+#define GC_REF_SHIFT 3
+#define GC_REF_ALIGNMENT ((size_t)1 << GC_REF_SHIFT)
+#define GC_REF_RANGE ((uintptr_t)1 << (32 + GC_REF_SHIFT))
+extern const char __ehdr_start[];
+#define GC_REF_BASE ((uintptr_t)__ehdr_start)
+static inline void *gc_ref_decode(gc_ref ref) {
+  return ref == 0 ? NULL : (void *)(GC_REF_BASE + ((uintptr_t)ref << GC_REF_SHIFT));
+}
+static inline gc_ref gc_ref_encode(const void *ptr) {
+  return ptr == NULL ? 0 : (gc_ref)(((uintptr_t)ptr - GC_REF_BASE) >> GC_REF_SHIFT);
+}
+#else
+typedef void *gc_ref;
+#define GC_REF_ALIGNMENT sizeof(void *)
+static inline void *gc_ref_decode(gc_ref ref) { return ref; }
+static inline gc_ref gc_ref_encode(const void *ptr) { return (gc_ref)ptr; }
+#endif
+
+/** Objects in [gc_barrier_range_start, gc_barrier_range_start + gc_barrier_range_size)
+ * take the slow path of the write barrier in GC_BARRIERS_RANGE mode.
+ */
+extern uintptr_t gc_barrier_range_start;
+extern size_t gc_barrier_range_size;
+
+/** GC_READ_BARRIER is used whenever the runtime wants to READ a heap object's field.
+ * GC_WRITE_BARRIER is used whenever the runtime wants to OVERWRITE a heap object's field.
  * This is NOT used when initializing object fields.
  */
-#define GC_WRITE_BARRIER(object, field_index, contents, write_code) (gc_write_barrier(object, field_index, contents), write_code) // NO BARRIER
+#if STELLA_GC_BARRIERS == GC_BARRIERS_CALL
+#define GC_READ_BARRIER(object, field_index, read_code) (void *)(gc_read_barrier(object, field_index), read_code)
+#define GC_WRITE_BARRIER(object, field_index, contents, write_code) (gc_write_barrier(object, field_index, contents), write_code)
+#elif STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+#define GC_READ_BARRIER(object, field_index, read_code) (void *)(read_code) // NO BARRIER
+#define GC_WRITE_BARRIER(object, field_index, contents, write_code) \
+  ((uintptr_t)(object) - gc_barrier_range_start < gc_barrier_range_size \
+       ? gc_write_barrier(object, field_index, contents) : (void)0, write_code)
+#else
+#define GC_READ_BARRIER(object, field_index, read_code) (void *)(read_code) // NO BARRIER
+#define GC_WRITE_BARRIER(object, field_index, contents, write_code) (write_code) // NO BARRIER
+#endif
 
 /** Allocate an object on the heap of AT LEAST size_in_bytes bytes.
  * If necessary, this should start/continue garbage collection.
@@ -18,6 +81,14 @@
  */
 void* gc_alloc(size_t size_in_bytes);
 
+/** Allocate up to count objects of object_size bytes each as one contiguous
+ * block, stored in *block. The GC collects at most once for the whole block.
+ * Returns the number of allocated objects, at least one (a block larger than
+ * the nursery is returned in parts, so the caller asks again for the rest).
+ * All allocated objects must be initialized before the next allocation.
+ */
+size_t gc_alloc_many(size_t object_size, size_t count, void **block);
+
 /** GC-specific code which must be executed on each READ operation.
  */
 void gc_read_barrier(void *object, int field_index);
@@ -34,6 +105,31 @@ void gc_push_root(void **object);
  */
 void gc_pop_root(void **object);
 
+/** Collect now instead of waiting for the heap to fill up: generation 0
+ * runs a minor collection, any other generation a major (full-heap) one, and
+ * generation 2 also collects the tenured generation if it is enabled.
+ * Collectors which never collect do nothing.
+ */
+void gc_collect(int generation);
+/** Tell the collector that the program is idle for about budget_us
+ * microseconds (e.g. between requests). The collector runs a major or a
+ * minor collection if the heap is used enough for it to be worth it and the
+ * collection is predicted to fit into the budget.
+ * Returns the generation collected, or -1 if nothing was collected.
+ */
+int gc_idle_hint(uint64_t budget_us);
+
+/** Pin an object: collections do not move it until the matching gc_unpin,
+ * so its memory may be handed to native code (e.g. write or readv).
+ * Pins nest. A pinned object is kept alive, as if it were a root.
+ * Objects which are never moved (static ones, those of heap images or of a
+ * collector which does not move objects) are ignored.
+ */
+void gc_pin(void *object);
+/** Release a pin taken by gc_pin.
+ */
+void gc_unpin(void *object);
+
 /** Print GC statistics. Output must include at least:
  *
  * 1. Total allocated memory (bytes and objects).
@@ -53,6 +149,54 @@ void print_gc_alloc_stats(void);
  */
 void print_gc_state(void);
 
+/** An isolated heap: its own spaces, roots and statistics.
+ * All functions of this header operate on the current heap of the calling
+ * thread. Threads which never select a heap share the default one.
+ */
+typedef struct gc_heap gc_heap;
+
+/** Create an empty heap. It is initialized on the first allocation.
+ */
+gc_heap *gc_heap_create(void);
+/** Free all memory of a heap created by gc_heap_create.
+ * Objects of the heap must not be used afterwards. If the heap is current,
+ * the calling thread switches to the default heap.
+ */
+void gc_heap_destroy(gc_heap *heap);
+/** The current heap of the calling thread.
+ */
+gc_heap *gc_heap_current(void);
+/** Make the heap current for the calling thread (NULL selects the default
+ * heap). Returns the previously current heap.
+ */
+gc_heap *gc_heap_select(gc_heap *heap);
+
+/** Save the object graph reachable from root into a heap image file.
+ * Pointers inside the graph are saved as offsets, so the image can be loaded
+ * at any address, but only by the same executable.
+ * Returns 0 on success and -1 on failure.
+ */
+int gc_save_image(const char *path, void *root);
+/** Map a heap image saved by gc_save_image into an immortal read-only region.
+ * Returns the root of the saved graph, or NULL on failure.
+ * Objects of the image must not be overwritten.
+ */
+void *gc_load_image(const char *path);
+
+/** Copy the object graph reachable from root out of the current heap into a
+ * shared read-only region, which never moves and is readable by all heaps
+ * and threads. Returns the copy of root, or NULL on failure, which includes
+ * graphs with mutable reference cells. The region lives until
+ * gc_release_published. Its pages are read-only: a write into it stops the
+ * program in the write barrier with STELLA_GC_BARRIERS=call, and faults
+ * (SIGSEGV) otherwise.
+ */
+void *gc_publish(void *root);
+/** Free a region returned by gc_publish. Its objects must not be used
+ * afterwards by any heap.
+ */
+void gc_release_published(void *root);
+
 /** Print current GC roots (addresses).
  * May be useful for debugging.
  */
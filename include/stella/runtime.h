@@ -5,20 +5,28 @@
 #include "gc.h"
 
 /** A Stella object with statically unknown number of fields.
+ * Objects are aligned to GC_REF_ALIGNMENT, so that they can be referenced by
+ * compressed references.
  */
-typedef struct {
+typedef struct __attribute__((aligned(GC_REF_ALIGNMENT))) {
   int    object_header;     /**< Header of the object contains
                               * its TAG (see STELLA_OBJECT_HEADER_TAG) and
                               * the number of fields (see STELLA_OBJECT_HEADER_FIELD_COUNT). */
-  void*  object_fields[];  /**< An array of object fields (0 fields for static objects). */
+  gc_ref object_fields[];  /**< An array of object fields (0 fields for static objects),
+                              * see gc_ref for their encoding. */
 } stella_object;
 
+/** Size in bytes of a Stella object with a given number of fields
+ * (the header and the fields, rounded up to GC_REF_ALIGNMENT). */
+#define STELLA_OBJECT_SIZE(fields_count) \
+  ((sizeof(int) + (size_t)(fields_count) * sizeof(gc_ref) + GC_REF_ALIGNMENT - 1) & ~(GC_REF_ALIGNMENT - 1))
+
 /** Read a field from a Stella object. Subject to a read barrier. */
-#define STELLA_OBJECT_READ_FIELD(obj, i) GC_READ_BARRIER(obj, i, ((stella_object*)(obj->object_fields[i])))
+#define STELLA_OBJECT_READ_FIELD(obj, i) GC_READ_BARRIER(obj, i, ((stella_object*)gc_ref_decode(obj->object_fields[i])))
 /** (Over)write a field from a Stella object. Subject to a write barrier.
  * See STELLA_OBJECT_INIT_FIELD for initialization of fields (which does not trigger the write barrier).
  */
-#define STELLA_OBJECT_WRITE_FIELD(obj, i, x) GC_WRITE_BARRIER(obj, i, x, (obj->object_fields[i] = (void*)x))
+#define STELLA_OBJECT_WRITE_FIELD(obj, i, x) GC_WRITE_BARRIER(obj, i, x, (obj->object_fields[i] = gc_ref_encode((void*)x)))
 
 /** Extract the TAG from Stella object's header. */
 #define STELLA_OBJECT_HEADER_TAG(header) (header & TAG_MASK)
@@ -33,7 +41,7 @@ typedef struct {
 /** Initialize new Stella object's fields count. */
 #define STELLA_OBJECT_INIT_FIELDS_COUNT(obj, count) (obj->object_header = ((obj->object_header & ~(((1 << 4) - 1) << 4)) | count << 4))
 /** Initialize new Stella object's field. */
-#define STELLA_OBJECT_INIT_FIELD(obj, i, x) (obj->object_fields[i] = (void*)x)
+#define STELLA_OBJECT_INIT_FIELD(obj, i, x) (obj->object_fields[i] = gc_ref_encode((void*)x))
 
 /** Call a Stella function (closure) with a given Stella object as an argument. */
 #define STELLA_OBJECT_CLOSURE_CALL(f, x) (*(stella_object *(*)(stella_object *, stella_object *))STELLA_OBJECT_READ_FIELD(f, 0))(f, x)
@@ -43,9 +51,9 @@ typedef struct {
  * This is only supposed to be used for static Stella objects, corresponding
  * to the top-level function definitions (the only field being the address of the function).
  */
-typedef struct {
+typedef struct __attribute__((aligned(GC_REF_ALIGNMENT))) {
   int    object_header;     /**< Header of the object. Same as in stella_object. */
-  void*  object_fields[1];  /**< An array of object fields (1 field for static objects). */
+  gc_ref object_fields[1];  /**< An array of object fields (1 field for static objects). */
 } stella_object_1;
 
 /** An enumeration of possible Stella object tags. */
@@ -68,6 +76,12 @@ enum TAG {
  * Note that this function makes use of gc_alloc.
  */
 stella_object* alloc_stella_object(enum TAG tag, int fields_count);
+/** Allocate up to count Stella objects with the same TAG and number of fields
+ * (at least one field) as one contiguous block, see gc_alloc_many.
+ * Stores the first object in *objects and returns the number of allocated
+ * objects. Their fields must be initialized before the next allocation.
+ */
+int alloc_stella_objects(enum TAG tag, int fields_count, int count, stella_object **objects);
 
 /** Convert a natural number (non-negative integer) into a corresponding Stella object. */
 stella_object *nat_to_stella_object(int n);
@@ -20,6 +20,38 @@ int total_writes = 0;
 
 #define MAX_GC_ROOTS 1024
 
+uintptr_t gc_barrier_range_start = 0;
+size_t gc_barrier_range_size = 0;
+
+#ifdef STELLA_GC_COMPRESSED_REFS
+#include <sys/mman.h>
+
+// Objects must be addressable by compressed references (see gc_ref), so they
+// are bump-allocated from a region reserved above the executable
+#define EPSILON_REGION_OFFSET ((uintptr_t)4 << 30)
+
+static char *epsilon_region_ptr = NULL;
+
+static void *epsilon_malloc(size_t size_in_bytes) {
+  if (epsilon_region_ptr == NULL) {
+    void *preferred = (void *)(GC_REF_BASE + EPSILON_REGION_OFFSET);
+    void *start = mmap(preferred, GC_REF_RANGE - EPSILON_REGION_OFFSET,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (start != preferred) {
+      printf("Could not reserve the heap region for compressed references\n");
+      exit(1);
+    }
+    epsilon_region_ptr = start;
+  }
+  void *result = epsilon_region_ptr;
+  epsilon_region_ptr += (size_in_bytes + GC_REF_ALIGNMENT - 1) & ~(GC_REF_ALIGNMENT - 1);
+  return result;
+}
+#else
+#define epsilon_malloc malloc
+#endif
+
 int gc_roots_max_size = 0;
 int gc_roots_top = 0;
 void **var_roots[MAX_GC_ROOTS];
@@ -31,7 +63,16 @@ void *gc_alloc(size_t size_in_bytes) {
   total_allocated_objects += 1;
   max_allocated_bytes = total_allocated_bytes;
   max_allocated_objects = total_allocated_objects;
-  return malloc(size_in_bytes);
+  return epsilon_malloc(size_in_bytes);
+}
+
+size_t gc_alloc_many(size_t object_size, size_t count, void **block) {
+  total_allocated_bytes += object_size * count;
+  total_allocated_objects += count;
+  max_allocated_bytes = total_allocated_bytes;
+  max_allocated_objects = total_allocated_objects;
+  *block = epsilon_malloc(object_size * count);
+  return count;
 }
 
 void print_gc_roots() {
@@ -56,6 +97,14 @@ void print_gc_state() {
   // TODO: not implemented
 }
 
+void gc_collect(int generation) {}
+
+int gc_idle_hint(uint64_t budget_us) { return -1; }
+
+void gc_pin(void *object) {}
+
+void gc_unpin(void *object) {}
+
 void gc_read_barrier(void *object, int field_index) { total_reads += 1; }
 
 void gc_write_barrier(void *object, int field_index, void *contents) {
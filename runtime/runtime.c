@@ -28,21 +28,41 @@ stella_object* alloc_stella_object(enum TAG tag, int fields_count) {
     case TAG_TUPLE: if (fields_count == 0) { return &the_EMPTY_TUPLE; }
     // allocate an object with at least one field (or an unknown tag)
     default:
-      obj = gc_alloc(sizeof(stella_object) + fields_count * sizeof(void*));
+      obj = gc_alloc(STELLA_OBJECT_SIZE(fields_count));
       STELLA_OBJECT_INIT_TAG(obj, tag);
       STELLA_OBJECT_INIT_FIELDS_COUNT(obj, fields_count);
       return obj;
   }
 }
 
+int alloc_stella_objects(enum TAG tag, int fields_count, int count, stella_object **objects) {
+  size_t object_size = STELLA_OBJECT_SIZE(fields_count);
+  void *block;
+  int n = gc_alloc_many(object_size, count, &block);
+  total_allocated_fields += n * fields_count;
+  for (int i = 0; i < n; i++) {
+    stella_object *obj = (stella_object*)((char*)block + i * object_size);
+    STELLA_OBJECT_INIT_TAG(obj, tag);
+    STELLA_OBJECT_INIT_FIELDS_COUNT(obj, fields_count);
+  }
+  *objects = (stella_object*)block;
+  return n;
+}
+
 stella_object *nat_to_stella_object(int n) {
-  stella_object *result, *x;
+  stella_object *result, *block;
   gc_push_root((void*)&result);    // it is sufficient to push only result
   result = &the_ZERO;
-  for (int i = n; i > 0; i--) {
-    x = alloc_stella_object(TAG_SUCC, 1);
-    STELLA_OBJECT_INIT_FIELD(x, 0, result);
-    result = x;
+  size_t object_size = STELLA_OBJECT_SIZE(1);
+  while (n > 0) {
+    // no allocation happens until the whole block is initialized
+    int count = alloc_stella_objects(TAG_SUCC, 1, n, &block);
+    for (int i = 0; i < count; i++) {
+      stella_object *x = (stella_object*)((char*)block + i * object_size);
+      STELLA_OBJECT_INIT_FIELD(x, 0, result);
+      result = x;
+    }
+    n -= count;
   }
   gc_pop_root((void*)&result);
   return result;
@@ -132,7 +152,7 @@ void print_stella_object(stella_object* obj) {
     case TAG_TUPLE:
       printf("{");
       for (int i = 0; i < fields_count; i++) {
-        print_stella_object(obj->object_fields[i]);
+        print_stella_object(gc_ref_decode(obj->object_fields[i]));
         if (i < fields_count - 1) { printf(", "); }
       }
       printf("}");  // TODO: pretty print a tuple
@@ -9,73 +9,121 @@
 #include <runtime.h>
 
 #include "constants.h"
-#include "gc/gen0.h"
-#include "gc/parameters.h"
+#include "gc/collector.h"
+#include "gc/export.h"
+#include "gc/heap.h"
+#include "gc/image.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
 #include "gc/roots.h"
-#include "gc/stats.h"
-#include "runtime_extras.h"
-
-#include "gc/gen1.h"
+#include "gc/trace.h"
 
 // ------------------------------------
 // --- GC State
 
-bool gc_initialized = false;
+#define gc_initialized (gc_current_heap->initialized)
+
+// Empty unless a collector needs the GC_BARRIERS_RANGE write barrier
+uintptr_t gc_barrier_range_start = 0;
+size_t gc_barrier_range_size = 0;
 
 void initialize_gc_if_needed(void) {
   if (gc_initialized) {
     return;
   }
-  gen0_initialize();
-  gen1_initialize();
+  gc_select_collector();
+  initialize_var_roots();
+  GC_DISPATCH(initialize)();
   gc_initialized = true;
+  export_initialize();
 }
 
 void *gc_alloc(size_t size_in_bytes) {
   initialize_gc_if_needed();
-  return gen0_alloc(size_in_bytes);
+  GC_TRACE_BEFORE_ALLOC();
+  void *result = GC_DISPATCH(alloc)(size_in_bytes);
+  GC_TRACE_RECORD_ALLOC(result, size_in_bytes);
+  GC_PROFILE_RECORD_ALLOC(result, size_in_bytes, 1);
+  return result;
+}
+
+size_t gc_alloc_many(size_t object_size, size_t count, void **block) {
+  initialize_gc_if_needed();
+  GC_TRACE_BEFORE_ALLOC();
+  size_t n_objects = GC_DISPATCH(alloc_many)(object_size, count, block);
+  GC_TRACE_RECORD_ALLOC_MANY(*block, object_size, count, n_objects);
+  GC_PROFILE_RECORD_ALLOC(*block, object_size, n_objects);
+  return n_objects;
 }
 
 void print_gc_roots(void) {
   initialize_gc_if_needed();
   printf("List of GC roots (%d elements):\n", var_roots_next_index);
-  for (int i = 0; i < var_roots_next_index; i++) {
-    printf("  %d. Root %p points at object %p\n", i + 1,
-           (void *)(void *)var_roots[i], (void *)*var_roots[i]);
+  int n = 0;
+  FOR_EACH_VAR_ROOT(segment, i) {
+    printf("  %d. Root %p points at object %p\n", ++n,
+           (void *)segment->roots[i], *segment->roots[i]);
   }
 }
 
-void print_gc_alloc_stats(void) { print_stats(); }
+void print_gc_alloc_stats(void) {
+  initialize_gc_if_needed();
+  printf("Collector:                       %s\n", gc_current_collector->name);
+  GC_DISPATCH(print_stats)();
+  print_image_stats();
+}
 
 void print_gc_state(void) {
   initialize_gc_if_needed();
-  printf("from-space: %p..%p\n", (void *)gen1_fromspace,
-         (void *)(gen1_fromspace + GEN1_SPACE_SIZE - 1));
-  printf("to-space: %p..%p\n", (void *)gen1_tospace,
-         (void *)(gen1_fromspace + GEN1_SPACE_SIZE - 1));
-  printf("alloc_ptr: %p\n", (void *)gen1_alloc_ptr);
-  size_t allocated_bytes = gen1_alloc_ptr - gen1_fromspace;
-  size_t free_bytes = GEN1_SPACE_SIZE - allocated_bytes;
-  printf("    allocated in from-space: %#zx bytes\n", allocated_bytes);
-  printf("    free in from-space:      %#zx bytes\n", free_bytes);
-  size_t allocated_in_tospace = gen1_next_ptr - gen1_tospace;
-  size_t free_in_tospace = GEN1_SPACE_SIZE - allocated_bytes;
-  printf("next_ptr: %p\n", (void *)gen1_next_ptr);
-  printf("    allocated in to-space:   %#zx bytes\n", allocated_in_tospace);
-  printf("    free in to-space:        %#zx bytes\n", free_in_tospace);
-  printf("scan_ptr: %p\n", (void *)gen1_scan_ptr);
-  printf("    left to scan:            %#zx bytes\n",
-         gen1_next_ptr - gen1_scan_ptr);
+  GC_DISPATCH(print_state)();
   print_gc_roots();
 }
 
-void gc_read_barrier(__attribute__((unused)) void *object,
-                     __attribute__((unused)) int field_index) {}
+void gc_collect(int generation) {
+  initialize_gc_if_needed();
+  GC_TRACE_RECORD_COLLECT(generation);
+  GC_DISPATCH(collect)(generation);
+}
+
+int gc_idle_hint(uint64_t budget_us) {
+  initialize_gc_if_needed();
+  GC_TRACE_RECORD_IDLE_HINT(budget_us);
+  return GC_DISPATCH(idle_hint)(budget_us * 1000);
+}
+
+void gc_pin(void *object) {
+  initialize_gc_if_needed();
+  GC_TRACE_RECORD_PIN(object);
+  pin_object(object);
+}
+
+void gc_unpin(void *object) {
+  GC_TRACE_RECORD_UNPIN(object);
+  unpin_object(object);
+}
+
+void gc_read_barrier(void *object, int field_index) {
+  GC_DISPATCH(read_barrier)(object, field_index);
+}
 
-void gc_write_barrier(__attribute__((unused)) void *object,
-                      __attribute__((unused)) int field_index,
-                      __attribute__((unused)) void *contents) {}
+void gc_write_barrier(void *object, int field_index, void *contents) {
+  if (points_to_loaded_image(object)) {
+    printf("Write into immutable object %p (field %d): heap images and "
+           "published regions are read-only\n",
+           object, field_index);
+    exit(1);
+  }
+  GC_TRACE_RECORD_WRITE(object, field_index, contents);
+  GC_DISPATCH(write_barrier)(object, field_index, contents);
+}
 
-void gc_push_root(void **ptr) { push_var_root(ptr); }
+void gc_push_root(void **ptr) {
+  initialize_gc_if_needed();
+  GC_DISPATCH(push_root)(ptr);
+  GC_TRACE_RECORD_PUSH_ROOT(ptr);
+}
 
-void gc_pop_root(void **ptr) { pop_var_root(ptr); }
+void gc_pop_root(void **ptr) {
+  GC_DISPATCH(pop_root)(ptr);
+  GC_TRACE_RECORD_POP_ROOT();
+}
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gc/collector.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+
+#define GC_COLLECTOR_ENV_VAR "STELLA_GC"
+
+static const struct gc_collector *const collectors[] = {
+    &generational_collector,
+    &semispace_collector,
+    &epsilon_collector,
+};
+
+#define N_COLLECTORS (sizeof(collectors) / sizeof(collectors[0]))
+
+#ifdef STELLA_GC_FIXED_COLLECTOR
+#define GC_STRINGIFY_(name) #name
+#define GC_STRINGIFY(name) GC_STRINGIFY_(name)
+static const char *DEFAULT_COLLECTOR = GC_STRINGIFY(STELLA_GC_FIXED_COLLECTOR);
+#else
+static const char *DEFAULT_COLLECTOR = "generational";
+#endif
+
+void gc_select_collector(void) {
+  const char *name = DEFAULT_COLLECTOR;
+#ifndef STELLA_GC_FIXED_COLLECTOR
+  const char *env_name = getenv(GC_COLLECTOR_ENV_VAR);
+  if (env_name != NULLPTR && env_name[0] != '\0') {
+    name = env_name;
+  }
+#endif
+  for (size_t i = 0; i < N_COLLECTORS; i++) {
+    if (strcmp(collectors[i]->name, name) == 0) {
+      gc_current_collector = collectors[i];
+      GC_DEBUG_PRINTF("gc_select_collector(): selected '%s'\n", name);
+      return;
+    }
+  }
+  printf("Unknown collector %s=%s, available collectors:", GC_COLLECTOR_ENV_VAR,
+         name);
+  for (size_t i = 0; i < N_COLLECTORS; i++) {
+    printf(" %s", collectors[i]->name);
+  }
+  printf("\n");
+  exit(1);
+}
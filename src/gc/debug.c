@@ -7,12 +7,14 @@
 
 #include "constants.h"
 #include "gc/forward_pointers.h"
+#include "gc/gen2.h"
 #include "gc/utils.h"
 #include "runtime_extras.h"
 
 static char *LOCATION_GEN0_SPACE = "GEN0-SPACE";
 static char *LOCATION_FROMSPACE = "FROM-SPACE";
 static char *LOCATION_TOSPACE = "TO-SPACE";
+static char *LOCATION_GEN2_SPACE = "GEN2-SPACE";
 static char *LOCATION_UNMANAGED_SPACE = "UNMANAGED SPACE";
 
 char *describe_object_location(stella_object *obj) {
@@ -22,6 +24,8 @@ char *describe_object_location(stella_object *obj) {
     return LOCATION_GEN0_SPACE;
   } else if (points_to_fromspace((void *)obj)) {
     return LOCATION_FROMSPACE;
+  } else if (gen2_enabled && points_to_gen2(obj)) {
+    return LOCATION_GEN2_SPACE;
   } else {
     assert(points_to_tospace((void *)obj));
     return LOCATION_TOSPACE;
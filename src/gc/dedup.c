@@ -0,0 +1,275 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gc/dedup.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/forward_pointers.h"
+#include "gc/nursery.h"
+#include "gc/pin.h"
+#include "gc/trace.h"
+#include "gc/utils.h"
+#include "runtime_extras.h"
+
+#define DEDUP_ENV_VAR "STELLA_GC_DEDUP"
+
+// Marks of the pass in the unused bits of the header (above the tag and the
+// fields count). They are cleared by the final pass over the space.
+#define DEDUP_VISITING (1 << 8)
+#define DEDUP_DONE (1 << 9)
+#define DEDUP_MARKS (DEDUP_VISITING | DEDUP_DONE)
+
+#define DEDUP_INITIAL_CAPACITY 1024
+
+#define dedup_space_start (gc_current_heap->dedup.space_start)
+#define dedup_space_end (gc_current_heap->dedup.space_end)
+#define dedup_n_objects (gc_current_heap->dedup.n_objects)
+#define dedup_n_bytes (gc_current_heap->dedup.n_bytes)
+#define dedup_total_ns (gc_current_heap->dedup.total_ns)
+
+// Objects on the path of the depth-first search, with the next field to visit
+struct dedup_frame {
+  stella_object *obj;
+  int next_field;
+  // A field points back to an object on the path, so the object is kept
+  bool in_cycle;
+};
+
+// Open addressing set of canonical objects, by contents
+struct dedup_table {
+  stella_object **slots;
+  size_t capacity;
+  size_t size;
+};
+
+struct dedup_stack {
+  struct dedup_frame *frames;
+  size_t capacity;
+  size_t size;
+};
+
+void dedup_initialize(void) {
+  const char *dedup = getenv(DEDUP_ENV_VAR);
+  dedup_enabled = dedup != NULLPTR && atoi(dedup) != 0;
+  GC_DEBUG_PRINTF("dedup_initialize(): enabled=%d\n", dedup_enabled);
+}
+
+static void *dedup_calloc(size_t count, size_t size) {
+  void *result = calloc(count, size);
+  if (result == NULLPTR) {
+    printf("Out of memory: could not allocate deduplication tables\n");
+    exit(1);
+  }
+  return result;
+}
+
+static bool in_space(stella_object *obj) {
+  return (uintptr_t)obj - (uintptr_t)dedup_space_start <
+         (uintptr_t)(dedup_space_end - dedup_space_start);
+}
+
+stella_object *dedup_canonical(stella_object *obj) {
+  if (in_space(obj)) {
+    // Only duplicates are forward pointers in to-space
+    stella_object *canonical = as_forward_ptr(obj);
+    if (canonical != NULLPTR) {
+      return canonical;
+    }
+  }
+  return obj;
+}
+
+static bool has_mark(stella_object *obj, int mark) {
+  return (obj->object_header & mark) != 0;
+}
+
+static int header_without_marks(stella_object *obj) {
+  return obj->object_header & ~DEDUP_MARKS;
+}
+
+static uint64_t hash_object(stella_object *obj) {
+  uint64_t hash = (uint64_t)header_without_marks(obj);
+  int n_fields = get_fields_count(obj);
+  for (int i = 0; i < n_fields; i++) {
+    hash = (hash ^ (uintptr_t)dedup_canonical(get_field(obj, i))) *
+           0x9E3779B97F4A7C15u;
+  }
+  return hash ^ (hash >> 29);
+}
+
+static bool same_contents(stella_object *obj1, stella_object *obj2) {
+  if (header_without_marks(obj1) != header_without_marks(obj2)) {
+    return false;
+  }
+  int n_fields = get_fields_count(obj1);
+  for (int i = 0; i < n_fields; i++) {
+    if (dedup_canonical(get_field(obj1, i)) !=
+        dedup_canonical(get_field(obj2, i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t table_slot(struct dedup_table *table, stella_object *obj,
+                         uint64_t hash) {
+  size_t slot = hash & (table->capacity - 1);
+  while (table->slots[slot] != NULLPTR &&
+         !same_contents(table->slots[slot], obj)) {
+    slot = (slot + 1) & (table->capacity - 1);
+  }
+  return slot;
+}
+
+static void table_grow(struct dedup_table *table) {
+  stella_object **old_slots = table->slots;
+  size_t old_capacity = table->capacity;
+  table->capacity = old_capacity * 2;
+  table->slots = dedup_calloc(table->capacity, sizeof(stella_object *));
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_slots[i] != NULLPTR) {
+      size_t slot = table_slot(table, old_slots[i], hash_object(old_slots[i]));
+      table->slots[slot] = old_slots[i];
+    }
+  }
+  free(old_slots);
+}
+
+static void stack_push(struct dedup_stack *stack, stella_object *obj) {
+  if (stack->size == stack->capacity) {
+    stack->capacity *= 2;
+    stack->frames =
+        realloc(stack->frames, stack->capacity * sizeof(struct dedup_frame));
+    if (stack->frames == NULLPTR) {
+      printf("Out of memory: could not grow the deduplication stack\n");
+      exit(1);
+    }
+  }
+  obj->object_header |= DEDUP_VISITING;
+  stack->frames[stack->size++] =
+      (struct dedup_frame){.obj = obj, .next_field = 0, .in_cycle = false};
+}
+
+// All fields of obj point to canonical objects or to objects outside of the
+// space. Either obj becomes a duplicate, or it is a new canonical object.
+static void finish_object(struct dedup_table *table, stella_object *obj,
+                          bool in_cycle) {
+  obj->object_header = (obj->object_header & ~DEDUP_VISITING) | DEDUP_DONE;
+  // A duplicate needs a field to hold the forward pointer, and pinned objects
+  // must stay where they are
+  if (get_tag(obj) == TAG_REF || get_tag(obj) == TAG_FILLER ||
+      get_fields_count(obj) == 0 || is_pinned(obj) || in_cycle) {
+    return;
+  }
+  if (2 * (table->size + 1) > table->capacity) {
+    table_grow(table);
+  }
+  size_t slot = table_slot(table, obj, hash_object(obj));
+  stella_object *canonical = table->slots[slot];
+  if (canonical == NULLPTR) {
+    table->slots[slot] = obj;
+    table->size++;
+    return;
+  }
+  GC_DEBUG_PRINTF("finish_object(%p): duplicate of %p\n", (void *)obj,
+                  (void *)canonical);
+  dedup_n_objects++;
+  dedup_n_bytes += gc_size_of_object(obj);
+  GC_TRACE_RECORD_MERGE(obj, canonical);
+  set_forward_ptr(obj, canonical);
+  // The rest of a duplicate must not keep other objects alive
+  int n_fields = get_fields_count(obj);
+  for (int i = 1; i < n_fields; i++) {
+    set_field(obj, i, NULLPTR);
+  }
+}
+
+// Depth-first search from obj, finishing objects after their fields
+static void dedup_object(struct dedup_table *table, struct dedup_stack *stack,
+                         stella_object *obj) {
+  stack_push(stack, obj);
+  while (stack->size > 0) {
+    struct dedup_frame *frame = &stack->frames[stack->size - 1];
+    stella_object *current = frame->obj;
+    int n_fields = get_fields_count(current);
+    stella_object *next = NULLPTR;
+    while (frame->next_field < n_fields && next == NULLPTR) {
+      stella_object *field = get_field(current, frame->next_field++);
+      if (!in_space(field) || has_mark(field, DEDUP_DONE)) {
+        continue;
+      }
+      if (has_mark(field, DEDUP_VISITING)) {
+        frame->in_cycle = true;
+        continue;
+      }
+      next = field;
+    }
+    if (next != NULLPTR) {
+      stack_push(stack, next);
+    } else {
+      stack->size--;
+      finish_object(table, current, frame->in_cycle);
+    }
+  }
+}
+
+// Redirects fields to canonical objects and clears the marks
+static void fix_space(uint8_t *start, uint8_t *end) {
+  uint8_t *cur_ptr = start;
+  while (cur_ptr < end) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(obj);
+    obj->object_header &= ~DEDUP_MARKS;
+    if (is_forward_ptr(obj)) {
+      continue;
+    }
+    int n_fields = get_fields_count(obj);
+    for (int i = 0; i < n_fields; i++) {
+      set_field(obj, i, dedup_canonical(get_field(obj, i)));
+    }
+  }
+  assert(cur_ptr == end);
+}
+
+void dedup_space(uint8_t *start, uint8_t *end) {
+  uint64_t start_ns = nursery_clock_ns();
+  dedup_space_start = start;
+  dedup_space_end = end;
+  struct dedup_table table = {
+      .slots = dedup_calloc(DEDUP_INITIAL_CAPACITY, sizeof(stella_object *)),
+      .capacity = DEDUP_INITIAL_CAPACITY,
+      .size = 0};
+  struct dedup_stack stack = {
+      .frames = dedup_calloc(DEDUP_INITIAL_CAPACITY,
+                             sizeof(struct dedup_frame)),
+      .capacity = DEDUP_INITIAL_CAPACITY,
+      .size = 0};
+  uint8_t *cur_ptr = start;
+  while (cur_ptr < end) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(obj);
+    if (!has_mark(obj, DEDUP_DONE)) {
+      dedup_object(&table, &stack, obj);
+    }
+  }
+  assert(cur_ptr == end);
+  fix_space(start, end);
+  free(table.slots);
+  free(stack.frames);
+  dedup_total_ns += nursery_clock_ns() - start_ns;
+  GC_DEBUG_PRINTF("dedup_space(%p, %p): %llu duplicates so far\n",
+                  (void *)start, (void *)end,
+                  (unsigned long long)dedup_n_objects);
+}
+
+void print_dedup_stats(void) {
+  printf("Deduplicated objects:            %'llu (%'llu bytes)\n",
+         (unsigned long long)dedup_n_objects,
+         (unsigned long long)dedup_n_bytes);
+  printf("    Deduplication time:          %'llu ns\n",
+         (unsigned long long)dedup_total_ns);
+}
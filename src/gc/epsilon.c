@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gc/collector.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/roots.h"
+#include "gc/space.h"
+
+// Objects are bump-allocated in chunks which are only freed together with
+// the heap
+#define EPSILON_CHUNK_SIZE ((size_t)MEGABYTE)
+
+#define epsilon_alloc_ptr (gc_current_heap->epsilon.alloc_ptr)
+#define epsilon_limit_ptr (gc_current_heap->epsilon.limit_ptr)
+#define epsilon_chunks (gc_current_heap->epsilon.chunks)
+
+#define epsilon_allocated_bytes (gc_current_heap->epsilon.allocated_bytes)
+#define epsilon_allocated_objects (gc_current_heap->epsilon.allocated_objects)
+#define epsilon_n_chunks (gc_current_heap->epsilon.n_chunks)
+
+void epsilon_initialize(void) {}
+
+// Chunks start with a link to the previous chunk and their size
+struct epsilon_chunk {
+  struct epsilon_chunk *next;
+  size_t size;
+};
+
+void epsilon_destroy(void) {
+  while (epsilon_chunks != NULLPTR) {
+    struct epsilon_chunk *chunk = epsilon_chunks;
+    epsilon_chunks = chunk->next;
+    space_free((uint8_t *)chunk, chunk->size);
+  }
+  epsilon_alloc_ptr = NULLPTR;
+  epsilon_limit_ptr = NULLPTR;
+}
+
+static void epsilon_reserve(size_t size_in_bytes) {
+  if ((size_t)(epsilon_limit_ptr - epsilon_alloc_ptr) < size_in_bytes) {
+    size_t chunk_size = size_in_bytes > EPSILON_CHUNK_SIZE ? size_in_bytes
+                                                           : EPSILON_CHUNK_SIZE;
+    size_t size = sizeof(struct epsilon_chunk) + chunk_size;
+    struct epsilon_chunk *chunk = (struct epsilon_chunk *)space_alloc(size);
+    chunk->next = epsilon_chunks;
+    chunk->size = size;
+    epsilon_chunks = chunk;
+    epsilon_alloc_ptr = (uint8_t *)(chunk + 1);
+    epsilon_limit_ptr = epsilon_alloc_ptr + chunk_size;
+    epsilon_n_chunks++;
+    GC_DEBUG_PRINTF("epsilon_alloc(%#zx): new chunk %p..%p\n", size_in_bytes,
+                    (void *)epsilon_alloc_ptr, (void *)epsilon_limit_ptr);
+  }
+}
+
+void *epsilon_alloc(size_t size_in_bytes) {
+  epsilon_reserve(size_in_bytes);
+  void *result = epsilon_alloc_ptr;
+  epsilon_alloc_ptr += size_in_bytes;
+  epsilon_allocated_bytes += size_in_bytes;
+  epsilon_allocated_objects++;
+  return result;
+}
+
+size_t epsilon_alloc_many(size_t object_size, size_t count, void **block) {
+  size_t size_in_bytes = object_size * count;
+  epsilon_reserve(size_in_bytes);
+  *block = epsilon_alloc_ptr;
+  epsilon_alloc_ptr += size_in_bytes;
+  epsilon_allocated_bytes += size_in_bytes;
+  epsilon_allocated_objects += count;
+  return count;
+}
+
+void epsilon_read_barrier(__attribute__((unused)) void *object,
+                          __attribute__((unused)) int field_index) {}
+
+void epsilon_write_barrier(__attribute__((unused)) void *object,
+                           __attribute__((unused)) int field_index,
+                           __attribute__((unused)) void *contents) {}
+
+void epsilon_push_root(void **root) { push_var_root(root); }
+
+void epsilon_pop_root(void **root) { pop_var_root(root); }
+
+void epsilon_collect(__attribute__((unused)) int generation) {}
+
+int epsilon_idle_hint(__attribute__((unused)) uint64_t budget_ns) {
+  return -1;
+}
+
+void epsilon_print_stats(void) {
+  printf("Total memory allocation:         %'zu bytes (%'llu objects)\n",
+         epsilon_allocated_bytes,
+         (unsigned long long)epsilon_allocated_objects);
+  printf("Maximum residency:               %'zu bytes\n",
+         epsilon_allocated_bytes);
+  printf("Allocated chunks:                %'llu\n",
+         (unsigned long long)epsilon_n_chunks);
+}
+
+void epsilon_print_state(void) {
+  printf("alloc_ptr: %p\n", (void *)epsilon_alloc_ptr);
+  printf("    free in current chunk:   %#zx bytes\n",
+         (size_t)(epsilon_limit_ptr - epsilon_alloc_ptr));
+}
+
+GC_DEFINE_COLLECTOR(epsilon);
@@ -0,0 +1,184 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "gc/export.h"
+
+#include "constants.h"
+#include "gc/collector.h"
+#include "gc/debug.h"
+#include "gc/heap.h"
+#include "gc/stats.h"
+
+#define EXPORT_ENV_VAR "STELLA_GC_EXPORT"
+#define EXPORT_PAGE_ENV_VAR "STELLA_GC_EXPORT_PAGE"
+#define EXPORT_FD_PREFIX "fd:"
+
+#define EXPORT_LINE_SIZE 2048
+
+// The export is shared by all heaps of the process
+static atomic_flag export_initialized = ATOMIC_FLAG_INIT;
+static int export_fd = -1;
+static struct gc_export_page *export_page = NULLPTR;
+// Held while the page is written. Writers which find it taken (another
+// thread, or a signal handler interrupting an update) skip their update.
+static atomic_flag export_page_lock = ATOMIC_FLAG_INIT;
+
+// Lines are formatted by hand, because snprintf is not async-signal-safe
+struct export_line {
+  char data[EXPORT_LINE_SIZE];
+  size_t length;
+};
+
+static void append_string(struct export_line *line, const char *string) {
+  while (*string != '\0' && line->length < EXPORT_LINE_SIZE) {
+    line->data[line->length++] = *string++;
+  }
+}
+
+static void append_u64(struct export_line *line, uint64_t value) {
+  char digits[20];
+  int n_digits = 0;
+  do {
+    digits[n_digits++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n_digits > 0 && line->length < EXPORT_LINE_SIZE) {
+    line->data[line->length++] = digits[--n_digits];
+  }
+}
+
+#define APPEND_SNAPSHOT_FIELD(name)                                            \
+  append_string(line, ",\"" #name "\":");                                      \
+  append_u64(line, snapshot->name);
+
+static void format_line(struct export_line *line, const char *event,
+                        const struct gc_stats_snapshot *snapshot) {
+  line->length = 0;
+  append_string(line, "{\"event\":\"");
+  append_string(line, event);
+  append_string(line, "\",\"pid\":");
+  append_u64(line, (uint64_t)getpid());
+  append_string(line, ",\"collector\":\"");
+  append_string(line, gc_current_collector->name);
+  append_string(line, "\"");
+  GC_STATS_SNAPSHOT_FIELDS(APPEND_SNAPSHOT_FIELD)
+  append_string(line, "}\n");
+}
+
+static void export_write_line(const char *event) {
+  if (export_fd < 0) {
+    return;
+  }
+  struct gc_stats_snapshot snapshot;
+  stats_snapshot(&snapshot);
+  struct export_line line;
+  format_line(&line, event, &snapshot);
+  size_t written = 0;
+  while (written < line.length) {
+    ssize_t n = write(export_fd, line.data + written, line.length - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    written += (size_t)n;
+  }
+}
+
+static void export_update_page(void) {
+  if (export_page == NULLPTR || atomic_flag_test_and_set(&export_page_lock)) {
+    return;
+  }
+  struct gc_stats_snapshot snapshot;
+  stats_snapshot(&snapshot);
+  atomic_fetch_add_explicit(&export_page->sequence, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  export_page->stats = snapshot;
+  export_page->n_updates++;
+  atomic_fetch_add_explicit(&export_page->sequence, 1, memory_order_release);
+  atomic_flag_clear(&export_page_lock);
+}
+
+static void export_on_signal(__attribute__((unused)) int signal_number) {
+  int saved_errno = errno;
+  export_write_line("signal");
+  export_update_page();
+  errno = saved_errno;
+}
+
+static void export_at_exit(void) {
+  export_write_line("exit");
+  export_update_page();
+}
+
+static int open_export_fd(const char *destination) {
+  size_t prefix_length = strlen(EXPORT_FD_PREFIX);
+  if (strncmp(destination, EXPORT_FD_PREFIX, prefix_length) == 0) {
+    return atoi(destination + prefix_length);
+  }
+  return open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+              0644);
+}
+
+static struct gc_export_page *map_export_page(const char *path) {
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return NULLPTR;
+  }
+  struct gc_export_page *page = NULLPTR;
+  if (ftruncate(fd, sizeof(struct gc_export_page)) == 0) {
+    void *mapping = mmap(NULLPTR, sizeof(struct gc_export_page),
+                         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    page = mapping != MAP_FAILED ? mapping : NULLPTR;
+  }
+  close(fd);
+  return page;
+}
+
+void export_initialize(void) {
+  if (atomic_flag_test_and_set(&export_initialized)) {
+    return;
+  }
+  const char *destination = getenv(EXPORT_ENV_VAR);
+  if (destination != NULLPTR) {
+    export_fd = open_export_fd(destination);
+    if (export_fd < 0) {
+      fprintf(stderr, "Could not open GC statistics export %s\n", destination);
+    }
+  }
+  const char *page_path = getenv(EXPORT_PAGE_ENV_VAR);
+  if (page_path != NULLPTR) {
+    export_page = map_export_page(page_path);
+    if (export_page == NULLPTR) {
+      fprintf(stderr, "Could not map GC statistics page %s\n", page_path);
+    } else {
+      memset(export_page, 0, sizeof(struct gc_export_page));
+      export_page->magic = GC_EXPORT_PAGE_MAGIC;
+      export_page->version = GC_EXPORT_PAGE_VERSION;
+      export_update_page();
+    }
+  }
+  if (export_fd < 0 && export_page == NULLPTR) {
+    return;
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = export_on_signal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGUSR1, &action, NULLPTR);
+  atexit(export_at_exit);
+  GC_DEBUG_PRINTF("export_initialize(): fd=%d, page=%p\n", export_fd,
+                  (void *)export_page);
+}
+
+void export_record_collection(void) { export_update_page(); }
@@ -13,14 +13,13 @@ stella_object *as_forward_ptr(stella_object *obj) {
     return NULLPTR;
   }
   assert(get_fields_count(obj) >= 1);
-  void *forward_ptr = obj->object_fields[0];
-  return (stella_object *)forward_ptr;
+  return get_field(obj, 0);
 }
 
 void set_forward_ptr(stella_object *obj, stella_object *new_location) {
   assert(get_fields_count(obj) >= 1);
   set_tag(obj, TAG_FORWARD_PTR);
-  obj->object_fields[0] = (void *)new_location;
+  set_field(obj, 0, new_location);
   // Verify
   stella_object *read_location = as_forward_ptr(obj);
   assert(read_location == new_location);
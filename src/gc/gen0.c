@@ -7,46 +7,159 @@
 
 #include "constants.h"
 #include "gc/debug.h"
+#include "gc/export.h"
 #include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/kernels.h"
+#include "gc/lifetime.h"
+#include "gc/nursery.h"
 #include "gc/parameters.h"
+#include "gc/perf.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
 #include "gc/roots.h"
+#include "gc/scheduler.h"
 #include "gc/stats.h"
+#include "gc/trace.h"
 #include "gc/utils.h"
 #include "runtime.h"
 #include "runtime_extras.h"
 
-bool gen0_gc_initialized = false;
+#define APPEL_NURSERY_ENV_VAR "STELLA_GC_APPEL_NURSERY"
 
-uint8_t *gen0_space = NULLPTR;
-
-uint8_t *gen0_alloc_ptr = NULLPTR;
-uint8_t *gen0_scan_ptr = NULLPTR;
+#define gen0_promoted_bytes (gc_current_heap->gen0.promoted_bytes)
+#define gen0_remembered_set_ns (gc_current_heap->gen0.remembered_set_ns)
 
 void gen0_initialize(void) {
   assert(!gen0_gc_initialized);
-  gen0_space = malloc(GEN0_SPACE_SIZE);
-  gen0_alloc_ptr = gen0_space;
-  GC_DEBUG_PRINTF("Initialized Gen0: GEN0_SPACE_SIZE=%#zx, gen0_space=%p, "
+  // Gen0 is placed into the region of Gen1
+  assert(gen1_gc_initialized);
+  const char *appel = getenv(APPEL_NURSERY_ENV_VAR);
+  gen0_in_tospace = appel != NULLPTR && atoi(appel) != 0;
+  nursery_initialize();
+  if (gen0_in_tospace) {
+    gen0_place_nursery();
+  } else {
+    gen0_space = gen1_region + GC_SLOT_SIZE;
+    gen0_space_size = GEN0_SPACE_SIZE;
+    gen0_alloc_ptr = gen0_space;
+    gen0_alloc_limit = gen0_space + GEN0_SPACE_SIZE;
+  }
+  GC_DEBUG_PRINTF("Initialized Gen0: gen0_space_size=%#zx, gen0_space=%p, "
                   "gen0_alloc_ptr=%p\n",
-                  GEN0_SPACE_SIZE, (void *)gen0_space, (void *)gen0_alloc_ptr);
+                  gen0_space_size, (void *)gen0_space, (void *)gen0_alloc_ptr);
   gen0_gc_initialized = true;
 }
 
+// The space is freed with the region of Gen1
+void gen0_destroy(void) {
+  gen0_space = NULLPTR;
+  gen0_alloc_ptr = NULLPTR;
+  gen0_alloc_limit = NULLPTR;
+  gen0_gc_initialized = false;
+}
+
+// Skips the pinned object at gen0_alloc_limit
+static void gen0_skip_pinned(void) {
+  gen0_alloc_ptr = pin_skip(gen0_alloc_ptr, gen0_alloc_limit);
+  gen0_alloc_limit = pin_limit(gen0_alloc_ptr, gen0_space + gen0_space_size);
+}
+
+// Pinned objects in the free part of from-space may leave gaps that promoted
+// objects can not use, so they are subtracted from the nursery
+void gen0_place_nursery(void) {
+  uint8_t *fromspace_end = gen1_fromspace + GEN1_SPACE_SIZE;
+  size_t free_bytes = fromspace_end - gen1_alloc_ptr;
+  size_t unusable_bytes = pin_unusable_bytes(gen1_alloc_ptr, fromspace_end);
+  size_t size = free_bytes > unusable_bytes ? free_bytes - unusable_bytes : 0;
+  gen0_space = gen1_tospace;
+  gen0_space_size = size / sizeof(void *) * sizeof(void *);
+  gen0_alloc_ptr = gen0_space;
+  gen0_alloc_limit = pin_limit(gen0_space, gen0_space + gen0_space_size);
+  if (!nursery_is_adaptive || gen0_limit_size > gen0_space_size) {
+    gen0_limit_size = gen0_space_size;
+  }
+  GC_DEBUG_PRINTF("gen0_place_nursery(): gen0_space=%p, gen0_space_size=%#zx\n",
+                  (void *)gen0_space, gen0_space_size);
+}
+
+// Allocates in the first space_size bytes of Gen0, around pinned objects
+static void *gen0_try_alloc_in(size_t space_size, size_t size_in_bytes) {
+  while (gen0_alloc_limit < gen0_space + space_size) {
+    void *result = try_alloc(gen0_space, gen0_alloc_limit - gen0_space,
+                             &gen0_alloc_ptr, size_in_bytes);
+    if (result != NULLPTR) {
+      return result;
+    }
+    gen0_skip_pinned();
+  }
+  return try_alloc(gen0_space, space_size, &gen0_alloc_ptr, size_in_bytes);
+}
+
+static size_t gen0_try_alloc_many_in(size_t space_size, size_t object_size,
+                                     size_t count, void **block) {
+  while (gen0_alloc_limit < gen0_space + space_size) {
+    size_t n_objects =
+        try_alloc_many(gen0_space, gen0_alloc_limit - gen0_space,
+                       &gen0_alloc_ptr, object_size, count, block);
+    if (n_objects > 0) {
+      return n_objects;
+    }
+    gen0_skip_pinned();
+  }
+  return try_alloc_many(gen0_space, space_size, &gen0_alloc_ptr, object_size,
+                        count, block);
+}
+
 void *gen0_try_alloc(size_t size_in_bytes) {
-  return try_alloc(gen0_space, GEN0_SPACE_SIZE, &gen0_alloc_ptr, size_in_bytes);
+  return gen0_try_alloc_in(gen0_limit_size, size_in_bytes);
 }
 
 static stella_object *move_object_to_gen1(stella_object *obj) {
   size_t size = gc_size_of_object(obj);
   void *new_location = gen1_alloc(size);
   copy_object(obj, new_location);
+  GC_LIFETIME_RECORD_MOVE(obj, new_location);
+  GC_TRACE_RECORD_MOVE(obj, new_location);
   set_forward_ptr(obj, new_location);
+  gen0_promoted_bytes += size;
   GC_DEBUG_PRINTF("move_object_to_gen1(%p): moved to %p\n", (void *)obj,
                   (void *)new_location);
   GC_DEBUG_PRINT_OBJECT(new_location);
   return new_location;
 }
 
+// Same as points_to_gen0_space, but inlined because it is checked for every
+// scanned field
+static bool is_in_gen0(void *ptr) {
+  return (uintptr_t)ptr - (uintptr_t)gen0_space < gen0_space_size;
+}
+
+// Routines per field count which return the last field of obj pointing to a
+// not yet moved Gen0 object
+#define GEN0_NOTE_NOT_MOVED_FIELD(obj, i)                                      \
+  if (is_in_gen0(get_field(obj, i)) && !is_forward_ptr(get_field(obj, i)) &&  \
+      !is_pinned(get_field(obj, i))) {                                         \
+    last_not_moved_field = get_field(obj, i);                                  \
+  }
+#define DEFINE_GEN0_LAST_NOT_MOVED_FIELD_KERNEL(n)                             \
+  static stella_object *gen0_last_not_moved_field_##n(                         \
+      stella_object *obj GC_KERNEL_UNUSED) {                                   \
+    stella_object *last_not_moved_field = NULLPTR;                             \
+    GC_REPEAT_##n(GEN0_NOTE_NOT_MOVED_FIELD, obj) return last_not_moved_field; \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_GEN0_LAST_NOT_MOVED_FIELD_KERNEL)
+
+#define GEN0_LAST_NOT_MOVED_FIELD_KERNEL(n) gen0_last_not_moved_field_##n,
+static stella_object *(
+    *const gen0_last_not_moved_field_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *) = {
+    GC_FOR_EACH_FIELDS_COUNT(GEN0_LAST_NOT_MOVED_FIELD_KERNEL)};
+
+static stella_object *gen0_last_not_moved_field(stella_object *obj) {
+  return gen0_last_not_moved_field_kernels[get_fields_count(obj)](obj);
+}
+
 static void gen0_chase(stella_object *obj) {
   stella_object *current_obj = obj;
   while (current_obj != NULLPTR) {
@@ -54,16 +167,7 @@ static void gen0_chase(stella_object *obj) {
                     (void *)current_obj);
     GC_DEBUG_PRINT_OBJECT(current_obj);
     stella_object *new_location = move_object_to_gen1(current_obj);
-    stella_object *last_not_moved_field = NULLPTR;
-    for (int i = 0; i < get_fields_count(new_location); i++) {
-      stella_object *field = new_location->object_fields[i];
-      bool needs_moving =
-          points_to_gen0_space((void *)field) && !is_forward_ptr(field);
-      if (needs_moving) {
-        last_not_moved_field = field;
-      }
-    }
-    current_obj = last_not_moved_field;
+    current_obj = gen0_last_not_moved_field(new_location);
   }
 }
 
@@ -76,6 +180,9 @@ static stella_object *gen0_forward(stella_object *obj) {
           (void *)obj, (void *)forward_ptr);
       return forward_ptr;
     }
+    if (is_pinned(obj)) {
+      return obj;
+    }
     GC_DEBUG_PRINTF("gen0_forward(%p): start chasing\n", (void *)obj);
     gen0_chase(obj);
     forward_ptr = as_forward_ptr(obj);
@@ -96,44 +203,70 @@ static stella_object *gen0_forward(stella_object *obj) {
 static void gen0_forward_var_roots(void) {
   GC_DEBUG_PRINTF("gen0_forward_var_roots(): Forwarding %d roots\n",
                   var_roots_next_index);
-  for (int i = 0; i < var_roots_next_index; i++) {
-    stella_object **root = (stella_object **)var_roots[i];
-    GC_DEBUG_PRINTF("gen0_forward_var_roots(): Forwarding %d-th root %p which "
-                    "points at object %p\n",
-                    i, (void *)root, (void *)*root);
+  FOR_EACH_VAR_ROOT(segment, i) {
+    stella_object **root = (stella_object **)segment->roots[i];
+    GC_DEBUG_PRINTF("gen0_forward_var_roots(): Forwarding root %p which points "
+                    "at object %p\n",
+                    (void *)root, (void *)*root);
     GC_DEBUG_PRINT_OBJECT(*root);
     *root = gen0_forward(*root);
   }
 }
 
 static void gen0_forward_roots_from_gen1(void) {
+  uint64_t start_ns = nursery_is_adaptive ? nursery_clock_ns() : 0;
   scan_gen1_for_roots_to_gen0();
+  if (nursery_is_adaptive) {
+    gen0_remembered_set_ns = nursery_clock_ns() - start_ns;
+  }
   GC_DEBUG_PRINTF("gen0_forward_roots_from_gen1(): Forwarding %d roots\n",
                   roots_from_gen1_to_gen0_next_index);
   // Here we use the 'roots_from_gen1_to_gen0_next_index' global variable
   // because it can be reset by Gen1 GC on collect
   while (roots_from_gen1_to_gen0_next_index > 0) {
     int i = --roots_from_gen1_to_gen0_next_index;
-    stella_object **root = (stella_object **)roots_from_gen1_to_gen0[i];
+    gc_ref *root = roots_from_gen1_to_gen0[i];
+    stella_object *obj = gc_ref_decode(*root);
     GC_DEBUG_PRINTF("gen0_forward_roots_from_gen1(): Forwarding %d-th root %p "
                     "which points at object %p\n",
-                    i, (void *)root, (void *)*root);
+                    i, (void *)root, (void *)obj);
     assert(!points_to_tospace((void *)root));
-    GC_DEBUG_PRINT_OBJECT(*root);
-    *root = gen0_forward(*root);
+    GC_DEBUG_PRINT_OBJECT(obj);
+    *root = gc_ref_encode(gen0_forward(obj));
   }
 }
 
-static void gen0_forward_fields(stella_object *obj) {
-  for (int i = 0; i < get_fields_count(obj); i++) {
-    stella_object *field = obj->object_fields[i];
-    GC_DEBUG_PRINTF("gen0_forward_fields(%p): forwarding %d-th field %p\n",
-                    (void *)obj, i, (void *)field);
-    stella_object *forwarded_field = gen0_forward(field);
-    obj->object_fields[i] = forwarded_field;
-    GC_DEBUG_PRINTF("gen0_forward_fields(%p): Updated %d-th field %p -> %p\n",
-                    (void *)obj, i, (void *)field, (void *)forwarded_field);
+static void gen0_forward_field(stella_object *obj, int i) {
+  stella_object *field = get_field(obj, i);
+  GC_DEBUG_PRINTF("gen0_forward_fields(%p): forwarding %d-th field %p\n",
+                  (void *)obj, i, (void *)field);
+  stella_object *forwarded_field = gen0_forward(field);
+  // obj may be a Gen2 object
+  set_field_relaxed(obj, i, forwarded_field);
+  GC_DEBUG_PRINTF("gen0_forward_fields(%p): Updated %d-th field %p -> %p\n",
+                  (void *)obj, i, (void *)field, (void *)forwarded_field);
+}
+
+// Only fields pointing into Gen0 need forwarding, the rest are skipped by the
+// scan routine of the field count
+#define GEN0_FORWARD_FIELD_IF_NEEDED(obj, i)                                   \
+  if (is_in_gen0(get_field(obj, i))) {                                         \
+    gen0_forward_field(obj, i);                                                \
   }
+#define DEFINE_GEN0_FORWARD_FIELDS_KERNEL(n)                                   \
+  static void gen0_forward_fields_##n(                                         \
+      stella_object *obj GC_KERNEL_UNUSED) {                                   \
+    GC_REPEAT_##n(GEN0_FORWARD_FIELD_IF_NEEDED, obj)                           \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_GEN0_FORWARD_FIELDS_KERNEL)
+
+#define GEN0_FORWARD_FIELDS_KERNEL(n) gen0_forward_fields_##n,
+static void (*const gen0_forward_fields_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *) = {
+    GC_FOR_EACH_FIELDS_COUNT(GEN0_FORWARD_FIELDS_KERNEL)};
+
+static void gen0_forward_fields(stella_object *obj) {
+  gen0_forward_fields_kernels[get_fields_count(obj)](obj);
 }
 
 static void gen0_scan(void) {
@@ -147,24 +280,59 @@ static void gen0_scan(void) {
     GC_DEBUG_PRINTF("gen0_scan(): Forwarding fields of object at %p\n",
                     (void *)current_obj);
     GC_DEBUG_PRINT_OBJECT(current_obj);
-    gen0_forward_fields(current_obj);
+    // Moved past the object first: a Gen1 collection nested in forwarding
+    // its fields restarts the scan at the beginning of the new from-space,
+    // where the copy of the object is scanned again
     gen0_scan_ptr += gc_size_of_object(current_obj);
+    gen0_forward_fields(current_obj);
   }
 }
 
 void gen0_collect(void) {
+  uint64_t start_ns = nursery_is_adaptive ? nursery_clock_ns() : 0;
+  size_t used_bytes = gen0_alloc_ptr - gen0_space;
+  gen0_promoted_bytes = 0;
+  gen0_remembered_set_ns = 0;
   gen0_scan_ptr = gen1_alloc_ptr;
   GC_DEBUG_PRINTF(">>>> gen0_collect(): Start: gen0_space=%p, "
                   "gen0_next_ptr(i.e. gen1_alloc_ptr)=%p, gen0_scan_ptr=%p\n",
                   (void *)gen0_space, (void *)gen1_alloc_ptr,
                   (void *)gen0_scan_ptr);
   stats_record_collect(0);
+  pin_release_unpinned_gen0(gen0_space, gen0_space_size);
   // Copy reachable objects
+  GC_PERF_PHASE_BEGIN(0, GC_PHASE_ROOTS);
   gen0_forward_var_roots();
+  pin_for_each(gen0_forward_fields);
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(0, GC_PHASE_REMEMBERED_SET);
   gen0_forward_roots_from_gen1();
+  gen2_for_each_root(gen0_forward_fields);
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(0, GC_PHASE_SCAN);
   gen0_scan();
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(0, GC_PHASE_FLIP);
   gen0_scan_ptr = NULLPTR;
-  gen0_alloc_ptr = gen0_space;
+  pin_forget_released();
+  GC_LIFETIME_RECORD_DEATHS(gen0_space, gen0_space + used_bytes);
+  GC_PROFILE_RECORD_DEATHS(gen0_space, gen0_space + used_bytes);
+  if (gen0_in_tospace) {
+    gen0_place_nursery();
+  } else {
+    gen0_alloc_ptr = gen0_space;
+    gen0_alloc_limit = pin_limit(gen0_space, gen0_space + GEN0_SPACE_SIZE);
+  }
+  gen2_prune_remembered();
+  GC_PERF_PHASE_END();
+  stats_record_copied_bytes(gen0_promoted_bytes);
+  scheduler_record_promotion(used_bytes, gen0_promoted_bytes);
+  if (nursery_is_adaptive) {
+    nursery_record_collect(nursery_clock_ns() - start_ns,
+                           gen0_remembered_set_ns, used_bytes,
+                           gen0_promoted_bytes);
+  }
+  export_record_collection();
   GC_DEBUG_PRINTF(
       "<<<< gen0_collect(): End: gen0_space=%p, gen1_alloc_ptr=%p\n",
       (void *)gen0_space, (void *)gen1_alloc_ptr);
@@ -177,7 +345,7 @@ void *gen0_alloc(size_t size_in_bytes) {
   GC_DEBUG_PRINTF("gen0_alloc(%#zx): Starting collection because "
                   "STELLA_GC_MOVE_ALWAYS=ON\n",
                   size_in_bytes);
-  gen0_collect();
+  scheduler_collect();
 #else
   result = gen0_try_alloc(size_in_bytes);
   if (result != NULLPTR) {
@@ -186,13 +354,74 @@ void *gen0_alloc(size_t size_in_bytes) {
   GC_DEBUG_PRINTF("gen0_alloc(%#zx): Starting collection because there is not "
                   "enough space for object\n",
                   size_in_bytes);
-  gen0_collect();
+  scheduler_collect();
 #endif
   result = gen0_try_alloc(size_in_bytes);
   if (result != NULLPTR) {
     return result;
   }
+  // The object may not fit into the current limit of an adaptive nursery,
+  // but still fit into the reserved space
+  result = gen0_try_alloc_in(gen0_space_size, size_in_bytes);
+  if (result != NULLPTR) {
+    return result;
+  }
+  // A nursery in to-space grows back with a major collection
+  if (gen0_in_tospace) {
+    scheduler_collect_generation(1);
+    result = gen0_try_alloc_in(gen0_space_size, size_in_bytes);
+    if (result != NULLPTR) {
+      return result;
+    }
+  }
   printf("Out of memory: could not allocate %zx bytes in Gen0\n",
          size_in_bytes);
   exit(1);
 }
+
+size_t gen0_alloc_many(size_t object_size, size_t count, void **block) {
+  GC_DEBUG_PRINTF("gen0_alloc_many(%#zx, %zu)\n", object_size, count);
+  size_t n_objects;
+#ifdef STELLA_GC_MOVE_ALWAYS
+  scheduler_collect();
+#else
+  // Only the bytes up to the next pinned object are known to be free
+  uint8_t *free_end = gen0_space + gen0_limit_size < gen0_alloc_limit
+                          ? gen0_space + gen0_limit_size
+                          : gen0_alloc_limit;
+  size_t free_bytes =
+      free_end > gen0_alloc_ptr ? (size_t)(free_end - gen0_alloc_ptr) : 0;
+  // Collect up front only if the whole block fits into an empty nursery or
+  // nothing fits now. Otherwise the rest of the nursery is used, and the
+  // caller asks again for the remaining objects.
+  bool fits_after_collect = object_size * count <= gen0_limit_size;
+  if (free_bytes < object_size * count &&
+      (fits_after_collect || free_bytes < object_size)) {
+    GC_DEBUG_PRINTF("gen0_alloc_many(%#zx, %zu): Starting collection because "
+                    "there is not enough space for objects\n",
+                    object_size, count);
+    scheduler_collect();
+  }
+#endif
+  n_objects =
+      gen0_try_alloc_many_in(gen0_limit_size, object_size, count, block);
+  if (n_objects > 0) {
+    return n_objects;
+  }
+  n_objects =
+      gen0_try_alloc_many_in(gen0_space_size, object_size, count, block);
+  if (n_objects > 0) {
+    return n_objects;
+  }
+  if (gen0_in_tospace) {
+    scheduler_collect_generation(1);
+    n_objects =
+        gen0_try_alloc_many_in(gen0_space_size, object_size, count, block);
+    if (n_objects > 0) {
+      return n_objects;
+    }
+  }
+  printf("Out of memory: could not allocate %zx bytes in Gen0\n",
+         object_size);
+  exit(1);
+}
@@ -9,34 +9,43 @@
 
 #include "gc/gen0.h"
 #include "gc/gen1.h"
+#include "gc/gen2.h"
 
 #include "constants.h"
 #include "gc/debug.h"
+#include "gc/dedup.h"
+#include "gc/export.h"
 #include "gc/forward_pointers.h"
+#include "gc/kernels.h"
+#include "gc/lifetime.h"
 #include "gc/parameters.h"
+#include "gc/perf.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
 #include "gc/roots.h"
+#include "gc/space.h"
 #include "gc/stats.h"
+#include "gc/trace.h"
 #include "gc/utils.h"
 #include "runtime_extras.h"
 
 // ------------------------------------
 // --- GC State
 
-bool gen1_gc_initialized = false;
-
-uint8_t *gen1_fromspace = NULLPTR;
-uint8_t *gen1_tospace = NULLPTR;
-
-uint8_t *gen1_alloc_ptr = NULLPTR;
-uint8_t *gen1_next_ptr = NULLPTR;
-uint8_t *gen1_scan_ptr = NULLPTR;
+#define gen1_full_collection (gc_current_heap->gen1.full_collection)
+#define gen1_copied_bytes (gc_current_heap->gen1.copied_bytes)
+#define gen1_evacuated_start (gc_current_heap->gen1.evacuated_start)
+#define gen1_evacuated_size (gc_current_heap->gen1.evacuated_size)
 
 void gen1_initialize(void) {
   assert(!gen1_gc_initialized);
-  uint8_t *total_heap = malloc(2 * GEN1_SPACE_SIZE);
-  gen1_fromspace = (void *)(total_heap);
-  gen1_tospace = (void *)(total_heap + GEN1_SPACE_SIZE);
+  // Gen0 takes the slot between the semispaces
+  gen1_region = space_alloc_aligned(GC_REGION_SIZE, GC_SLOT_SIZE);
+  gen1_fromspace = gen1_region;
+  gen1_tospace = gen1_region + 2 * GC_SLOT_SIZE;
   gen1_alloc_ptr = gen1_fromspace;
+  gen1_alloc_limit = gen1_fromspace + GEN1_SPACE_SIZE;
+  dedup_initialize();
   GC_DEBUG_PRINTF("Initialized Gen1 with GEN1_SPACE_SIZE=%#zx, from_space=%p, "
                   "to_space=%p\n",
                   GEN1_SPACE_SIZE, (void *)gen1_fromspace,
@@ -44,22 +53,136 @@ void gen1_initialize(void) {
   gen1_gc_initialized = true;
 }
 
+void gen1_destroy(void) {
+  lifetime_destroy();
+  space_free_aligned(gen1_region, GC_REGION_SIZE);
+  gen1_region = NULLPTR;
+  gen1_fromspace = NULLPTR;
+  gen1_tospace = NULLPTR;
+  gen1_alloc_ptr = NULLPTR;
+  gen1_alloc_limit = NULLPTR;
+  gen1_next_limit = NULLPTR;
+  gen1_gc_initialized = false;
+}
+
+// Skips the pinned object at gen1_alloc_limit
+static void gen1_skip_pinned(void) {
+  gen1_alloc_ptr = pin_skip(gen1_alloc_ptr, gen1_alloc_limit);
+  gen1_alloc_limit =
+      pin_limit(gen1_alloc_ptr, gen1_fromspace + GEN1_SPACE_SIZE);
+}
+
 static void *gen1_try_alloc(size_t size_in_bytes) {
+  while (gen1_alloc_limit < gen1_fromspace + GEN1_SPACE_SIZE) {
+    void *result = try_alloc(gen1_fromspace, gen1_alloc_limit - gen1_fromspace,
+                             &gen1_alloc_ptr, size_in_bytes);
+    if (result != NULLPTR) {
+      return result;
+    }
+    gen1_skip_pinned();
+  }
   return try_alloc(gen1_fromspace, GEN1_SPACE_SIZE, &gen1_alloc_ptr,
                    size_in_bytes);
 }
 
+static size_t gen1_try_alloc_many(size_t object_size, size_t count,
+                                  void **block) {
+  while (gen1_alloc_limit < gen1_fromspace + GEN1_SPACE_SIZE) {
+    size_t n_objects =
+        try_alloc_many(gen1_fromspace, gen1_alloc_limit - gen1_fromspace,
+                       &gen1_alloc_ptr, object_size, count, block);
+    if (n_objects > 0) {
+      return n_objects;
+    }
+    gen1_skip_pinned();
+  }
+  return try_alloc_many(gen1_fromspace, GEN1_SPACE_SIZE, &gen1_alloc_ptr,
+                        object_size, count, block);
+}
+
+// Same as points_to_fromspace, or points_to_gen0_space in a full-heap
+// collection, but a single compare because it is checked for every scanned
+// field
+static bool is_evacuated(void *ptr) {
+  return (uintptr_t)ptr - (uintptr_t)gen1_evacuated_start <
+         gen1_evacuated_size;
+}
+
+// Skips the pinned objects of to-space in the way of an object of size bytes.
+// Live objects of from-space always fit into to-space, but together with Gen0
+// survivors or pinned objects they might not.
+static void make_room_in_tospace(size_t size) {
+  uint8_t *tospace_end = gen1_tospace + GEN1_SPACE_SIZE;
+  while (gen1_next_limit < tospace_end &&
+         gen1_next_ptr + size > gen1_next_limit) {
+    gen1_next_ptr = pin_skip(gen1_next_ptr, gen1_next_limit);
+    gen1_next_limit = pin_limit(gen1_next_ptr, tospace_end);
+  }
+  if (gen1_next_ptr + size > gen1_next_limit) {
+    printf("Out of memory: could not evacuate %zx bytes to Gen1 to-space\n",
+           size);
+    exit(1);
+  }
+}
+
+// Objects of from-space age with every Gen1 collection they survive and are
+// tenured at the tenure age, but not while a Gen0 collection is pending,
+// because it only rescans Gen1 for its roots
 static stella_object *move_object(stella_object *obj) {
+  int age = 0;
+  if (gen2_enabled && points_to_fromspace((uint8_t *)obj)) {
+    age = gen2_age(obj) < gen2_tenure_age ? gen2_age(obj) + 1
+                                          : gen2_tenure_age;
+    if (age == gen2_tenure_age && gen0_scan_ptr == NULLPTR) {
+      stella_object *tenured = gen2_tenure(obj);
+      if (tenured != NULLPTR) {
+        return tenured;
+      }
+    }
+  }
+  if (gen1_next_ptr + gc_size_of_object(obj) > gen1_next_limit) {
+    make_room_in_tospace(gc_size_of_object(obj));
+  }
   void *new_location = gen1_next_ptr;
   size_t obj_size = copy_object(obj, new_location);
+  GC_LIFETIME_RECORD_MOVE(obj, new_location);
+  GC_TRACE_RECORD_MOVE(obj, new_location);
   set_forward_ptr(obj, new_location);
+  if (age != 0) {
+    gen2_set_age(new_location, age);
+  }
   gen1_next_ptr += obj_size;
+  gen1_copied_bytes += obj_size;
   GC_DEBUG_PRINTF("move_object(%p): moved to %p, next_ptr=%p\n", (void *)obj,
                   (void *)new_location, (void *)gen1_next_ptr);
   GC_DEBUG_PRINT_OBJECT(new_location);
   return new_location;
 }
 
+// Routines per field count which return the last field of obj pointing to a
+// not yet moved evacuated object
+#define NOTE_NOT_MOVED_FIELD(obj, i)                                           \
+  if (is_evacuated(get_field(obj, i)) && !is_forward_ptr(get_field(obj, i)) && \
+      !is_pinned(get_field(obj, i))) {                                         \
+    last_not_moved_field = get_field(obj, i);                                  \
+  }
+#define DEFINE_LAST_NOT_MOVED_FIELD_KERNEL(n)                                  \
+  static stella_object *last_not_moved_field_##n(                              \
+      stella_object *obj GC_KERNEL_UNUSED) {                                   \
+    stella_object *last_not_moved_field = NULLPTR;                             \
+    GC_REPEAT_##n(NOTE_NOT_MOVED_FIELD, obj) return last_not_moved_field;      \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_LAST_NOT_MOVED_FIELD_KERNEL)
+
+#define LAST_NOT_MOVED_FIELD_KERNEL(n) last_not_moved_field_##n,
+static stella_object *(
+    *const last_not_moved_field_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *) = {GC_FOR_EACH_FIELDS_COUNT(LAST_NOT_MOVED_FIELD_KERNEL)};
+
+static stella_object *last_not_moved_field(stella_object *obj) {
+  return last_not_moved_field_kernels[get_fields_count(obj)](obj);
+}
+
 static void chase(stella_object *obj) {
   stella_object *current_obj = obj;
   while (current_obj != NULLPTR) {
@@ -67,21 +190,12 @@ static void chase(stella_object *obj) {
                     (void *)current_obj);
     GC_DEBUG_PRINT_OBJECT(current_obj);
     stella_object *new_location = move_object(current_obj);
-    stella_object *last_not_moved_field = NULLPTR;
-    for (int i = 0; i < get_fields_count(new_location); i++) {
-      stella_object *field = new_location->object_fields[i];
-      bool needs_moving =
-          points_to_fromspace((void *)field) && !is_forward_ptr(field);
-      if (needs_moving) {
-        last_not_moved_field = field;
-      }
-    }
-    current_obj = last_not_moved_field;
+    current_obj = last_not_moved_field(new_location);
   }
 }
 
 static stella_object *gen1_forward(stella_object *obj) {
-  if (points_to_fromspace((void *)obj)) {
+  if (is_evacuated((void *)obj)) {
     stella_object *forward_ptr = as_forward_ptr(obj);
     if (forward_ptr != NULLPTR) {
       GC_DEBUG_PRINTF(
@@ -89,18 +203,25 @@ static stella_object *gen1_forward(stella_object *obj) {
           (void *)obj, (void *)forward_ptr);
       return forward_ptr;
     }
+    if (is_pinned(obj)) {
+      return obj;
+    }
     GC_DEBUG_PRINTF("gen1_forward(%p): start chasing\n", (void *)obj);
     chase(obj);
     forward_ptr = as_forward_ptr(obj);
     assert(forward_ptr != NULLPTR);
-    assert(points_to_tospace((void *)forward_ptr));
+    assert(points_to_tospace((void *)forward_ptr) ||
+           points_to_gen2(forward_ptr));
     GC_DEBUG_PRINTF("gen1_forward(%p): finished chasing, return %p\n",
                     (void *)obj, (void *)forward_ptr);
     return forward_ptr;
   } else {
+    if (gen2_marking && points_to_gen2(obj)) {
+      gen2_mark(obj);
+    }
     GC_DEBUG_PRINTF(
         "gen1_forward(%p): immediately return %p, because the object is "
-        "not in from-space\n",
+        "not evacuated\n",
         (void *)obj, (void *)obj);
     return obj;
   }
@@ -109,11 +230,11 @@ static stella_object *gen1_forward(stella_object *obj) {
 static void gen1_forward_var_roots(void) {
   GC_DEBUG_PRINTF("gen1_forward_var_roots(): Forwarding %d roots\n",
                   var_roots_next_index);
-  for (int i = 0; i < var_roots_next_index; i++) {
-    stella_object **root = (stella_object **)var_roots[i];
-    GC_DEBUG_PRINTF("gen1_forward_var_roots(): Forwarding %d-th root %p which "
-                    "points at object %p\n",
-                    i, (void *)root, (void *)*root);
+  FOR_EACH_VAR_ROOT(segment, i) {
+    stella_object **root = (stella_object **)segment->roots[i];
+    GC_DEBUG_PRINTF("gen1_forward_var_roots(): Forwarding root %p which points "
+                    "at object %p\n",
+                    (void *)root, (void *)*root);
     GC_DEBUG_PRINT_OBJECT(*root);
     *root = gen1_forward(*root);
   }
@@ -122,24 +243,67 @@ static void gen1_forward_var_roots(void) {
 static void gen1_forward_roots_from_gen0(void) {
   scan_gen0_for_roots_to_gen1();
   for (int i = 0; i < roots_from_gen0_to_gen1_next_index; i++) {
-    stella_object **root = (stella_object **)roots_from_gen0_to_gen1[i];
+    gc_ref *root = roots_from_gen0_to_gen1[i];
+    stella_object *obj = gc_ref_decode(*root);
     GC_DEBUG_PRINTF("gen1_forward_roots_from_gen0(): Forwarding %d-th root %p "
                     "which points at object %p\n",
-                    i, (void *)root, (void *)*root);
-    GC_DEBUG_PRINT_OBJECT(*root);
-    *root = gen1_forward(*root);
+                    i, (void *)root, (void *)obj);
+    GC_DEBUG_PRINT_OBJECT(obj);
+    *root = gc_ref_encode(gen1_forward(obj));
   }
 }
 
+static void forward_field(stella_object *obj, int i) {
+  stella_object *field = get_field(obj, i);
+  GC_DEBUG_PRINTF("forward_fields(%p): forwarding %d-th field %p\n",
+                  (void *)obj, i, (void *)field);
+  stella_object *forwarded_field = gen1_forward(field);
+  // obj may be a Gen2 object
+  set_field_relaxed(obj, i, forwarded_field);
+  GC_DEBUG_PRINTF("forward_fields(%p): Updated %d-th field %p -> %p\n",
+                  (void *)obj, i, (void *)field, (void *)forwarded_field);
+}
+
+// Only fields pointing to evacuated objects need forwarding, the rest are
+// skipped by the scan routine of the field count
+#define FORWARD_FIELD_IF_EVACUATED(obj, i)                                     \
+  if (is_evacuated(get_field(obj, i))) {                                       \
+    forward_field(obj, i);                                                     \
+  }
+#define DEFINE_FORWARD_FIELDS_KERNEL(n)                                        \
+  static void forward_fields_##n(                                              \
+      stella_object *obj GC_KERNEL_UNUSED) {                                   \
+    GC_REPEAT_##n(FORWARD_FIELD_IF_EVACUATED, obj)                             \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_FORWARD_FIELDS_KERNEL)
+
+#define FORWARD_FIELDS_KERNEL(n) forward_fields_##n,
+static void (*const forward_fields_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *) = {GC_FOR_EACH_FIELDS_COUNT(FORWARD_FIELDS_KERNEL)};
+
+// While Gen2 is marked, fields pointing into Gen2 are visited as well
+#define FORWARD_OR_MARK_FIELD(obj, i)                                          \
+  if (is_evacuated(get_field(obj, i)) ||                                       \
+      points_to_gen2(get_field(obj, i))) {                                     \
+    forward_field(obj, i);                                                     \
+  }
+#define DEFINE_FORWARD_OR_MARK_FIELDS_KERNEL(n)                                \
+  static void forward_or_mark_fields_##n(                                      \
+      stella_object *obj GC_KERNEL_UNUSED) {                                   \
+    GC_REPEAT_##n(FORWARD_OR_MARK_FIELD, obj)                                  \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_FORWARD_OR_MARK_FIELDS_KERNEL)
+
+#define FORWARD_OR_MARK_FIELDS_KERNEL(n) forward_or_mark_fields_##n,
+static void (*const forward_or_mark_fields_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *) = {
+    GC_FOR_EACH_FIELDS_COUNT(FORWARD_OR_MARK_FIELDS_KERNEL)};
+
 static void forward_fields(stella_object *obj) {
-  for (int i = 0; i < get_fields_count(obj); i++) {
-    stella_object *field = obj->object_fields[i];
-    GC_DEBUG_PRINTF("forward_fields(%p): forwarding %d-th field %p\n",
-                    (void *)obj, i, (void *)field);
-    stella_object *forwarded_field = gen1_forward(field);
-    obj->object_fields[i] = forwarded_field;
-    GC_DEBUG_PRINTF("forward_fields(%p): Updated %d-th field %p -> %p\n",
-                    (void *)obj, i, (void *)field, (void *)forwarded_field);
+  if (gen2_marking) {
+    forward_or_mark_fields_kernels[get_fields_count(obj)](obj);
+  } else {
+    forward_fields_kernels[get_fields_count(obj)](obj);
   }
 }
 
@@ -156,37 +320,208 @@ static void scan_tospace(void) {
   }
 }
 
-void gen1_collect(void) {
+// Tenured and marked Gen2 objects are queued instead of scanned in place
+static void scan_survivors(void) {
+  do {
+    scan_tospace();
+  } while (gen2_scan_queue(forward_fields));
+}
+
+// Merges duplicates among the survivors and redirects the roots to the
+// canonical copies. Skipped while a Gen0 collection is pending, because Gen0
+// may still hold pointers to objects it has just promoted.
+static void dedup_fields(stella_object *obj) {
+  int n_fields = get_fields_count(obj);
+  for (int i = 0; i < n_fields; i++) {
+    set_field_relaxed(obj, i, dedup_canonical(get_field(obj, i)));
+  }
+}
+
+static void dedup_tospace(void) {
+  if (gen0_scan_ptr != NULLPTR) {
+    return;
+  }
+  dedup_space(gen1_tospace, gen1_next_ptr);
+  FOR_EACH_VAR_ROOT(segment, i) {
+    stella_object **root = (stella_object **)segment->roots[i];
+    *root = dedup_canonical(*root);
+  }
+  // Pinned objects outside of to-space and Gen2 objects stay where they are
+  pin_for_each(dedup_fields);
+  gen2_for_each_root(dedup_fields);
+  if (!gen1_full_collection) {
+    for (int i = 0; i < roots_from_gen0_to_gen1_next_index; i++) {
+      gc_ref *root = roots_from_gen0_to_gen1[i];
+      *root = gc_ref_encode(dedup_canonical(gc_ref_decode(*root)));
+    }
+  }
+}
+
+// Gen2 can only be collected when Gen0 holds no objects but pinned ones,
+// which are roots anyway
+static void collect_fromspace(bool collect_gen2) {
   GC_DEBUG_PRINTF(
       ">>>> gen1_collect(): Start: fromspace=%p, tospace=%p, alloc_ptr=%p\n",
       (void *)gen1_fromspace, (void *)gen1_tospace, (void *)gen1_alloc_ptr);
+  // The nursery of the Appel layout is sized so that this never happens
+  if (gen0_gc_initialized && gen0_in_tospace && gen0_scan_ptr != NULLPTR) {
+    printf("Out of memory: Gen1 is full during a Gen0 collection\n");
+    exit(1);
+  }
   stats_record_collect(1);
   // Prepare
+  pin_release_unpinned(gen1_fromspace, GEN1_SPACE_SIZE);
+  gen1_evacuated_start = gen1_fromspace;
+  gen1_evacuated_size = GEN1_SPACE_SIZE;
+  gen1_copied_bytes = 0;
   gen1_scan_ptr = gen1_tospace;
   gen1_next_ptr = gen1_tospace;
+  gen1_next_limit = pin_limit(gen1_tospace, gen1_tospace + GEN1_SPACE_SIZE);
+  if (collect_gen2) {
+    gen2_begin_marking();
+  }
   // Copy reachable objects
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_ROOTS);
   gen1_forward_var_roots();
+  pin_for_each(forward_fields);
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_REMEMBERED_SET);
   gen1_forward_roots_from_gen0();
-  scan_tospace();
+  // Objects unpinned by a pending Gen0 collection
+  pin_for_each_released(forward_fields);
+  if (!collect_gen2 || gen2_marking_concurrently) {
+    gen2_for_each_root(forward_fields);
+  }
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_SCAN);
+  scan_survivors();
+  GC_PERF_PHASE_END();
+  if (dedup_enabled) {
+    GC_PERF_PHASE_BEGIN(1, GC_PHASE_DEDUP);
+    dedup_tospace();
+    GC_PERF_PHASE_END();
+  }
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_FLIP);
+  if (collect_gen2) {
+    gen2_end_marking();
+  }
+  stats_record_copied_bytes(gen1_copied_bytes);
+  GC_LIFETIME_RECORD_DEATHS(gen1_fromspace, gen1_alloc_ptr);
+  GC_PROFILE_RECORD_DEATHS(gen1_fromspace, gen1_alloc_ptr);
   // Swap spaces
   uint8_t *temp = gen1_fromspace;
   gen1_fromspace = gen1_tospace;
   gen1_tospace = temp;
   // Set alloc_ptr
   gen1_alloc_ptr = gen1_next_ptr;
+  gen1_alloc_limit = gen1_next_limit;
+  gen1_residency_bytes = gen1_alloc_ptr - gen1_fromspace;
+  if (gen0_gc_initialized && gen0_in_tospace) {
+    gen0_place_nursery();
+  }
   // Reset gen0's scan_ptr in case there is a pending collection
   if (gen0_scan_ptr != NULLPTR) {
+    stats_record_nested_collect();
     gen0_scan_ptr = gen1_fromspace;
     GC_DEBUG_PRINTF("gen1_collect(): Pending Gen0 collection detected! Reset "
                     "gen0_scan_ptr=%p and gen1_roots_to_gen0\n",
                     (void *)gen0_scan_ptr);
     scan_gen1_for_roots_to_gen0();
   }
+  gen2_prune_remembered();
+  GC_PERF_PHASE_END();
+  export_record_collection();
   GC_DEBUG_PRINTF(
       "<<<< gen1_collect(): End: fromspace=%p, tospace=%p, alloc_ptr=%p\n",
       (void *)gen1_fromspace, (void *)gen1_tospace, (void *)gen1_alloc_ptr);
 }
 
+void gen1_collect(void) { collect_fromspace(false); }
+
+void gen1_collect_full(void) {
+  GC_DEBUG_PRINTF(">>>> gen1_collect_full(): Start: gen0_alloc_ptr=%p, "
+                  "fromspace=%p, tospace=%p, alloc_ptr=%p\n",
+                  (void *)gen0_alloc_ptr, (void *)gen1_fromspace,
+                  (void *)gen1_tospace, (void *)gen1_alloc_ptr);
+  assert(gen0_scan_ptr == NULLPTR);
+  // Gen0 survivors can not be copied into to-space over the nursery, so they
+  // are promoted first
+  if (gen0_in_tospace) {
+    if (gen0_alloc_ptr != gen0_space) {
+      gen0_collect();
+    }
+    collect_fromspace(gen2_collection_due());
+    return;
+  }
+  stats_record_full_collect();
+  gen1_full_collection = true;
+  // Prepare
+  pin_release_unpinned(gen0_space, gen0_space_size);
+  pin_release_unpinned(gen1_fromspace, GEN1_SPACE_SIZE);
+  // Gen0 is in the slot next to either semispace, and nothing is allocated
+  // between them
+  uint8_t *gen0_end = gen0_space + gen0_space_size;
+  uint8_t *fromspace_end = gen1_fromspace + GEN1_SPACE_SIZE;
+  gen1_evacuated_start =
+      gen0_space < gen1_fromspace ? gen0_space : gen1_fromspace;
+  gen1_evacuated_size =
+      (gen0_end > fromspace_end ? gen0_end : fromspace_end) -
+      gen1_evacuated_start;
+  gen1_copied_bytes = 0;
+  gen1_scan_ptr = gen1_tospace;
+  gen1_next_ptr = gen1_tospace;
+  gen1_next_limit = pin_limit(gen1_tospace, gen1_tospace + GEN1_SPACE_SIZE);
+  bool collect_gen2 = gen2_collection_due();
+  if (collect_gen2) {
+    gen2_begin_marking();
+  }
+  // Copy reachable objects of both generations. There are no roots between
+  // them to scan, because both of them are evacuated, but Gen2 objects are
+  // roots unless Gen2 is marked to the end as well.
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_ROOTS);
+  gen1_forward_var_roots();
+  pin_for_each(forward_fields);
+  if (!collect_gen2 || gen2_marking_concurrently) {
+    gen2_for_each_root(forward_fields);
+  }
+  GC_PERF_PHASE_END();
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_SCAN);
+  scan_survivors();
+  GC_PERF_PHASE_END();
+  if (dedup_enabled) {
+    GC_PERF_PHASE_BEGIN(1, GC_PHASE_DEDUP);
+    dedup_tospace();
+    GC_PERF_PHASE_END();
+  }
+  GC_PERF_PHASE_BEGIN(1, GC_PHASE_FLIP);
+  if (collect_gen2) {
+    gen2_end_marking();
+  }
+  stats_record_copied_bytes(gen1_copied_bytes);
+  GC_LIFETIME_RECORD_DEATHS(gen0_space, gen0_alloc_ptr);
+  GC_PROFILE_RECORD_DEATHS(gen0_space, gen0_alloc_ptr);
+  GC_LIFETIME_RECORD_DEATHS(gen1_fromspace, gen1_alloc_ptr);
+  GC_PROFILE_RECORD_DEATHS(gen1_fromspace, gen1_alloc_ptr);
+  // Swap spaces
+  uint8_t *temp = gen1_fromspace;
+  gen1_fromspace = gen1_tospace;
+  gen1_tospace = temp;
+  gen1_alloc_ptr = gen1_next_ptr;
+  gen1_alloc_limit = gen1_next_limit;
+  gen1_residency_bytes = gen1_alloc_ptr - gen1_fromspace;
+  // All survivors of Gen0 are in Gen1 now, except pinned objects
+  gen0_alloc_ptr = gen0_space;
+  gen0_alloc_limit = pin_limit(gen0_space, gen0_space + gen0_space_size);
+  gen1_full_collection = false;
+  gen2_prune_remembered();
+  GC_PERF_PHASE_END();
+  export_record_collection();
+  GC_DEBUG_PRINTF("<<<< gen1_collect_full(): End: fromspace=%p, tospace=%p, "
+                  "alloc_ptr=%p\n",
+                  (void *)gen1_fromspace, (void *)gen1_tospace,
+                  (void *)gen1_alloc_ptr);
+}
+
 void *gen1_alloc(size_t size_in_bytes) {
   GC_DEBUG_PRINTF("gen1_alloc(%#zx)\n", size_in_bytes);
   void *result;
@@ -194,7 +529,10 @@ void *gen1_alloc(size_t size_in_bytes) {
   GC_DEBUG_PRINTF("gen1_alloc(%#zx): Starting collection because "
                   "STELLA_GC_MOVE_ALWAYS=ON\n",
                   size_in_bytes);
-  gen1_collect();
+  // Promotion can not collect into the to-space of an Appel nursery
+  if (!gen0_gc_initialized || !gen0_in_tospace || gen0_scan_ptr == NULLPTR) {
+    gen1_collect();
+  }
 #else
   result = gen1_try_alloc(size_in_bytes);
   if (result != NULLPTR) {
@@ -213,3 +551,31 @@ void *gen1_alloc(size_t size_in_bytes) {
          size_in_bytes);
   exit(1);
 }
+
+size_t gen1_alloc_many(size_t object_size, size_t count, void **block) {
+  GC_DEBUG_PRINTF("gen1_alloc_many(%#zx, %zu)\n", object_size, count);
+  size_t n_objects;
+#ifdef STELLA_GC_MOVE_ALWAYS
+  gen1_collect();
+#else
+  // Only the bytes up to the next pinned object are known to be free
+  size_t free_bytes = gen1_alloc_limit - gen1_alloc_ptr;
+  // Same policy as in gen0_alloc_many: a block larger than the space is
+  // allocated piecewise, collecting only when nothing fits
+  bool fits_after_collect = object_size * count <= GEN1_SPACE_SIZE;
+  if (free_bytes < object_size * count &&
+      (fits_after_collect || free_bytes < object_size)) {
+    GC_DEBUG_PRINTF("gen1_alloc_many(%#zx, %zu): Starting collection because "
+                    "there is not enough space for objects\n",
+                    object_size, count);
+    gen1_collect();
+  }
+#endif
+  n_objects = gen1_try_alloc_many(object_size, count, block);
+  if (n_objects > 0) {
+    return n_objects;
+  }
+  printf("Out of memory: could not allocate %zx bytes in Gen1\n",
+         object_size);
+  exit(1);
+}
@@ -0,0 +1,635 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gc.h>
+
+#include "gc/gen2.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/forward_pointers.h"
+#include "gc/gen1.h"
+#include "gc/kernels.h"
+#include "gc/lifetime.h"
+#include "gc/nursery.h"
+#include "gc/parameters.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
+#include "gc/stats.h"
+#include "gc/trace.h"
+#include "gc/utils.h"
+#include "runtime_extras.h"
+
+#define TENURE_AGE_ENV_VAR "STELLA_GC_TENURE_AGE"
+#define CONCURRENT_MARK_ENV_VAR "STELLA_GC_CONCURRENT_MARK"
+
+#define GEN2_INITIAL_CAPACITY 1024
+
+// Without a write barrier nothing keeps the remembered set up to date, and
+// Gen2 is scanned for roots instead
+#define GEN2_REMEMBERED_SET (STELLA_GC_BARRIERS != GC_BARRIERS_NONE)
+
+#define MARK_BITMAP_WORDS (GEN2_SPACE_SIZE / GC_REF_ALIGNMENT / 64 + 1)
+
+#define free_lists (gc_current_heap->gen2.free_lists)
+#define queue (gc_current_heap->gen2.queue)
+#define queue_size (gc_current_heap->gen2.queue_size)
+#define queue_capacity (gc_current_heap->gen2.queue_capacity)
+#define remembered (gc_current_heap->gen2.remembered)
+#define n_remembered (gc_current_heap->gen2.n_remembered)
+#define remembered_capacity (gc_current_heap->gen2.remembered_capacity)
+#define collection_requested (gc_current_heap->gen2.collection_requested)
+#define gen2_used_bytes (gc_current_heap->gen2.used_bytes)
+#define trigger_bytes (gc_current_heap->gen2.trigger_bytes)
+#define tenured_bytes (gc_current_heap->gen2.tenured_bytes)
+#define tenured_objects (gc_current_heap->gen2.tenured_objects)
+#define gen2_n_collects (gc_current_heap->gen2.n_collects)
+#define gen2_freed_bytes (gc_current_heap->gen2.freed_bytes)
+#define max_n_remembered (gc_current_heap->gen2.max_n_remembered)
+#define gen2_concurrent (gc_current_heap->gen2.concurrent)
+#define mark_bitmap (gc_current_heap->gen2.mark_bitmap)
+#define grey (gc_current_heap->gen2.grey)
+#define grey_size (gc_current_heap->gen2.grey_size)
+#define grey_capacity (gc_current_heap->gen2.grey_capacity)
+#define satb_lock (gc_current_heap->gen2.satb_lock)
+#define satb_log (gc_current_heap->gen2.satb_log)
+#define satb_log_size (gc_current_heap->gen2.satb_log_size)
+#define satb_log_capacity (gc_current_heap->gen2.satb_log_capacity)
+#define marker_thread (gc_current_heap->gen2.marker)
+#define marker_done (gc_current_heap->gen2.marker_done)
+#define marker_abort (gc_current_heap->gen2.marker_abort)
+#define n_concurrent_cycles (gc_current_heap->gen2.n_concurrent_cycles)
+#define n_logged (gc_current_heap->gen2.n_logged)
+#define max_final_pause_ns (gc_current_heap->gen2.max_final_pause_ns)
+
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+#define in_barrier_range (gc_current_heap->gen2.in_barrier_range)
+
+static atomic_flag barrier_range_lock = ATOMIC_FLAG_INIT;
+
+// Range of the Gen2 spaces covered so far, guarded by barrier_range_lock
+static uintptr_t covered_start = 0;
+static uintptr_t covered_end = 0;
+
+static void lock_barrier_range(void) {
+  while (atomic_flag_test_and_set_explicit(&barrier_range_lock,
+                                           memory_order_acquire)) {
+  }
+}
+
+static void unlock_barrier_range(void) {
+  atomic_flag_clear_explicit(&barrier_range_lock, memory_order_release);
+}
+
+static void cover_gen2(void) {
+  if (!in_barrier_range) {
+    return;
+  }
+  uintptr_t start = (uintptr_t)gen2_space;
+  uintptr_t end = start + GEN2_SPACE_SIZE;
+  if (covered_start == covered_end) {
+    covered_start = start;
+    covered_end = end;
+    return;
+  }
+  covered_start = covered_start < start ? covered_start : start;
+  covered_end = covered_end > end ? covered_end : end;
+}
+
+static void set_barrier_range(void) {
+  gc_barrier_range_start = covered_start;
+  gc_barrier_range_size = covered_end - covered_start;
+}
+
+// The range of the write barrier is shared by the heaps, so it grows to cover
+// Gen2 of every heap. Writes into other spaces between them take the slow
+// path as well, and are filtered by gen2_record_write.
+static void widen_barrier_range(void) {
+  lock_barrier_range();
+  in_barrier_range = true;
+  covered_start = gc_barrier_range_start;
+  covered_end = gc_barrier_range_start + gc_barrier_range_size;
+  cover_gen2();
+  set_barrier_range();
+  unlock_barrier_range();
+}
+
+// The range shrinks back to the Gen2 spaces of the other heaps when a heap is
+// destroyed, so that writes into whatever is mapped at its place later take
+// the fast path again
+static void narrow_barrier_range(void) {
+  lock_barrier_range();
+  in_barrier_range = false;
+  covered_start = 0;
+  covered_end = 0;
+  gc_heap_for_each(cover_gen2);
+  set_barrier_range();
+  unlock_barrier_range();
+}
+#endif
+
+void gen2_initialize(void) {
+  assert(gen1_gc_initialized);
+  const char *tenure_age = getenv(TENURE_AGE_ENV_VAR);
+  int age = tenure_age != NULLPTR ? atoi(tenure_age) : 0;
+  gen2_enabled = age > 0;
+  if (!gen2_enabled) {
+    return;
+  }
+  gen2_tenure_age = age < GEN2_MAX_TENURE_AGE ? age : GEN2_MAX_TENURE_AGE;
+  gen2_space = gen1_region + 3 * GC_SLOT_SIZE;
+  gen2_top = gen2_space;
+  trigger_bytes = GEN2_SPACE_SIZE / 2;
+  const char *concurrent = getenv(CONCURRENT_MARK_ENV_VAR);
+  gen2_concurrent = concurrent != NULLPTR && atoi(concurrent) != 0;
+  if (gen2_concurrent && !GEN2_REMEMBERED_SET) {
+    printf("%s needs a write barrier (STELLA_GC_BARRIERS=range or call)\n",
+           CONCURRENT_MARK_ENV_VAR);
+    exit(1);
+  }
+  if (gen2_concurrent) {
+    mark_bitmap = calloc(MARK_BITMAP_WORDS, sizeof(uint64_t));
+    if (mark_bitmap == NULLPTR) {
+      printf("Out of memory: could not allocate the mark bitmap of Gen2\n");
+      exit(1);
+    }
+  }
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+  widen_barrier_range();
+#endif
+  GC_DEBUG_PRINTF("gen2_initialize(): tenure_age=%d, gen2_space=%p\n",
+                  gen2_tenure_age, (void *)gen2_space);
+}
+
+// The space is freed with the region of Gen1. A running marker thread is
+// stopped first.
+void gen2_destroy(void) {
+  if (gen2_marking_concurrently) {
+    atomic_store(&marker_abort, true);
+    pthread_join(marker_thread, NULLPTR);
+  }
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+  if (in_barrier_range) {
+    narrow_barrier_range();
+  }
+#endif
+  free(queue);
+  free(remembered);
+  free(grey);
+  free(satb_log);
+  free((void *)mark_bitmap);
+  gc_current_heap->gen2 = (struct gen2_state){0};
+}
+
+static void push(stella_object ***array, size_t *size, size_t *capacity,
+                 stella_object *obj) {
+  if (*size == *capacity) {
+    *capacity = *capacity == 0 ? GEN2_INITIAL_CAPACITY : 2 * *capacity;
+    *array = realloc(*array, *capacity * sizeof(stella_object *));
+    if (*array == NULLPTR) {
+      printf("Out of memory: could not grow the tables of Gen2\n");
+      exit(1);
+    }
+  }
+  (*array)[(*size)++] = obj;
+}
+
+// Only this thread writes headers, the marker reads them meanwhile
+static void set_header_relaxed(stella_object *obj, int header) {
+  __atomic_store_n(&obj->object_header, header, __ATOMIC_RELAXED);
+}
+
+static void remember(stella_object *obj) {
+  if ((obj->object_header & GEN2_REMEMBERED_BIT) != 0) {
+    return;
+  }
+  set_header_relaxed(obj, obj->object_header | GEN2_REMEMBERED_BIT);
+  push(&remembered, &n_remembered, &remembered_capacity, obj);
+  if (n_remembered > max_n_remembered) {
+    max_n_remembered = n_remembered;
+  }
+}
+
+static size_t mark_bit_index(stella_object *obj) {
+  return ((uint8_t *)obj - gen2_space) / GC_REF_ALIGNMENT;
+}
+
+static bool has_mark_in_bitmap(stella_object *obj) {
+  size_t index = mark_bit_index(obj);
+  uint64_t word =
+      atomic_load_explicit(&mark_bitmap[index / 64], memory_order_relaxed);
+  return (word & (uint64_t)1 << index % 64) != 0;
+}
+
+// Returns false if obj is marked already. Called by the marker thread and the
+// write barrier at the same time.
+static bool mark_in_bitmap(stella_object *obj) {
+  if (has_mark_in_bitmap(obj)) {
+    return false;
+  }
+  size_t index = mark_bit_index(obj);
+  uint64_t bit = (uint64_t)1 << index % 64;
+  uint64_t word = atomic_fetch_or_explicit(&mark_bitmap[index / 64], bit,
+                                           memory_order_relaxed);
+  return (word & bit) == 0;
+}
+
+// Marks are in the header unless Gen2 is marked concurrently
+static bool has_mark(stella_object *obj) {
+  if (gen2_marking_concurrently) {
+    return has_mark_in_bitmap(obj);
+  }
+  return (obj->object_header & GEN2_MARK_BIT) != 0;
+}
+
+// Returns false if obj is marked already
+static bool set_mark(stella_object *obj) {
+  if (gen2_marking_concurrently) {
+    return mark_in_bitmap(obj);
+  }
+  if ((obj->object_header & GEN2_MARK_BIT) != 0) {
+    return false;
+  }
+  obj->object_header |= GEN2_MARK_BIT;
+  return true;
+}
+
+// Fields count of the largest free cell of at most size bytes
+static int cell_fields_count(size_t size) {
+  int n_fields = GC_MAX_FIELDS_COUNT;
+  while (STELLA_OBJECT_SIZE(n_fields) > size) {
+    n_fields--;
+  }
+  return n_fields;
+}
+
+// Turns [start, end) into free cells, as large as possible. A cell without
+// fields can not be linked, it is reclaimed once a sweep merges it with a
+// neighbor.
+static void free_range(uint8_t *start, uint8_t *end) {
+  while (start < end) {
+    int n_fields = cell_fields_count(end - start);
+    stella_object *cell = (stella_object *)start;
+    cell->object_header = 0;
+    STELLA_OBJECT_INIT_TAG(cell, TAG_FILLER);
+    STELLA_OBJECT_INIT_FIELDS_COUNT(cell, n_fields);
+    for (int i = 1; i < n_fields; i++) {
+      set_field(cell, i, NULLPTR);
+    }
+    if (n_fields > 0) {
+      set_field(cell, 0, free_lists[n_fields]);
+      free_lists[n_fields] = cell;
+    }
+    start += STELLA_OBJECT_SIZE(n_fields);
+  }
+  assert(start == end);
+}
+
+static stella_object *take_free_cell(int n_fields) {
+  stella_object *cell = free_lists[n_fields];
+  if (cell != NULLPTR) {
+    free_lists[n_fields] = get_field(cell, 0);
+  }
+  return cell;
+}
+
+// An exactly fitting free cell, bump allocation, or a part of a larger cell
+static stella_object *gen2_alloc(size_t size) {
+  int n_fields = cell_fields_count(size);
+  stella_object *cell = take_free_cell(n_fields);
+  if (cell != NULLPTR) {
+    return cell;
+  }
+  if ((size_t)(gen2_space + GEN2_SPACE_SIZE - gen2_top) >= size) {
+    cell = (stella_object *)gen2_top;
+    gen2_top += size;
+    return cell;
+  }
+  for (int larger = GC_MAX_FIELDS_COUNT; larger > n_fields; larger--) {
+    cell = take_free_cell(larger);
+    if (cell != NULLPTR) {
+      free_range((uint8_t *)cell + size,
+                 (uint8_t *)cell + STELLA_OBJECT_SIZE(larger));
+      return cell;
+    }
+  }
+  return NULLPTR;
+}
+
+stella_object *gen2_tenure(stella_object *obj) {
+  size_t size = gc_size_of_object(obj);
+  stella_object *new_location = gen2_alloc(size);
+  if (new_location == NULLPTR) {
+    GC_DEBUG_PRINTF("gen2_tenure(%p): Gen2 is full\n", (void *)obj);
+    gen2_request_collection();
+    return NULLPTR;
+  }
+  copy_object(obj, new_location);
+  GC_LIFETIME_RECORD_MOVE(obj, new_location);
+  GC_TRACE_RECORD_MOVE(obj, new_location);
+  set_forward_ptr(obj, new_location);
+  // Objects tenured by a Gen2 collection survive it
+  if (gen2_marking || gen2_marking_concurrently) {
+    set_mark(new_location);
+  }
+  push(&queue, &queue_size, &queue_capacity, new_location);
+  if (GEN2_REMEMBERED_SET) {
+    remember(new_location);
+  }
+  gen2_used_bytes += size;
+  tenured_bytes += size;
+  tenured_objects++;
+  stats_record_copied_bytes(size);
+  GC_DEBUG_PRINTF("gen2_tenure(%p): moved to %p\n", (void *)obj,
+                  (void *)new_location);
+  return new_location;
+}
+
+bool gen2_collection_due(void) {
+  return gen2_enabled && !gen2_marking_concurrently &&
+         (collection_requested || gen2_used_bytes >= trigger_bytes);
+}
+
+void gen2_request_collection(void) { collection_requested = true; }
+
+void gen2_begin_marking(void) {
+  GC_DEBUG_PRINTF("gen2_begin_marking(): %#zx bytes used\n", gen2_used_bytes);
+  pin_release_unpinned(gen2_space, GEN2_SPACE_SIZE);
+  // Requested collections can not wait for the marker thread
+  gen2_marking_concurrently = gen2_concurrent && !collection_requested;
+  collection_requested = false;
+  gen2_marking = true;
+}
+
+// Objects marked by a cycle which marks concurrently are left to the marker
+// thread
+void gen2_mark(stella_object *obj) {
+  if (!set_mark(obj)) {
+    return;
+  }
+  if (gen2_marking_concurrently) {
+    push(&grey, &grey_size, &grey_capacity, obj);
+  } else {
+    push(&queue, &queue_size, &queue_capacity, obj);
+  }
+}
+
+// Pinned objects are roots, but their fields are forwarded without marking
+// them
+static bool is_live(stella_object *obj) {
+  return has_mark(obj) || is_pinned(obj);
+}
+
+static void free_dead_range(uint8_t *start, uint8_t *end) {
+  GC_LIFETIME_RECORD_DEATHS(start, end);
+  free_range(start, end);
+}
+
+// Merges every run of dead objects and free cells into new free cells, and
+// gives a run at the end back to bump allocation
+static void sweep(void) {
+  for (int i = 0; i <= GC_MAX_FIELDS_COUNT; i++) {
+    free_lists[i] = NULLPTR;
+  }
+  size_t live_bytes = 0;
+  uint8_t *dead_start = NULLPTR;
+  uint8_t *cur_ptr = gen2_space;
+  while (cur_ptr < gen2_top) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    size_t size = gc_size_of_object(obj);
+    if (is_live(obj)) {
+      if (dead_start != NULLPTR) {
+        free_dead_range(dead_start, cur_ptr);
+        dead_start = NULLPTR;
+      }
+      obj->object_header &= ~GEN2_MARK_BIT;
+      live_bytes += size;
+    } else {
+      if (get_tag(obj) != TAG_FILLER) {
+        gen2_freed_bytes += size;
+      }
+      if (dead_start == NULLPTR) {
+        dead_start = cur_ptr;
+      }
+    }
+    cur_ptr += size;
+  }
+  assert(cur_ptr == gen2_top);
+  if (dead_start != NULLPTR) {
+    GC_LIFETIME_RECORD_DEATHS(dead_start, gen2_top);
+    gen2_top = dead_start;
+  }
+  gen2_used_bytes = live_bytes;
+}
+
+// Marks the Gen2 objects reachable from the grey and the logged objects
+// through Gen2 objects, in the marker thread or in the pause which finishes a
+// cycle. The fields may be written meanwhile: pointers to younger generations
+// are left to the collections, and overwritten Gen2 pointers are logged.
+static void mark_grey(void) {
+  while (!atomic_load_explicit(&marker_abort, memory_order_relaxed)) {
+    while (grey_size > 0) {
+      stella_object *obj = grey[--grey_size];
+      int header = __atomic_load_n(&obj->object_header, __ATOMIC_RELAXED);
+      int n_fields = STELLA_OBJECT_HEADER_FIELD_COUNT(header);
+      for (int i = 0; i < n_fields; i++) {
+        stella_object *field = gc_ref_decode(
+            __atomic_load_n(&obj->object_fields[i], __ATOMIC_RELAXED));
+        if (points_to_gen2(field) && mark_in_bitmap(field)) {
+          push(&grey, &grey_size, &grey_capacity, field);
+        }
+      }
+    }
+    while (atomic_flag_test_and_set_explicit(&satb_lock,
+                                             memory_order_acquire)) {
+    }
+    for (size_t i = 0; i < satb_log_size; i++) {
+      push(&grey, &grey_size, &grey_capacity, satb_log[i]);
+    }
+    satb_log_size = 0;
+    atomic_flag_clear_explicit(&satb_lock, memory_order_release);
+    if (grey_size == 0) {
+      return;
+    }
+  }
+}
+
+static void *marker_main(void *heap) {
+  gc_current_heap = heap;
+  mark_grey();
+  atomic_store(&marker_done, true);
+  return NULLPTR;
+}
+
+// Dead objects of the remembered set are dropped, then swept
+static void finish_marking(void) {
+  GC_PROFILE_RECORD_SWEEP(gen2_space, gen2_top, is_live);
+  // Dead objects are about to become parts of free cells
+  size_t n_kept = 0;
+  for (size_t i = 0; i < n_remembered; i++) {
+    if (is_live(remembered[i])) {
+      remembered[n_kept++] = remembered[i];
+    }
+  }
+  n_remembered = n_kept;
+  uint8_t *marked_top = gen2_top;
+  sweep();
+  if (gen2_marking_concurrently) {
+    memset((void *)mark_bitmap, 0,
+           (mark_bit_index((stella_object *)marked_top) / 64 + 1) *
+               sizeof(uint64_t));
+    gen2_marking_concurrently = false;
+  }
+  gen2_n_collects++;
+  trigger_bytes = gen2_used_bytes + (GEN2_SPACE_SIZE - gen2_used_bytes) / 2;
+  GC_DEBUG_PRINTF("finish_marking(): %#zx bytes live, top=%p\n",
+                  gen2_used_bytes, (void *)gen2_top);
+}
+
+void gen2_end_marking(void) {
+  assert(queue_size == 0);
+  gen2_marking = false;
+  if (!gen2_marking_concurrently) {
+    finish_marking();
+    return;
+  }
+  n_concurrent_cycles++;
+  atomic_store(&marker_done, false);
+  atomic_store(&marker_abort, false);
+  if (pthread_create(&marker_thread, NULLPTR, marker_main, gc_current_heap) !=
+      0) {
+    GC_DEBUG_PRINTF("gen2_end_marking(%p): no marker thread, marking now\n",
+                    (void *)gc_current_heap);
+    mark_grey();
+    finish_marking();
+  }
+}
+
+void gen2_poll_marking(void) {
+  if (!gen2_marking_concurrently ||
+      (!collection_requested && !atomic_load(&marker_done))) {
+    return;
+  }
+  uint64_t start_ns = nursery_clock_ns();
+  pthread_join(marker_thread, NULLPTR);
+  mark_grey();
+  finish_marking();
+  collection_requested = false;
+  uint64_t pause_ns = nursery_clock_ns() - start_ns;
+  if (pause_ns > max_final_pause_ns) {
+    max_final_pause_ns = pause_ns;
+  }
+}
+
+bool gen2_scan_queue(void (*forward_fields)(stella_object *obj)) {
+  if (queue_size == 0) {
+    return false;
+  }
+  while (queue_size > 0) {
+    forward_fields(queue[--queue_size]);
+  }
+  return true;
+}
+
+void gen2_for_each_root(void (*forward_fields)(stella_object *obj)) {
+  if (!gen2_enabled) {
+    return;
+  }
+  // Tenuring may add objects on the way, which are queued anyway
+  if (GEN2_REMEMBERED_SET) {
+    for (size_t i = 0; i < n_remembered; i++) {
+      forward_fields(remembered[i]);
+    }
+    return;
+  }
+  uint8_t *cur_ptr = gen2_space;
+  while (cur_ptr < gen2_top) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(obj);
+    if (get_tag(obj) != TAG_FILLER) {
+      forward_fields(obj);
+    }
+  }
+}
+
+static bool is_younger(stella_object *obj) {
+  return is_managed_by_gc(obj) && !points_to_gen2(obj);
+}
+
+static bool has_younger_fields(stella_object *obj) {
+  int n_fields = get_fields_count(obj);
+  for (int i = 0; i < n_fields; i++) {
+    if (is_younger(get_field(obj, i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void gen2_prune_remembered(void) {
+  if (!GEN2_REMEMBERED_SET || !gen2_enabled) {
+    return;
+  }
+  size_t n_kept = 0;
+  for (size_t i = 0; i < n_remembered; i++) {
+    stella_object *obj = remembered[i];
+    if (has_younger_fields(obj)) {
+      remembered[n_kept++] = obj;
+    } else {
+      set_header_relaxed(obj, obj->object_header & ~GEN2_REMEMBERED_BIT);
+    }
+  }
+  n_remembered = n_kept;
+}
+
+void gen2_record_write(void *obj, int field_index, void *contents) {
+  if (!gen2_enabled || !points_to_gen2(obj)) {
+    return;
+  }
+  // Younger objects are scanned by the pause which starts the cycle, so
+  // only pointers overwritten in Gen2 may hide objects from the marker
+  if (gen2_marking_concurrently) {
+    stella_object *overwritten = get_field(obj, field_index);
+    if (points_to_gen2(overwritten) && mark_in_bitmap(overwritten)) {
+      while (atomic_flag_test_and_set_explicit(&satb_lock,
+                                               memory_order_acquire)) {
+      }
+      push(&satb_log, &satb_log_size, &satb_log_capacity, overwritten);
+      atomic_flag_clear_explicit(&satb_lock, memory_order_release);
+      n_logged++;
+    }
+  }
+  if (is_younger(contents)) {
+    remember(obj);
+  }
+}
+
+void print_gen2_stats(void) {
+  printf("Tenure age:                      %d Gen1 cycles\n",
+         gen2_tenure_age);
+  printf("    Tenured:                     %'llu bytes (%'llu objects)\n",
+         (unsigned long long)tenured_bytes,
+         (unsigned long long)tenured_objects);
+  printf("    Gen2 in use:                 %'zu bytes\n", gen2_used_bytes);
+  printf("    Gen2 cycles:                 %'llu times\n",
+         (unsigned long long)gen2_n_collects);
+  printf("    Freed by Gen2 cycles:        %'llu bytes\n",
+         (unsigned long long)gen2_freed_bytes);
+  if (GEN2_REMEMBERED_SET) {
+    printf("    Max remembered objects:      %'zu\n", max_n_remembered);
+  }
+  if (gen2_concurrent) {
+    printf("    Concurrent Gen2 cycles:      %'llu times\n",
+           (unsigned long long)n_concurrent_cycles);
+    printf("    Max final marking pause:     %'llu ns\n",
+           (unsigned long long)max_final_pause_ns);
+    printf("    Logged by the write barrier: %'llu objects\n",
+           (unsigned long long)n_logged);
+  }
+}
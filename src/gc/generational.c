@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gc/collector.h"
+
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/lifetime.h"
+#include "gc/parameters.h"
+#include "gc/roots.h"
+#include "gc/scheduler.h"
+#include "gc/stats.h"
+
+// Gen0 may place its nursery into Gen1, and Gen2 takes the rest of its region
+void generational_initialize(void) {
+  gen1_initialize();
+  gen0_initialize();
+  gen2_initialize();
+}
+
+void *generational_alloc(size_t size_in_bytes) {
+  if (GC_LIFETIME_COLLECTION_DUE()) {
+    gen1_collect_full();
+  }
+  void *obj = gen0_alloc(size_in_bytes);
+  GC_LIFETIME_RECORD_BIRTH(obj, size_in_bytes);
+  return obj;
+}
+
+size_t generational_alloc_many(size_t object_size, size_t count,
+                               void **block) {
+  if (GC_LIFETIME_COLLECTION_DUE()) {
+    gen1_collect_full();
+  }
+  size_t n_objects = gen0_alloc_many(object_size, count, block);
+  for (size_t i = 0; i < n_objects; i++) {
+    GC_LIFETIME_RECORD_BIRTH((uint8_t *)*block + i * object_size, object_size);
+  }
+  return n_objects;
+}
+
+void generational_read_barrier(__attribute__((unused)) void *object,
+                               __attribute__((unused)) int field_index) {}
+
+void generational_write_barrier(void *object, int field_index,
+                                void *contents) {
+  gen2_record_write(object, field_index, contents);
+}
+
+void generational_push_root(void **root) { push_var_root(root); }
+
+void generational_pop_root(void **root) { pop_var_root(root); }
+
+void generational_collect(int generation) {
+  scheduler_collect_generation(generation);
+}
+
+int generational_idle_hint(uint64_t budget_ns) {
+  return scheduler_idle_hint(budget_ns);
+}
+
+void generational_print_stats(void) { print_stats(); }
+
+void generational_destroy(void) {
+  gen2_destroy();
+  gen0_destroy();
+  gen1_destroy();
+}
+
+void generational_print_state(void) {
+  printf("from-space: %p..%p\n", (void *)gen1_fromspace,
+         (void *)(gen1_fromspace + GEN1_SPACE_SIZE - 1));
+  printf("to-space: %p..%p\n", (void *)gen1_tospace,
+         (void *)(gen1_fromspace + GEN1_SPACE_SIZE - 1));
+  printf("alloc_ptr: %p\n", (void *)gen1_alloc_ptr);
+  size_t allocated_bytes = gen1_alloc_ptr - gen1_fromspace;
+  size_t free_bytes = GEN1_SPACE_SIZE - allocated_bytes;
+  printf("    allocated in from-space: %#zx bytes\n", allocated_bytes);
+  printf("    free in from-space:      %#zx bytes\n", free_bytes);
+  size_t allocated_in_tospace = gen1_next_ptr - gen1_tospace;
+  size_t free_in_tospace = GEN1_SPACE_SIZE - allocated_bytes;
+  printf("next_ptr: %p\n", (void *)gen1_next_ptr);
+  printf("    allocated in to-space:   %#zx bytes\n", allocated_in_tospace);
+  printf("    free in to-space:        %#zx bytes\n", free_in_tospace);
+  printf("scan_ptr: %p\n", (void *)gen1_scan_ptr);
+  printf("    left to scan:            %#zx bytes\n",
+         gen1_next_ptr - gen1_scan_ptr);
+  if (gen2_enabled) {
+    printf("gen2: %p..%p\n", (void *)gen2_space,
+           (void *)(gen2_space + GEN2_SPACE_SIZE - 1));
+    printf("    allocated in gen2:       %#zx bytes\n",
+           (size_t)(gen2_top - gen2_space));
+  }
+}
+
+GC_DEFINE_COLLECTOR(generational);
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gc.h>
+
+#include "gc/heap.h"
+
+#include "constants.h"
+#include "gc/collector.h"
+#include "gc/debug.h"
+#include "gc/lifetime.h"
+#include "gc/parameters.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
+#include "gc/roots.h"
+#include "gc/trace.h"
+
+// Barriers may be called before the GC is initialized (e.g. when calling a
+// static closure), so the collector of a heap is never left NULL
+#define GC_HEAP_INITIALIZER                                                    \
+  {                                                                            \
+    .collector = GC_DEFAULT_COLLECTOR,                                         \
+    .nursery = {.limit_size = GEN0_SPACE_SIZE,                                 \
+                .min_limit_size = GEN0_SPACE_SIZE},                            \
+    .scheduler = {.promotion_rate_ewma = 1.0},                                 \
+  }
+
+// Heap used by threads which have not selected one
+static struct gc_heap gc_default_heap = GC_HEAP_INITIALIZER;
+
+_Thread_local struct gc_heap *gc_current_heap = &gc_default_heap;
+
+// Heaps which are not destroyed are linked from the default one
+static unsigned n_created_heaps = 0;
+static pthread_mutex_t heaps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+gc_heap *gc_heap_create(void) {
+  struct gc_heap *heap = malloc(sizeof(struct gc_heap));
+  if (heap == NULLPTR) {
+    return NULLPTR;
+  }
+  *heap = (struct gc_heap)GC_HEAP_INITIALIZER;
+  pthread_mutex_lock(&heaps_lock);
+  heap->number = ++n_created_heaps;
+  heap->next = gc_default_heap.next;
+  gc_default_heap.next = heap;
+  pthread_mutex_unlock(&heaps_lock);
+  GC_DEBUG_PRINTF("gc_heap_create(): created heap %p\n", (void *)heap);
+  return heap;
+}
+
+static void unlink_heap(struct gc_heap *heap) {
+  pthread_mutex_lock(&heaps_lock);
+  struct gc_heap *cur = &gc_default_heap;
+  while (cur->next != heap) {
+    cur = cur->next;
+  }
+  cur->next = heap->next;
+  pthread_mutex_unlock(&heaps_lock);
+}
+
+void gc_heap_destroy(gc_heap *heap) {
+  assert(heap != &gc_default_heap);
+  unlink_heap(heap);
+  struct gc_heap *previous = gc_heap_select(heap);
+  if (heap->initialized) {
+    // Reports look at the spaces, so they are written first
+    profile_write();
+    lifetime_write_report();
+    heap->collector->destroy();
+    destroy_var_roots();
+    pin_destroy();
+    trace_destroy();
+    profile_destroy();
+  }
+  gc_heap_select(previous == heap ? &gc_default_heap : previous);
+  GC_DEBUG_PRINTF("gc_heap_destroy(): destroyed heap %p\n", (void *)heap);
+  free(heap);
+}
+
+gc_heap *gc_heap_current(void) { return gc_current_heap; }
+
+gc_heap *gc_heap_select(gc_heap *heap) {
+  struct gc_heap *previous = gc_current_heap;
+  gc_current_heap = heap != NULLPTR ? heap : &gc_default_heap;
+  return previous;
+}
+
+void gc_heap_for_each(void (*report)(void)) {
+  struct gc_heap *previous = gc_current_heap;
+  pthread_mutex_lock(&heaps_lock);
+  for (struct gc_heap *heap = &gc_default_heap; heap != NULLPTR;
+       heap = heap->next) {
+    gc_current_heap = heap;
+    report();
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  gc_current_heap = previous;
+}
+
+void gc_heap_output_path(char *buffer, size_t size, const char *path) {
+  if (gc_current_heap->number == 0) {
+    snprintf(buffer, size, "%s", path);
+  } else {
+    snprintf(buffer, size, "%s.%u", path, gc_current_heap->number);
+  }
+}
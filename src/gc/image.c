@@ -0,0 +1,599 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gc.h>
+#include <runtime.h>
+
+#include "gc/image.h"
+
+#include "constants.h"
+#include "gc/collector.h"
+#include "gc/debug.h"
+#include "gc/space.h"
+#include "gc/utils.h"
+#include "runtime_extras.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+// Without the flag the address is only a hint, the result is checked anyway
+#define MAP_FIXED_NOREPLACE 0
+#endif
+
+// Image file layout:
+//   [header][objects, at IMAGE_ALIGNMENT][word kinds, at IMAGE_ALIGNMENT]
+// Objects are saved as if the image was mapped at IMAGE_PREFERRED_BASE, so
+// mapping it there in the same executable requires no relocation.
+#define IMAGE_MAGIC "STLIMG01"
+#define IMAGE_ALIGNMENT ((size_t)64 * KILOBYTE)
+#define IMAGE_PREFERRED_BASE ((uintptr_t)0x5e0000000000)
+
+#define MAX_LOADED_IMAGES 64
+
+// How to relocate a word of the image
+enum image_word_kind {
+  IMAGE_WORD_RAW,      // object header, never relocated
+  IMAGE_WORD_INTERNAL, // pointer into the image
+  IMAGE_WORD_EXTERNAL, // pointer into the executable (static objects, code)
+};
+
+struct image_header {
+  char magic[8];
+  uint64_t word_size;
+  uint64_t objects_size;
+  uint64_t preferred_base;
+  // Pointers into the executable are relocated by the difference of the
+  // anchors, which is the same for code and data of a statically linked
+  // executable
+  uint64_t anchor;
+  uint64_t root;
+  uint64_t root_kind;
+};
+
+struct loaded_image {
+  uint8_t *start;
+  size_t size;
+  // Published by gc_publish rather than loaded from a file
+  bool published;
+};
+
+// Loaded images and published regions are immutable and shared by all heaps.
+// Entries are only changed under the lock and published by the count, so
+// lookups take no lock. A released region keeps its entry with a zero size
+// until a later region reuses it.
+static struct loaded_image loaded_images[MAX_LOADED_IMAGES];
+static atomic_int loaded_images_count = 0;
+static atomic_flag loaded_images_lock = ATOMIC_FLAG_INIT;
+static size_t loaded_images_bytes = 0;
+static int relocated_images_count = 0;
+static int published_regions_count = 0;
+static size_t published_regions_bytes = 0;
+
+static uint64_t image_anchor(void) { return (uint64_t)(uintptr_t)&the_ZERO; }
+
+static size_t round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+bool points_to_loaded_image(uint8_t *ptr) {
+  int count = atomic_load_explicit(&loaded_images_count, memory_order_acquire);
+  for (int i = 0; i < count; i++) {
+    if (points_to_some_space(loaded_images[i].start, ptr,
+                             loaded_images[i].size)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Objects which are copied into the image, everything else is external
+static bool is_image_source(stella_object *obj) {
+  return is_managed_by_gc(obj) || points_to_loaded_image((uint8_t *)obj);
+}
+
+// ------------------------------------
+// --- Saving
+
+struct image_builder {
+  uint8_t *objects;
+  uint8_t *kinds;
+  size_t size;
+  size_t capacity;
+  // Open addressing map from original objects to their offsets in the image
+  stella_object **map_keys;
+  size_t *map_offsets;
+  size_t map_capacity;
+  size_t map_size;
+};
+
+static size_t map_slot(struct image_builder *builder, stella_object *obj) {
+  size_t hash = ((uintptr_t)obj >> 3) * 0x9E3779B97F4A7C15u;
+  size_t slot = hash & (builder->map_capacity - 1);
+  while (builder->map_keys[slot] != NULLPTR && builder->map_keys[slot] != obj) {
+    slot = (slot + 1) & (builder->map_capacity - 1);
+  }
+  return slot;
+}
+
+static void map_grow(struct image_builder *builder) {
+  stella_object **old_keys = builder->map_keys;
+  size_t *old_offsets = builder->map_offsets;
+  size_t old_capacity = builder->map_capacity;
+  builder->map_capacity = old_capacity == 0 ? 1024 : old_capacity * 2;
+  builder->map_keys = calloc(builder->map_capacity, sizeof(stella_object *));
+  builder->map_offsets = malloc(builder->map_capacity * sizeof(size_t));
+  if (builder->map_keys == NULLPTR || builder->map_offsets == NULLPTR) {
+    printf("Out of memory: could not grow the object map of the image\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_keys[i] != NULLPTR) {
+      size_t slot = map_slot(builder, old_keys[i]);
+      builder->map_keys[slot] = old_keys[i];
+      builder->map_offsets[slot] = old_offsets[i];
+    }
+  }
+  free(old_keys);
+  free(old_offsets);
+}
+
+static size_t builder_copy(struct image_builder *builder, stella_object *obj) {
+  if (2 * (builder->map_size + 1) > builder->map_capacity) {
+    map_grow(builder);
+  }
+  size_t slot = map_slot(builder, obj);
+  if (builder->map_keys[slot] == obj) {
+    return builder->map_offsets[slot];
+  }
+  size_t size = gc_size_of_object(obj);
+  if (builder->size + size > builder->capacity) {
+    builder->capacity = 2 * (builder->size + size);
+    builder->objects = realloc(builder->objects, builder->capacity);
+    builder->kinds =
+        realloc(builder->kinds, builder->capacity / sizeof(void *));
+    if (builder->objects == NULLPTR || builder->kinds == NULLPTR) {
+      printf("Out of memory: could not grow the image buffer\n");
+      exit(1);
+    }
+  }
+  size_t offset = builder->size;
+  memcpy(builder->objects + offset, obj, size);
+  memset(builder->kinds + offset / sizeof(void *), IMAGE_WORD_RAW,
+         size / sizeof(void *));
+  builder->size += size;
+  builder->map_keys[slot] = obj;
+  builder->map_offsets[slot] = offset;
+  builder->map_size++;
+  return offset;
+}
+
+// Returns the value of a word pointing at obj, as if the image was mapped at
+// IMAGE_PREFERRED_BASE
+static uint64_t builder_encode(struct image_builder *builder,
+                               stella_object *obj, uint8_t *kind) {
+  // NULL stays NULL wherever the executable is loaded
+  if (obj == NULLPTR) {
+    *kind = IMAGE_WORD_RAW;
+    return 0;
+  }
+  if (is_image_source(obj)) {
+    *kind = IMAGE_WORD_INTERNAL;
+    return IMAGE_PREFERRED_BASE + builder_copy(builder, obj);
+  }
+  *kind = IMAGE_WORD_EXTERNAL;
+  return (uint64_t)(uintptr_t)obj;
+}
+
+// Copies the graph in Cheney order: the image itself is the queue
+static void builder_scan(struct image_builder *builder) {
+  size_t scan = 0;
+  while (scan < builder->size) {
+    stella_object *copy = (stella_object *)(builder->objects + scan);
+    size_t size = gc_size_of_object(copy);
+    int n_fields = get_fields_count(copy);
+    for (int i = 0; i < n_fields; i++) {
+      uint8_t kind;
+      uint64_t word = builder_encode(builder, get_field(copy, i), &kind);
+      // builder_encode may have moved the buffer
+      copy = (stella_object *)(builder->objects + scan);
+      set_field(copy, i, (stella_object *)(uintptr_t)word);
+      builder->kinds[scan / sizeof(void *) + 1 + i] = kind;
+    }
+    scan += size;
+  }
+}
+
+static bool write_at(int fd, const void *data, size_t size, off_t offset) {
+  const uint8_t *bytes = data;
+  while (size > 0) {
+    ssize_t written = pwrite(fd, bytes, size, offset);
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= (size_t)written;
+    offset += written;
+  }
+  return true;
+}
+
+int gc_save_image(const char *path, void *root) {
+  if (gc_current_collector == &epsilon_collector) {
+    printf("Could not save heap image: not supported by the epsilon GC\n");
+    return -1;
+  }
+#ifdef STELLA_GC_COMPRESSED_REFS
+  // Images hold one word per field
+  printf("Could not save heap image: not supported with compressed "
+         "references\n");
+  return -1;
+#endif
+  struct image_builder builder;
+  memset(&builder, 0, sizeof(builder));
+  struct image_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.word_size = sizeof(void *);
+  header.preferred_base = IMAGE_PREFERRED_BASE;
+  header.anchor = image_anchor();
+  uint8_t root_kind;
+  header.root = builder_encode(&builder, root, &root_kind);
+  header.root_kind = root_kind;
+  builder_scan(&builder);
+  header.objects_size = builder.size;
+  GC_DEBUG_PRINTF("gc_save_image(%s): saving %zu objects, %#zx bytes\n", path,
+                  builder.map_size, builder.size);
+
+  int result = -1;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    off_t kinds_offset =
+        (off_t)(IMAGE_ALIGNMENT + round_up(builder.size, IMAGE_ALIGNMENT));
+    bool ok = write_at(fd, &header, sizeof(header), 0) &&
+              write_at(fd, builder.objects, builder.size,
+                       (off_t)IMAGE_ALIGNMENT) &&
+              write_at(fd, builder.kinds, builder.size / sizeof(void *),
+                       kinds_offset);
+    result = (close(fd) == 0 && ok) ? 0 : -1;
+  }
+  if (result != 0) {
+    printf("Could not save heap image to %s\n", path);
+  }
+  free(builder.objects);
+  free(builder.kinds);
+  free(builder.map_keys);
+  free(builder.map_offsets);
+  return result;
+}
+
+// ------------------------------------
+// --- Loading
+
+static bool read_at(int fd, void *data, size_t size, off_t offset) {
+  uint8_t *bytes = data;
+  while (size > 0) {
+    ssize_t n_read = pread(fd, bytes, size, offset);
+    if (n_read <= 0) {
+      return false;
+    }
+    bytes += n_read;
+    size -= (size_t)n_read;
+    offset += n_read;
+  }
+  return true;
+}
+
+static uint64_t relocate(uint64_t word, uint8_t kind, uint64_t base_delta,
+                         uint64_t anchor_delta) {
+  switch (kind) {
+  case IMAGE_WORD_INTERNAL:
+    return word + base_delta;
+  case IMAGE_WORD_EXTERNAL:
+    return word + anchor_delta;
+  default:
+    return word;
+  }
+}
+
+// Maps the objects of the image and relocates them if they could not be
+// mapped at the preferred address. Returns NULLPTR on failure.
+static uint8_t *map_objects(int fd, struct image_header *header,
+                            size_t map_size) {
+  bool same_executable = header->anchor == image_anchor();
+  if (same_executable) {
+    void *preferred = (void *)(uintptr_t)header->preferred_base;
+    void *start = mmap(preferred, map_size, PROT_READ,
+                       MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd,
+                       (off_t)IMAGE_ALIGNMENT);
+    if (start == preferred) {
+      GC_DEBUG_PRINTF("map_objects(): mapped at %p without relocation\n",
+                      start);
+      return start;
+    }
+    if (start != MAP_FAILED) {
+      munmap(start, map_size);
+    }
+  }
+  uint8_t *start = mmap(NULLPTR, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        fd, (off_t)IMAGE_ALIGNMENT);
+  if (start == MAP_FAILED) {
+    return NULLPTR;
+  }
+  size_t n_words = header->objects_size / sizeof(void *);
+  uint8_t *kinds = malloc(n_words);
+  off_t kinds_offset = (off_t)(IMAGE_ALIGNMENT +
+                               round_up(header->objects_size, IMAGE_ALIGNMENT));
+  if (kinds == NULLPTR || !read_at(fd, kinds, n_words, kinds_offset)) {
+    free(kinds);
+    munmap(start, map_size);
+    return NULLPTR;
+  }
+  uint64_t base_delta = (uint64_t)(uintptr_t)start - header->preferred_base;
+  uint64_t anchor_delta = image_anchor() - header->anchor;
+  uint64_t *words = (uint64_t *)start;
+  for (size_t i = 0; i < n_words; i++) {
+    words[i] = relocate(words[i], kinds[i], base_delta, anchor_delta);
+  }
+  free(kinds);
+  mprotect(start, map_size, PROT_READ);
+  relocated_images_count++;
+  GC_DEBUG_PRINTF("map_objects(): mapped at %p and relocated %zu words\n",
+                  (void *)start, n_words);
+  return start;
+}
+
+static void lock_loaded_images(void) {
+  while (atomic_flag_test_and_set_explicit(&loaded_images_lock,
+                                           memory_order_acquire)) {
+  }
+}
+
+static void unlock_loaded_images(void) {
+  atomic_flag_clear_explicit(&loaded_images_lock, memory_order_release);
+}
+
+static void *load_image(const char *path) {
+#ifdef STELLA_GC_COMPRESSED_REFS
+  printf("Could not load heap image %s: not supported with compressed "
+         "references\n",
+         path);
+  return NULLPTR;
+#endif
+  int count = atomic_load_explicit(&loaded_images_count, memory_order_relaxed);
+  if (count >= MAX_LOADED_IMAGES) {
+    printf("Could not load heap image %s: too many images\n", path);
+    return NULLPTR;
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("Could not open heap image %s\n", path);
+    return NULLPTR;
+  }
+  struct image_header header;
+  bool valid = read_at(fd, &header, sizeof(header), 0) &&
+               memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) == 0 &&
+               header.word_size == sizeof(void *);
+  if (!valid) {
+    close(fd);
+    printf("Could not load heap image %s: invalid header\n", path);
+    return NULLPTR;
+  }
+  uint8_t *start = NULLPTR;
+  size_t map_size = round_up(header.objects_size, IMAGE_ALIGNMENT);
+  if (map_size > 0) {
+    start = map_objects(fd, &header, map_size);
+    if (start == NULLPTR) {
+      close(fd);
+      printf("Could not map heap image %s\n", path);
+      return NULLPTR;
+    }
+    loaded_images[count].start = start;
+    loaded_images[count].size = header.objects_size;
+    loaded_images[count].published = false;
+    loaded_images_bytes += header.objects_size;
+    atomic_store_explicit(&loaded_images_count, count + 1,
+                          memory_order_release);
+  }
+  close(fd);
+  uint64_t base_delta = (uint64_t)(uintptr_t)start - header.preferred_base;
+  uint64_t anchor_delta = image_anchor() - header.anchor;
+  return (void *)(uintptr_t)relocate(header.root, (uint8_t)header.root_kind,
+                                     base_delta, anchor_delta);
+}
+
+void *gc_load_image(const char *path) {
+  lock_loaded_images();
+  void *root = load_image(path);
+  unlock_loaded_images();
+  return root;
+}
+
+// ------------------------------------
+// --- Publishing
+
+// Copies the graph into the builder in Cheney order, with the fields still
+// pointing at the originals
+static void builder_collect(struct image_builder *builder) {
+  size_t scan = 0;
+  while (scan < builder->size) {
+    stella_object *copy = (stella_object *)(builder->objects + scan);
+    int n_fields = get_fields_count(copy);
+    for (int i = 0; i < n_fields; i++) {
+      stella_object *field = get_field(copy, i);
+      if (is_image_source(field)) {
+        builder_copy(builder, field);
+        // builder_copy may have moved the buffer
+        copy = (stella_object *)(builder->objects + scan);
+      }
+    }
+    scan += gc_size_of_object(copy);
+  }
+}
+
+// With compressed references the region must be in their range, and the
+// spaces are carved from there anyway
+static uint8_t *alloc_region(size_t size) {
+#ifdef STELLA_GC_COMPRESSED_REFS
+  return space_alloc(size);
+#else
+  void *region = mmap(NULLPTR, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return region == MAP_FAILED ? NULLPTR : region;
+#endif
+}
+
+static void free_region(uint8_t *region, size_t size) {
+#ifdef STELLA_GC_COMPRESSED_REFS
+  space_free(region, size);
+#else
+  munmap(region, size);
+#endif
+}
+
+static size_t region_size(size_t objects_size) {
+  return round_up(objects_size, (size_t)sysconf(_SC_PAGESIZE));
+}
+
+// Returns the entry of a released region, or a new entry if there is none
+static int find_free_entry(void) {
+  int count = atomic_load_explicit(&loaded_images_count, memory_order_relaxed);
+  for (int i = 0; i < count; i++) {
+    if (loaded_images[i].published && loaded_images[i].size == 0) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// Reference cells are written by the program, which a read-only region does
+// not allow
+static bool has_mutable_objects(struct image_builder *builder) {
+  size_t scan = 0;
+  while (scan < builder->size) {
+    stella_object *obj = (stella_object *)(builder->objects + scan);
+    if (get_tag(obj) == TAG_REF) {
+      return true;
+    }
+    scan += gc_size_of_object(obj);
+  }
+  return false;
+}
+
+static void *publish(struct image_builder *builder, void *root) {
+  int entry = find_free_entry();
+  if (entry >= MAX_LOADED_IMAGES) {
+    printf("Could not publish %p: too many images and published regions\n",
+           root);
+    return NULLPTR;
+  }
+  builder_copy(builder, root);
+  builder_collect(builder);
+  if (has_mutable_objects(builder)) {
+    printf("Could not publish %p: the graph contains mutable references\n",
+           root);
+    return NULLPTR;
+  }
+  uint8_t *region = alloc_region(region_size(builder->size));
+  if (region == NULLPTR) {
+    printf("Could not publish %p: out of memory for %zu bytes\n", root,
+           builder->size);
+    return NULLPTR;
+  }
+  memcpy(region, builder->objects, builder->size);
+  size_t scan = 0;
+  while (scan < builder->size) {
+    stella_object *obj = (stella_object *)(region + scan);
+    int n_fields = get_fields_count(obj);
+    for (int i = 0; i < n_fields; i++) {
+      stella_object *field = get_field(obj, i);
+      if (is_image_source(field)) {
+        set_field(obj, i,
+                  (stella_object *)(region + builder_copy(builder, field)));
+      }
+    }
+    scan += gc_size_of_object(obj);
+  }
+  mprotect(region, region_size(builder->size), PROT_READ);
+  loaded_images[entry].start = region;
+  loaded_images[entry].published = true;
+  // A reused entry becomes visible to lookups with its size
+  atomic_thread_fence(memory_order_release);
+  loaded_images[entry].size = builder->size;
+  published_regions_count++;
+  published_regions_bytes += builder->size;
+  int count = atomic_load_explicit(&loaded_images_count, memory_order_relaxed);
+  if (entry == count) {
+    atomic_store_explicit(&loaded_images_count, count + 1,
+                          memory_order_release);
+  }
+  GC_DEBUG_PRINTF("gc_publish(%p): published %zu objects, %#zx bytes at %p\n",
+                  root, builder->map_size, builder->size, (void *)region);
+  return region;
+}
+
+void *gc_publish(void *root) {
+  if (gc_current_collector == &epsilon_collector) {
+    printf("Could not publish %p: not supported by the epsilon GC\n", root);
+    return NULLPTR;
+  }
+  if (!is_image_source(root)) {
+    return root;
+  }
+  struct image_builder builder;
+  memset(&builder, 0, sizeof(builder));
+  lock_loaded_images();
+  void *published = publish(&builder, root);
+  unlock_loaded_images();
+  free(builder.objects);
+  free(builder.kinds);
+  free(builder.map_keys);
+  free(builder.map_offsets);
+  return published;
+}
+
+void gc_release_published(void *root) {
+  lock_loaded_images();
+  int count = atomic_load_explicit(&loaded_images_count, memory_order_relaxed);
+  for (int i = 0; i < count; i++) {
+    struct loaded_image *region = &loaded_images[i];
+    if (region->published && region->size > 0 &&
+        region->start == (uint8_t *)root) {
+      size_t size = region->size;
+      region->size = 0;
+      published_regions_count--;
+      published_regions_bytes -= size;
+      free_region(region->start, region_size(size));
+      GC_DEBUG_PRINTF("gc_release_published(%p): released %#zx bytes\n", root,
+                      size);
+      break;
+    }
+  }
+  unlock_loaded_images();
+}
+
+void print_image_stats(void) {
+  int count = atomic_load(&loaded_images_count);
+  if (count == 0) {
+    return;
+  }
+  int n_loaded = 0;
+  for (int i = 0; i < count; i++) {
+    n_loaded += !loaded_images[i].published;
+  }
+  if (n_loaded > 0) {
+    printf("Loaded heap images:              %d (%d relocated)\n", n_loaded,
+           relocated_images_count);
+    printf("    Image size:                  %'zu bytes\n",
+           loaded_images_bytes);
+  }
+  if (n_loaded < count) {
+    printf("Published regions:               %d (%'zu bytes)\n",
+           published_regions_count, published_regions_bytes);
+  }
+}
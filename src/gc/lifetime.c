@@ -0,0 +1,272 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gc/lifetime.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/forward_pointers.h"
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/heap.h"
+#include "gc/parameters.h"
+#include "gc/pin.h"
+#include "gc/utils.h"
+#include "runtime_extras.h"
+
+#define LIFETIME_INTERVAL_ENV_VAR "STELLA_GC_LIFETIME_INTERVAL"
+#define LIFETIME_OUTPUT_ENV_VAR "STELLA_GC_LIFETIME_OUTPUT"
+#define LIFETIME_DEFAULT_OUTPUT "stella_gc_lifetimes.csv"
+
+// Tags take 4 bits of the header
+#define LIFETIME_N_TAGS 16
+// Bucket 0 holds age 0, bucket b > 0 holds ages [2^(b-1), 2^b)
+#define LIFETIME_N_BUCKETS 65
+
+struct lifetime_histogram {
+  uint64_t n_births;
+  uint64_t n_deaths;
+  uint64_t deaths[LIFETIME_N_TAGS][LIFETIME_N_BUCKETS];
+  uint64_t death_bytes[LIFETIME_N_TAGS][LIFETIME_N_BUCKETS];
+};
+
+#define lifetime_initialized (gc_current_heap->lifetime.initialized)
+#define lifetime_clock (gc_current_heap->lifetime.clock)
+#define lifetime_interval (gc_current_heap->lifetime.interval)
+#define next_forced_collection                                                 \
+  (gc_current_heap->lifetime.next_forced_collection)
+#define n_forced_collections (gc_current_heap->lifetime.n_forced_collections)
+#define region_births (gc_current_heap->lifetime.region_births)
+#define histogram (gc_current_heap->lifetime.histogram)
+
+static const char *lifetime_output_path(void) {
+  const char *path = getenv(LIFETIME_OUTPUT_ENV_VAR);
+  return path != NULLPTR ? path : LIFETIME_DEFAULT_OUTPUT;
+}
+
+static int lifetime_bucket(uint64_t age) {
+  return age == 0 ? 0 : 64 - __builtin_clzll(age);
+}
+
+static uint64_t lifetime_bucket_start(int bucket) {
+  return bucket == 0 ? 0 : (uint64_t)1 << (bucket - 1);
+}
+
+static uint64_t *birth_slot(void *obj) {
+  uintptr_t ptr = (uintptr_t)obj;
+  if (region_births != NULLPTR &&
+      ptr - (uintptr_t)gen1_region < GC_REGION_SIZE) {
+    return &region_births[(ptr - (uintptr_t)gen1_region) / sizeof(void *)];
+  }
+  return NULLPTR;
+}
+
+static void write_lifetime_reports(void);
+
+static void lifetime_initialize(void) {
+  const char *interval = getenv(LIFETIME_INTERVAL_ENV_VAR);
+  if (interval != NULLPTR && atoll(interval) > 0) {
+    lifetime_interval = (uint64_t)atoll(interval);
+    next_forced_collection = lifetime_interval;
+  }
+  histogram = calloc(1, sizeof(struct lifetime_histogram));
+  if (gen1_gc_initialized) {
+    region_births = calloc(GC_REGION_SIZE / sizeof(void *), sizeof(uint64_t));
+  }
+  if (histogram == NULLPTR ||
+      (gen1_gc_initialized && region_births == NULLPTR)) {
+    printf("Out of memory: could not allocate lifetime tables\n");
+    exit(1);
+  }
+  static bool report_registered = false;
+  if (!report_registered) {
+    report_registered = true;
+    atexit(write_lifetime_reports);
+  }
+  GC_DEBUG_PRINTF("lifetime_initialize(): interval=%llu, output=%s\n",
+                  (unsigned long long)lifetime_interval,
+                  lifetime_output_path());
+  lifetime_initialized = true;
+}
+
+void lifetime_record_birth(void *obj, size_t size_in_bytes) {
+  if (!lifetime_initialized) {
+    lifetime_initialize();
+  }
+  uint64_t *slot = birth_slot(obj);
+  if (slot != NULLPTR) {
+    *slot = lifetime_clock + 1;
+  }
+  histogram->n_births++;
+  lifetime_clock += size_in_bytes;
+}
+
+void lifetime_record_move(void *obj, void *new_location) {
+  uint64_t *slot = birth_slot(obj);
+  uint64_t *new_slot = birth_slot(new_location);
+  if (slot == NULLPTR || new_slot == NULLPTR) {
+    return;
+  }
+  *new_slot = *slot;
+  *slot = 0;
+}
+
+static void record_death(stella_object *obj, uint64_t birth) {
+  uint64_t age = lifetime_clock - birth;
+  int bucket = lifetime_bucket(age);
+  uint8_t tag = get_tag(obj);
+  histogram->n_deaths++;
+  histogram->deaths[tag][bucket]++;
+  histogram->death_bytes[tag][bucket] += gc_size_of_object(obj);
+}
+
+void lifetime_record_deaths(uint8_t *start, uint8_t *end) {
+  if (!lifetime_initialized) {
+    return;
+  }
+  uint8_t *cur_ptr = start;
+  while (cur_ptr < end) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(obj);
+    uint64_t *slot = birth_slot(obj);
+    // Pinned objects survive where they are
+    if (slot == NULLPTR || *slot == 0 || is_pinned(obj)) {
+      continue;
+    }
+    // Moved objects took their stamps with them, so forward pointers left are
+    // deduplicated copies, which died when they were merged
+    if (is_forward_ptr(obj)) {
+      *slot = 0;
+      continue;
+    }
+    record_death(obj, *slot - 1);
+    *slot = 0;
+  }
+  assert(cur_ptr == end);
+}
+
+bool lifetime_collection_due(void) {
+  if (lifetime_interval == 0 || lifetime_clock < next_forced_collection) {
+    return false;
+  }
+  next_forced_collection = lifetime_clock + lifetime_interval;
+  n_forced_collections++;
+  return true;
+}
+
+void lifetime_destroy(void) {
+  free(histogram);
+  free(region_births);
+  histogram = NULLPTR;
+  region_births = NULLPTR;
+  lifetime_initialized = false;
+}
+
+// Ages of the objects still alive, per bucket. They are counted as survivors up
+// to their current age.
+static void count_alive(uint64_t alive[LIFETIME_N_BUCKETS], uint8_t *start,
+                        uint8_t *end) {
+  uint8_t *cur_ptr = start;
+  while (cur_ptr < end) {
+    stella_object *obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(obj);
+    uint64_t *slot = birth_slot(obj);
+    if (slot != NULLPTR && *slot != 0) {
+      alive[lifetime_bucket(lifetime_clock - (*slot - 1))]++;
+    }
+  }
+}
+
+void lifetime_write_report(void) {
+  if (!lifetime_initialized) {
+    return;
+  }
+  char path[PATH_MAX];
+  gc_heap_output_path(path, sizeof(path), lifetime_output_path());
+  FILE *file = fopen(path, "w");
+  if (file == NULLPTR) {
+    fprintf(stderr, "Could not write lifetime report to %s\n", path);
+    return;
+  }
+  uint64_t alive[LIFETIME_N_BUCKETS] = {0};
+  if (gen0_gc_initialized) {
+    count_alive(alive, gen0_space, gen0_alloc_ptr);
+  }
+  if (region_births != NULLPTR) {
+    count_alive(alive, gen1_fromspace, gen1_alloc_ptr);
+  }
+  if (gen2_enabled) {
+    count_alive(alive, gen2_space, gen2_top);
+  }
+  uint64_t n_alive = 0;
+  for (int b = 0; b < LIFETIME_N_BUCKETS; b++) {
+    n_alive += alive[b];
+  }
+  uint64_t n_traced = histogram->n_deaths + n_alive;
+
+  fprintf(file, "# Object lifetimes in bytes allocated between birth and "
+                "death, measured at collections\n");
+  fprintf(file, "# Objects: %llu born, %llu dead, %llu still alive\n",
+          (unsigned long long)histogram->n_births,
+          (unsigned long long)histogram->n_deaths,
+          (unsigned long long)n_alive);
+  fprintf(file, "# Forced collections: %llu (every %llu bytes)\n",
+          (unsigned long long)n_forced_collections,
+          (unsigned long long)lifetime_interval);
+
+  fprintf(file, "\n# Survival curve: objects that lived at least age_bytes\n");
+  fprintf(file, "age_bytes,surviving_objects,surviving_fraction\n");
+  uint64_t surviving = n_traced;
+  for (int b = 0; b < LIFETIME_N_BUCKETS && surviving > 0; b++) {
+    fprintf(file, "%llu,%llu,%.6f\n",
+            (unsigned long long)lifetime_bucket_start(b),
+            (unsigned long long)surviving,
+            (double)surviving / (double)n_traced);
+    for (int tag = 0; tag < LIFETIME_N_TAGS; tag++) {
+      surviving -= histogram->deaths[tag][b];
+    }
+    surviving -= alive[b];
+  }
+
+  fprintf(file, "\n# Lifetime histogram: dead objects by tag with age in "
+                "[age_from, age_to)\n");
+  fprintf(file, "tag,age_from,age_to,objects,bytes\n");
+  for (int tag = 0; tag < LIFETIME_N_TAGS; tag++) {
+    for (int b = 0; b < LIFETIME_N_BUCKETS; b++) {
+      if (histogram->deaths[tag][b] == 0) {
+        continue;
+      }
+      fprintf(file, "%s,%llu,%llu,%llu,%llu\n", stella_tag_name(tag),
+              (unsigned long long)lifetime_bucket_start(b),
+              (unsigned long long)(b + 1 < LIFETIME_N_BUCKETS
+                                       ? lifetime_bucket_start(b + 1)
+                                       : UINT64_MAX),
+              (unsigned long long)histogram->deaths[tag][b],
+              (unsigned long long)histogram->death_bytes[tag][b]);
+    }
+  }
+  fclose(file);
+}
+
+static void write_lifetime_reports(void) {
+  gc_heap_for_each(lifetime_write_report);
+}
+
+void print_lifetime_stats(void) {
+  if (!lifetime_initialized) {
+    return;
+  }
+  printf("Lifetime tracing:                %'llu objects born, %'llu dead\n",
+         (unsigned long long)histogram->n_births,
+         (unsigned long long)histogram->n_deaths);
+  printf("    Forced collections:          %'llu times\n",
+         (unsigned long long)n_forced_collections);
+  char path[PATH_MAX];
+  gc_heap_output_path(path, sizeof(path), lifetime_output_path());
+  printf("    Report (written at exit):    %s\n", path);
+}
@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "gc/nursery.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/gen0.h"
+#include "gc/parameters.h"
+
+#define PAUSE_TARGET_ENV_VAR "STELLA_GC_PAUSE_TARGET_US"
+
+// The nursery is not shrunk below this size, otherwise a pause target that
+// can not be met (e.g. because of a large Gen1) would make Gen0 collect on
+// almost every allocation
+#define GEN0_MIN_LIMIT_SIZE (GEN0_SPACE_SIZE / 16)
+
+// Weight of the last collection in the moving averages
+#define NURSERY_EWMA_WEIGHT 0.3
+
+// Maximum factor by which the nursery is resized after one collection
+#define NURSERY_MAX_RESIZE_FACTOR 2.0
+
+#define pause_target_ns (gc_current_heap->nursery.pause_target_ns)
+
+// A Gen0 pause is modelled as fixed_ns + survived_bytes * ns_per_byte.
+// The fixed part (scanning Gen1 for roots) does not depend on the nursery
+// size, the rest is proportional to the number of survivors.
+#define fixed_ns_ewma (gc_current_heap->nursery.fixed_ns_ewma)
+#define ns_per_survived_byte_ewma                                              \
+  (gc_current_heap->nursery.ns_per_survived_byte_ewma)
+#define survival_rate_ewma (gc_current_heap->nursery.survival_rate_ewma)
+
+#define nursery_n_collects (gc_current_heap->nursery.n_collects)
+#define max_pause_ns (gc_current_heap->nursery.max_pause_ns)
+#define total_pause_ns (gc_current_heap->nursery.total_pause_ns)
+#define n_pauses_over_target (gc_current_heap->nursery.n_pauses_over_target)
+#define min_gen0_limit_size (gc_current_heap->nursery.min_limit_size)
+#define max_gen0_limit_size (gc_current_heap->nursery.max_limit_size)
+
+void nursery_initialize(void) {
+  const char *target_us = getenv(PAUSE_TARGET_ENV_VAR);
+  if (target_us == NULLPTR || atoll(target_us) <= 0) {
+    return;
+  }
+  pause_target_ns = (uint64_t)atoll(target_us) * 1000;
+  nursery_is_adaptive = true;
+  GC_DEBUG_PRINTF("nursery_initialize(): pause target %lluns, limit %#zx\n",
+                  (unsigned long long)pause_target_ns, gen0_limit_size);
+}
+
+uint64_t nursery_clock_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// A nursery in to-space may be smaller than the minimum
+static size_t clamp_limit_size(double size) {
+  if (size < (double)GEN0_MIN_LIMIT_SIZE) {
+    size = (double)GEN0_MIN_LIMIT_SIZE;
+  }
+  if (size > (double)gen0_space_size) {
+    return gen0_space_size;
+  }
+  // Keep the limit aligned to object words
+  return (size_t)size / sizeof(void *) * sizeof(void *);
+}
+
+static double ewma(double average, double sample) {
+  if (nursery_n_collects == 0) {
+    return sample;
+  }
+  return NURSERY_EWMA_WEIGHT * sample + (1 - NURSERY_EWMA_WEIGHT) * average;
+}
+
+static double predict_limit_size(void) {
+  double variable_ns_budget = (double)pause_target_ns - fixed_ns_ewma;
+  double ns_per_nursery_byte = ns_per_survived_byte_ewma * survival_rate_ewma;
+  if (variable_ns_budget <= 0) {
+    // The target can not be met by shrinking the nursery, so collect as
+    // rarely as possible to at least pay the fixed cost less often
+    return (double)gen0_space_size;
+  }
+  if (ns_per_nursery_byte <= 0) {
+    // Nothing survives, so pauses do not grow with the nursery
+    return (double)gen0_space_size;
+  }
+  return variable_ns_budget / ns_per_nursery_byte;
+}
+
+void nursery_record_collect(uint64_t pause_ns, uint64_t fixed_ns,
+                            size_t used_bytes, size_t survived_bytes) {
+  assert(nursery_is_adaptive);
+  assert(fixed_ns <= pause_ns);
+  double survival_rate =
+      used_bytes > 0 ? (double)survived_bytes / (double)used_bytes : 0;
+  survival_rate_ewma = ewma(survival_rate_ewma, survival_rate);
+  fixed_ns_ewma = ewma(fixed_ns_ewma, (double)fixed_ns);
+  if (survived_bytes > 0) {
+    ns_per_survived_byte_ewma =
+        ewma(ns_per_survived_byte_ewma,
+             (double)(pause_ns - fixed_ns) / (double)survived_bytes);
+  }
+  nursery_n_collects++;
+  total_pause_ns += pause_ns;
+  if (pause_ns > max_pause_ns) {
+    max_pause_ns = pause_ns;
+  }
+  if (pause_ns > pause_target_ns) {
+    n_pauses_over_target++;
+  }
+  double limit_size = predict_limit_size();
+  double current_size = (double)gen0_limit_size;
+  if (limit_size > current_size * NURSERY_MAX_RESIZE_FACTOR) {
+    limit_size = current_size * NURSERY_MAX_RESIZE_FACTOR;
+  } else if (limit_size < current_size / NURSERY_MAX_RESIZE_FACTOR) {
+    limit_size = current_size / NURSERY_MAX_RESIZE_FACTOR;
+  }
+  gen0_limit_size = clamp_limit_size(limit_size);
+  if (gen0_limit_size < min_gen0_limit_size) {
+    min_gen0_limit_size = gen0_limit_size;
+  }
+  if (gen0_limit_size > max_gen0_limit_size) {
+    max_gen0_limit_size = gen0_limit_size;
+  }
+  GC_DEBUG_PRINTF("nursery_record_collect(): pause=%lluns (fixed %lluns), "
+                  "survival=%.3f, new gen0_limit_size=%#zx\n",
+                  (unsigned long long)pause_ns, (unsigned long long)fixed_ns,
+                  survival_rate, gen0_limit_size);
+}
+
+void print_nursery_stats(void) {
+  printf("Adaptive nursery:\n");
+  printf("    Pause target:                %'llu ns\n",
+         (unsigned long long)pause_target_ns);
+  printf("    Max Gen0 pause:              %'llu ns\n",
+         (unsigned long long)max_pause_ns);
+  printf("    Average Gen0 pause:          %'llu ns\n",
+         (unsigned long long)(nursery_n_collects > 0
+                                  ? total_pause_ns / nursery_n_collects
+                                  : 0));
+  printf("    Pauses over target:          %'llu times\n",
+         (unsigned long long)n_pauses_over_target);
+  printf("    Survival rate:               %.1f%%\n",
+         survival_rate_ewma * 100);
+  printf("    Fixed cost per pause:        %'llu ns\n",
+         (unsigned long long)fixed_ns_ewma);
+  printf("    Gen0 limit:                  %zu bytes (%zu..%zu)\n",
+         gen0_limit_size,
+         nursery_n_collects > 0 ? min_gen0_limit_size : gen0_limit_size,
+         nursery_n_collects > 0 ? max_gen0_limit_size : gen0_limit_size);
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "gc/perf.h"
+
+#include "gc/debug.h"
+
+#define PERF_N_GENERATIONS 2
+#define PERF_MAX_NESTING 4
+
+enum perf_counter {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_COUNTERS_COUNT
+};
+
+static const char *PERF_COUNTER_NAMES[PERF_COUNTERS_COUNT] = {
+    "cycles", "instructions", "LLC misses", "dTLB misses"};
+
+static const char *GC_PHASE_NAMES[GC_PHASES_COUNT] = {
+    "root forwarding", "remembered set", "Cheney scan", "deduplication",
+    "flip"};
+
+struct perf_sample {
+  uint64_t time_ns;
+  uint64_t counters[PERF_COUNTERS_COUNT];
+};
+
+struct perf_phase_totals {
+  uint64_t n_times;
+  struct perf_sample total;
+};
+
+struct perf_active_phase {
+  int gen_n;
+  enum gc_phase phase;
+  struct perf_sample start;
+};
+
+// ------------------------------------
+// --- Perf State
+// Counters measure the calling thread, so the state is per thread rather
+// than per heap
+
+static _Thread_local bool perf_initialized = false;
+
+// All available counters are opened as one group, so that they are read
+// with a single syscall. The fd of the group leader is -1 if no hardware
+// counters are available, and then only clock timings are collected.
+static _Thread_local int perf_group_fd = -1;
+// Position of each counter in the group, or -1 if the counter is unavailable
+static _Thread_local int perf_counter_slot[PERF_COUNTERS_COUNT];
+static _Thread_local int perf_n_open_counters = 0;
+
+static _Thread_local struct perf_phase_totals perf_totals[PERF_N_GENERATIONS]
+                                           [GC_PHASES_COUNT];
+
+// Phases may nest because Gen1 can be collected in the middle of a Gen0
+// collection. Each phase is only charged for the time it was on top of this
+// stack, so the totals do not count nested collections twice.
+static _Thread_local struct perf_active_phase perf_stack[PERF_MAX_NESTING];
+static _Thread_local int perf_stack_size = 0;
+
+#ifdef __linux__
+static int perf_open_counter(uint32_t type, uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void perf_initialize(void) {
+  assert(!perf_initialized);
+  for (int c = 0; c < PERF_COUNTERS_COUNT; c++) {
+    perf_counter_slot[c] = -1;
+  }
+#ifdef __linux__
+  const uint32_t types[PERF_COUNTERS_COUNT] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE};
+  const uint64_t configs[PERF_COUNTERS_COUNT] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+  for (int c = 0; c < PERF_COUNTERS_COUNT; c++) {
+    int fd = perf_open_counter(types[c], configs[c], perf_group_fd);
+    if (fd < 0) {
+      GC_DEBUG_PRINTF("perf_initialize(): counter '%s' is not available\n",
+                      PERF_COUNTER_NAMES[c]);
+      continue;
+    }
+    if (perf_group_fd < 0) {
+      perf_group_fd = fd;
+    }
+    perf_counter_slot[c] = perf_n_open_counters++;
+  }
+#endif
+  GC_DEBUG_PRINTF("perf_initialize(): opened %d hardware counters\n",
+                  perf_n_open_counters);
+  perf_initialized = true;
+}
+
+static void perf_read_sample(struct perf_sample *sample) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  sample->time_ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+  memset(sample->counters, 0, sizeof(sample->counters));
+#ifdef __linux__
+  if (perf_group_fd < 0) {
+    return;
+  }
+  // Layout of a group read: { nr, values[nr] }
+  uint64_t values[1 + PERF_COUNTERS_COUNT];
+  if (read(perf_group_fd, values, sizeof(values)) <= 0) {
+    return;
+  }
+  for (int c = 0; c < PERF_COUNTERS_COUNT; c++) {
+    int slot = perf_counter_slot[c];
+    if (slot >= 0 && (uint64_t)slot < values[0]) {
+      sample->counters[c] = values[1 + slot];
+    }
+  }
+#endif
+}
+
+static void perf_charge(struct perf_active_phase *active,
+                        struct perf_sample *now) {
+  struct perf_sample *total = &perf_totals[active->gen_n][active->phase].total;
+  total->time_ns += now->time_ns - active->start.time_ns;
+  for (int c = 0; c < PERF_COUNTERS_COUNT; c++) {
+    total->counters[c] += now->counters[c] - active->start.counters[c];
+  }
+}
+
+void perf_phase_begin(int gen_n, enum gc_phase phase) {
+  assert((gen_n >= 0) && (gen_n < PERF_N_GENERATIONS));
+  assert(perf_stack_size < PERF_MAX_NESTING);
+  if (!perf_initialized) {
+    perf_initialize();
+  }
+  struct perf_sample now;
+  perf_read_sample(&now);
+  if (perf_stack_size > 0) {
+    perf_charge(&perf_stack[perf_stack_size - 1], &now);
+  }
+  struct perf_active_phase *active = &perf_stack[perf_stack_size++];
+  active->gen_n = gen_n;
+  active->phase = phase;
+  active->start = now;
+  perf_totals[gen_n][phase].n_times++;
+}
+
+void perf_phase_end(void) {
+  assert(perf_stack_size > 0);
+  struct perf_sample now;
+  perf_read_sample(&now);
+  perf_charge(&perf_stack[--perf_stack_size], &now);
+  if (perf_stack_size > 0) {
+    // Resume the enclosing phase
+    perf_stack[perf_stack_size - 1].start = now;
+  }
+}
+
+void print_perf_stats(void) {
+  printf("GC phases (%s):\n", perf_n_open_counters > 0
+                                  ? "hardware counters"
+                                  : "clock only, counters not available");
+  for (int gen_n = 0; gen_n < PERF_N_GENERATIONS; gen_n++) {
+    for (int phase = 0; phase < GC_PHASES_COUNT; phase++) {
+      struct perf_phase_totals *totals = &perf_totals[gen_n][phase];
+      char label[32];
+      snprintf(label, sizeof(label), "Gen%d %s:", gen_n, GC_PHASE_NAMES[phase]);
+      printf("    %-29s%'llu ns (%'llu times)\n", label,
+             (unsigned long long)totals->total.time_ns,
+             (unsigned long long)totals->n_times);
+      for (int c = 0; c < PERF_COUNTERS_COUNT; c++) {
+        if (perf_counter_slot[c] < 0) {
+          continue;
+        }
+        snprintf(label, sizeof(label), "%s:", PERF_COUNTER_NAMES[c]);
+        printf("        %-25s%'llu\n", label,
+               (unsigned long long)totals->total.counters[c]);
+      }
+    }
+  }
+}
@@ -0,0 +1,239 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gc/pin.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/kernels.h"
+#include "gc/parameters.h"
+#include "gc/utils.h"
+#include "runtime_extras.h"
+
+#define PIN_INITIAL_CAPACITY 16
+
+#define pinned_objects (gc_current_heap->pin.objects)
+#define n_pinned_objects (gc_current_heap->pin.n_objects)
+#define pinned_capacity (gc_current_heap->pin.capacity)
+#define n_pins (gc_current_heap->pin.n_pins)
+#define max_n_pinned_objects (gc_current_heap->pin.max_n_objects)
+#define pin_filled_bytes (gc_current_heap->pin.filled_bytes)
+#define released_objects (gc_current_heap->pin.released)
+#define n_released_objects (gc_current_heap->pin.n_released)
+#define released_capacity (gc_current_heap->pin.released_capacity)
+
+// The table is sorted by address: pinned objects never move, so the order
+// only changes where pin_object inserts
+static size_t lower_bound(uint8_t *ptr) {
+  size_t low = 0;
+  size_t high = n_pinned_objects;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if ((uint8_t *)pinned_objects[middle].obj < ptr) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static struct pinned_object *find_pinned(stella_object *obj) {
+  size_t i = lower_bound((uint8_t *)obj);
+  if (i < n_pinned_objects && pinned_objects[i].obj == obj) {
+    return &pinned_objects[i];
+  }
+  return NULLPTR;
+}
+
+// Static objects, objects of heap images and of collectors which never move
+// objects need no pins. Gen2 objects never move either, but a pin keeps them
+// alive.
+static bool needs_pin(stella_object *obj) {
+  return (gen0_gc_initialized && points_to_gen0_space((uint8_t *)obj)) ||
+         (gen1_gc_initialized && (points_to_fromspace((uint8_t *)obj) ||
+                                  points_to_tospace((uint8_t *)obj))) ||
+         (gen2_enabled && points_to_gen2(obj));
+}
+
+void pin_object(stella_object *obj) {
+  if (!needs_pin(obj)) {
+    return;
+  }
+  n_pins++;
+  struct pinned_object *pinned = find_pinned(obj);
+  if (pinned != NULLPTR) {
+    pinned->count++;
+    return;
+  }
+  if (n_pinned_objects == pinned_capacity) {
+    pinned_capacity =
+        pinned_capacity == 0 ? PIN_INITIAL_CAPACITY : 2 * pinned_capacity;
+    pinned_objects = realloc(pinned_objects,
+                             pinned_capacity * sizeof(struct pinned_object));
+    if (pinned_objects == NULLPTR) {
+      printf("Out of memory: could not grow the table of pinned objects\n");
+      exit(1);
+    }
+  }
+  size_t i = lower_bound((uint8_t *)obj);
+  memmove(&pinned_objects[i + 1], &pinned_objects[i],
+          (n_pinned_objects - i) * sizeof(struct pinned_object));
+  pinned_objects[i] = (struct pinned_object){.obj = obj, .count = 1};
+  n_pinned_objects++;
+  if (n_pinned_objects > max_n_pinned_objects) {
+    max_n_pinned_objects = n_pinned_objects;
+  }
+  obj->object_header |= PIN_HEADER_BIT;
+  GC_DEBUG_PRINTF("pin_object(%p): %zu pinned objects\n", (void *)obj,
+                  n_pinned_objects);
+}
+
+void unpin_object(stella_object *obj) {
+  if (!needs_pin(obj)) {
+    return;
+  }
+  struct pinned_object *pinned = find_pinned(obj);
+  assert(pinned != NULLPTR && pinned->count > 0);
+  // The object is only forgotten at the start of a collection, where it is
+  // known whether a collection can move it
+  pinned->count--;
+}
+
+static void remember_released(stella_object *obj) {
+  if (n_released_objects == released_capacity) {
+    released_capacity =
+        released_capacity == 0 ? PIN_INITIAL_CAPACITY : 2 * released_capacity;
+    released_objects = realloc(released_objects,
+                               released_capacity * sizeof(stella_object *));
+    if (released_objects == NULLPTR) {
+      printf("Out of memory: could not grow the table of released objects\n");
+      exit(1);
+    }
+  }
+  released_objects[n_released_objects++] = obj;
+}
+
+static void release_unpinned(uint8_t *space, size_t space_size,
+                             bool remember) {
+  size_t n_kept = 0;
+  for (size_t i = 0; i < n_pinned_objects; i++) {
+    struct pinned_object pinned = pinned_objects[i];
+    if (pinned.count == 0 &&
+        points_to_some_space(space, (uint8_t *)pinned.obj, space_size)) {
+      pinned.obj->object_header &= ~PIN_HEADER_BIT;
+      if (remember) {
+        remember_released(pinned.obj);
+      }
+      GC_DEBUG_PRINTF("pin_release_unpinned(): released %p\n",
+                      (void *)pinned.obj);
+      continue;
+    }
+    pinned_objects[n_kept++] = pinned;
+  }
+  n_pinned_objects = n_kept;
+}
+
+void pin_release_unpinned(uint8_t *space, size_t space_size) {
+  release_unpinned(space, space_size, false);
+}
+
+void pin_release_unpinned_gen0(uint8_t *space, size_t space_size) {
+  release_unpinned(space, space_size, true);
+}
+
+// A released object may have been promoted already. Its forward pointer is
+// then forwarded like the other fields.
+void pin_for_each_released(void (*forward_fields)(stella_object *obj)) {
+  for (size_t i = 0; i < n_released_objects; i++) {
+    forward_fields(released_objects[i]);
+  }
+}
+
+void pin_forget_released(void) { n_released_objects = 0; }
+
+void pin_for_each(void (*forward_fields)(stella_object *obj)) {
+  for (size_t i = 0; i < n_pinned_objects; i++) {
+    forward_fields(pinned_objects[i].obj);
+  }
+}
+
+// Fillers are as large as possible, the last one may have no fields
+static void fill(uint8_t *start, uint8_t *end) {
+  while (start < end) {
+    int n_fields = GC_MAX_FIELDS_COUNT;
+    while (STELLA_OBJECT_SIZE(n_fields) > (size_t)(end - start)) {
+      n_fields--;
+    }
+    stella_object *filler = (stella_object *)start;
+    filler->object_header = 0;
+    STELLA_OBJECT_INIT_TAG(filler, TAG_FILLER);
+    STELLA_OBJECT_INIT_FIELDS_COUNT(filler, n_fields);
+    for (int i = 0; i < n_fields; i++) {
+      set_field(filler, i, NULLPTR);
+    }
+    start += STELLA_OBJECT_SIZE(n_fields);
+  }
+  assert(start == end);
+}
+
+uint8_t *pin_limit(uint8_t *ptr, uint8_t *end) {
+  size_t i = lower_bound(ptr);
+  if (i < n_pinned_objects && (uint8_t *)pinned_objects[i].obj < end) {
+    return (uint8_t *)pinned_objects[i].obj;
+  }
+  return end;
+}
+
+uint8_t *pin_skip(uint8_t *ptr, uint8_t *pinned) {
+  assert(ptr <= pinned && is_pinned((stella_object *)pinned));
+  fill(ptr, pinned);
+  pin_filled_bytes += pinned - ptr;
+  uint8_t *next = pinned + gc_size_of_object((stella_object *)pinned);
+  GC_DEBUG_PRINTF("pin_skip(%p): filled %#zx bytes, continue at %p\n",
+                  (void *)ptr, (size_t)(pinned - ptr), (void *)next);
+  return next;
+}
+
+size_t pin_unusable_bytes(uint8_t *start, uint8_t *end) {
+  size_t bytes = 0;
+  for (size_t i = lower_bound(start);
+       i < n_pinned_objects && (uint8_t *)pinned_objects[i].obj < end; i++) {
+    bytes += gc_size_of_object(pinned_objects[i].obj) +
+             STELLA_OBJECT_SIZE(GC_MAX_FIELDS_COUNT);
+  }
+  return bytes;
+}
+
+void pin_destroy(void) {
+  free(pinned_objects);
+  pinned_objects = NULLPTR;
+  n_pinned_objects = 0;
+  pinned_capacity = 0;
+  free(released_objects);
+  released_objects = NULLPTR;
+  n_released_objects = 0;
+  released_capacity = 0;
+}
+
+void print_pin_stats(void) {
+  size_t pinned_bytes = 0;
+  for (size_t i = 0; i < n_pinned_objects; i++) {
+    pinned_bytes += gc_size_of_object(pinned_objects[i].obj);
+  }
+  printf("Pinned objects:                  %'zu (%'zu bytes)\n",
+         n_pinned_objects, pinned_bytes);
+  printf("    Maximum pinned objects:      %'llu\n",
+         (unsigned long long)max_n_pinned_objects);
+  printf("    Pin calls:                   %'llu times\n",
+         (unsigned long long)n_pins);
+  printf("    Filled in front of them:     %'llu bytes\n",
+         (unsigned long long)pin_filled_bytes);
+}
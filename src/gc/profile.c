@@ -0,0 +1,343 @@
+#include <assert.h>
+#include <execinfo.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gc/profile.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/forward_pointers.h"
+#include "gc/heap.h"
+#include "gc/pin.h"
+#include "runtime_extras.h"
+
+#define PROFILE_RATE_ENV_VAR "STELLA_GC_PROFILE_RATE"
+#define PROFILE_OUTPUT_ENV_VAR "STELLA_GC_PROFILE_OUTPUT"
+#define PROFILE_DEFAULT_OUTPUT "stella_gc.heap"
+#define PROFILE_DEFAULT_RATE ((uint64_t)512 * KILOBYTE)
+
+#define PROFILE_MAX_DEPTH 32
+// take_sample and profile_record_alloc
+#define PROFILE_SKIPPED_FRAMES 2
+#define PROFILE_INITIAL_CAPACITY 256
+
+struct profile_stack {
+  uint64_t hash;
+  int depth;
+  void *frames[PROFILE_MAX_DEPTH];
+  uint64_t alloc_count;
+  uint64_t alloc_bytes;
+  uint64_t inuse_count;
+  uint64_t inuse_bytes;
+};
+
+#define profile_initialized (gc_current_heap->profile.initialized)
+#define profile_rate (gc_current_heap->profile.rate)
+#define bytes_until_sample (gc_current_heap->profile.bytes_until_sample)
+#define random_state (gc_current_heap->profile.random_state)
+#define samples (gc_current_heap->profile.samples)
+#define n_samples (gc_current_heap->profile.n_samples)
+#define samples_capacity (gc_current_heap->profile.samples_capacity)
+#define stacks (gc_current_heap->profile.stacks)
+#define n_stacks (gc_current_heap->profile.n_stacks)
+#define stacks_capacity (gc_current_heap->profile.stacks_capacity)
+#define stack_index (gc_current_heap->profile.stack_index)
+#define stack_index_capacity (gc_current_heap->profile.stack_index_capacity)
+
+static const char *profile_output_path(void) {
+  const char *path = getenv(PROFILE_OUTPUT_ENV_VAR);
+  return path != NULLPTR ? path : PROFILE_DEFAULT_OUTPUT;
+}
+
+static void *profile_realloc(void *array, size_t size) {
+  void *result = realloc(array, size);
+  if (result == NULLPTR) {
+    printf("Out of memory: could not allocate profile tables\n");
+    exit(1);
+  }
+  return result;
+}
+
+// xorshift64*
+static uint64_t next_random(void) {
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return random_state * 0x2545F4914F6CDD1DULL;
+}
+
+// -ln(u) for a uniform u in (0, 1], without libm: the exponent of u gives
+// the integer part of log2(u), and a polynomial the rest
+static double exponential_random(void) {
+  uint64_t r = (next_random() >> 11) + 1; // in [1, 2^53]
+  int exponent = 63 - __builtin_clzll(r);
+  double m = (double)r / (double)((uint64_t)1 << exponent); // in [1, 2)
+  double log2_m =
+      -1.7417939 +
+      (2.8212026 + (-1.4699568 + (0.44717955 - 0.056570851 * m) * m) * m) * m;
+  double log2_u = (double)(exponent - 53) + log2_m;
+  return log2_u < 0 ? -log2_u * 0.6931471805599453 : 0;
+}
+
+// Intervals between sampling points are exponentially distributed, so that
+// pprof can estimate the totals from the samples
+static int64_t next_sample_interval(void) {
+  return (int64_t)(exponential_random() * (double)profile_rate) + 1;
+}
+
+static void write_profiles(void);
+
+static void profile_initialize(void) {
+  const char *rate = getenv(PROFILE_RATE_ENV_VAR);
+  profile_rate = rate != NULLPTR && atoll(rate) > 0 ? (uint64_t)atoll(rate)
+                                                    : PROFILE_DEFAULT_RATE;
+  random_state = ((uint64_t)(uintptr_t)gc_current_heap >> 4) ^
+                 0x9E3779B97F4A7C15ULL;
+  bytes_until_sample = next_sample_interval();
+  static bool profile_registered = false;
+  if (!profile_registered) {
+    profile_registered = true;
+    atexit(write_profiles);
+  }
+  GC_DEBUG_PRINTF("profile_initialize(): rate=%llu, output=%s\n",
+                  (unsigned long long)profile_rate, profile_output_path());
+  profile_initialized = true;
+}
+
+static uint64_t hash_frames(void **frames, int depth) {
+  uint64_t hash = (uint64_t)depth;
+  for (int i = 0; i < depth; i++) {
+    hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+static void grow_stack_index(void) {
+  size_t capacity = stack_index_capacity == 0 ? PROFILE_INITIAL_CAPACITY
+                                              : 2 * stack_index_capacity;
+  free(stack_index);
+  stack_index = calloc(capacity, sizeof(uint32_t));
+  if (stack_index == NULLPTR) {
+    printf("Out of memory: could not allocate profile tables\n");
+    exit(1);
+  }
+  stack_index_capacity = capacity;
+  for (size_t i = 0; i < n_stacks; i++) {
+    size_t slot = stacks[i].hash & (capacity - 1);
+    while (stack_index[slot] != 0) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    stack_index[slot] = (uint32_t)(i + 1);
+  }
+}
+
+// Number of the stack with the given frames, added if it is new
+static uint32_t find_stack(void **frames, int depth) {
+  if (2 * (n_stacks + 1) > stack_index_capacity) {
+    grow_stack_index();
+  }
+  uint64_t hash = hash_frames(frames, depth);
+  size_t slot = hash & (stack_index_capacity - 1);
+  while (stack_index[slot] != 0) {
+    struct profile_stack *stack = &stacks[stack_index[slot] - 1];
+    if (stack->hash == hash && stack->depth == depth &&
+        memcmp(stack->frames, frames, depth * sizeof(void *)) == 0) {
+      return stack_index[slot] - 1;
+    }
+    slot = (slot + 1) & (stack_index_capacity - 1);
+  }
+  if (n_stacks == stacks_capacity) {
+    stacks_capacity = stacks_capacity == 0 ? PROFILE_INITIAL_CAPACITY
+                                           : 2 * stacks_capacity;
+    stacks =
+        profile_realloc(stacks, stacks_capacity * sizeof(struct profile_stack));
+  }
+  struct profile_stack *stack = &stacks[n_stacks];
+  memset(stack, 0, sizeof(*stack));
+  stack->hash = hash;
+  stack->depth = depth;
+  memcpy(stack->frames, frames, depth * sizeof(void *));
+  stack_index[slot] = (uint32_t)(n_stacks + 1);
+  return (uint32_t)n_stacks++;
+}
+
+__attribute__((noinline)) static void take_sample(stella_object *obj,
+                                                  size_t size) {
+  void *frames[PROFILE_MAX_DEPTH + PROFILE_SKIPPED_FRAMES];
+  int depth = backtrace(frames, PROFILE_MAX_DEPTH + PROFILE_SKIPPED_FRAMES);
+  int skipped = depth < PROFILE_SKIPPED_FRAMES ? depth : PROFILE_SKIPPED_FRAMES;
+  uint32_t stack_number = find_stack(frames + skipped, depth - skipped);
+  struct profile_stack *stack = &stacks[stack_number];
+  stack->alloc_count++;
+  stack->alloc_bytes += size;
+  stack->inuse_count++;
+  stack->inuse_bytes += size;
+  if (n_samples == samples_capacity) {
+    samples_capacity = samples_capacity == 0 ? PROFILE_INITIAL_CAPACITY
+                                             : 2 * samples_capacity;
+    samples = profile_realloc(samples,
+                              samples_capacity * sizeof(struct profile_sample));
+  }
+  samples[n_samples++] = (struct profile_sample){
+      .obj = obj, .size = size, .stack = stack_number};
+}
+
+void profile_record_alloc(void *block, size_t object_size, size_t count) {
+  int64_t size = (int64_t)(object_size * count);
+  bytes_until_sample -= size;
+  if (bytes_until_sample > 0) {
+    return;
+  }
+  if (!profile_initialized) {
+    profile_initialize();
+    return;
+  }
+  // Offset of the sampling point in the block, 1-based
+  int64_t offset = bytes_until_sample + size;
+  while (offset <= size) {
+    size_t index = (size_t)(offset - 1) / object_size;
+    take_sample((stella_object *)((uint8_t *)block + index * object_size),
+                object_size);
+    offset += next_sample_interval();
+  }
+  bytes_until_sample = offset - size;
+}
+
+void profile_record_deaths(uint8_t *start, uint8_t *end) {
+  if (!profile_initialized) {
+    return;
+  }
+  size_t n_kept = 0;
+  for (size_t i = 0; i < n_samples; i++) {
+    struct profile_sample sample = samples[i];
+    uint8_t *ptr = (uint8_t *)sample.obj;
+    if (ptr >= start && ptr < end && !is_pinned(sample.obj)) {
+      stella_object *new_location = as_forward_ptr(sample.obj);
+      // Copies merged by deduplication are forward pointers themselves
+      if (new_location == NULLPTR || is_forward_ptr(new_location)) {
+        stacks[sample.stack].inuse_count--;
+        stacks[sample.stack].inuse_bytes -= sample.size;
+        continue;
+      }
+      sample.obj = new_location;
+    }
+    samples[n_kept++] = sample;
+  }
+  n_samples = n_kept;
+}
+
+void profile_record_sweep(uint8_t *start, uint8_t *end,
+                          bool (*is_live)(stella_object *obj)) {
+  if (!profile_initialized) {
+    return;
+  }
+  size_t n_kept = 0;
+  for (size_t i = 0; i < n_samples; i++) {
+    struct profile_sample sample = samples[i];
+    uint8_t *ptr = (uint8_t *)sample.obj;
+    if (ptr >= start && ptr < end && !is_live(sample.obj)) {
+      stacks[sample.stack].inuse_count--;
+      stacks[sample.stack].inuse_bytes -= sample.size;
+      continue;
+    }
+    samples[n_kept++] = sample;
+  }
+  n_samples = n_kept;
+}
+
+void profile_destroy(void) {
+  free(samples);
+  free(stacks);
+  free(stack_index);
+  samples = NULLPTR;
+  stacks = NULLPTR;
+  stack_index = NULLPTR;
+  n_samples = 0;
+  samples_capacity = 0;
+  n_stacks = 0;
+  stacks_capacity = 0;
+  stack_index_capacity = 0;
+  profile_initialized = false;
+}
+
+// The memory map lets pprof symbolize the frames
+static void write_memory_map(FILE *file) {
+  FILE *maps = fopen("/proc/self/maps", "r");
+  if (maps == NULLPTR) {
+    return;
+  }
+  fprintf(file, "\nMAPPED_LIBRARIES:\n");
+  char buffer[4096];
+  size_t n_read;
+  while ((n_read = fread(buffer, 1, sizeof(buffer), maps)) > 0) {
+    fwrite(buffer, 1, n_read, file);
+  }
+  fclose(maps);
+}
+
+void profile_write(void) {
+  if (!profile_initialized) {
+    return;
+  }
+  char path[PATH_MAX];
+  gc_heap_output_path(path, sizeof(path), profile_output_path());
+  FILE *file = fopen(path, "w");
+  if (file == NULLPTR) {
+    fprintf(stderr, "Could not write heap profile to %s\n", path);
+    return;
+  }
+  struct profile_stack total;
+  memset(&total, 0, sizeof(total));
+  for (size_t i = 0; i < n_stacks; i++) {
+    total.alloc_count += stacks[i].alloc_count;
+    total.alloc_bytes += stacks[i].alloc_bytes;
+    total.inuse_count += stacks[i].inuse_count;
+    total.inuse_bytes += stacks[i].inuse_bytes;
+  }
+  // Counts are of samples, pprof scales them by the sampling rate
+  fprintf(file, "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu\n",
+          (unsigned long long)total.inuse_count,
+          (unsigned long long)total.inuse_bytes,
+          (unsigned long long)total.alloc_count,
+          (unsigned long long)total.alloc_bytes,
+          (unsigned long long)profile_rate);
+  for (size_t i = 0; i < n_stacks; i++) {
+    struct profile_stack *stack = &stacks[i];
+    fprintf(file, "%llu: %llu [%llu: %llu] @",
+            (unsigned long long)stack->inuse_count,
+            (unsigned long long)stack->inuse_bytes,
+            (unsigned long long)stack->alloc_count,
+            (unsigned long long)stack->alloc_bytes);
+    for (int frame = 0; frame < stack->depth; frame++) {
+      fprintf(file, " %p", stack->frames[frame]);
+    }
+    fprintf(file, "\n");
+  }
+  write_memory_map(file);
+  fclose(file);
+}
+
+static void write_profiles(void) { gc_heap_for_each(profile_write); }
+
+void print_profile_stats(void) {
+  if (!profile_initialized) {
+    return;
+  }
+  uint64_t n_sampled = 0;
+  for (size_t i = 0; i < n_stacks; i++) {
+    n_sampled += stacks[i].alloc_count;
+  }
+  printf("Heap profiling:                  %'llu samples, %'zu alive\n",
+         (unsigned long long)n_sampled, n_samples);
+  printf("    Sampling rate:               every %'llu bytes\n",
+         (unsigned long long)profile_rate);
+  printf("    Distinct stacks:             %'zu\n", n_stacks);
+  char path[PATH_MAX];
+  gc_heap_output_path(path, sizeof(path), profile_output_path());
+  printf("    Profile (written at exit):   %s\n", path);
+}
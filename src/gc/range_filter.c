@@ -0,0 +1,94 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gc/range_filter.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define RANGE_FILTER_X86
+#endif
+
+#define RANGE_FILTER_MIN_VECTOR_WORDS (4)
+
+// All kernels test (word - start) < size as unsigned numbers, which checks
+// both bounds with one comparison
+
+static uint64_t range_filter_scalar(void *const *words, int from, int n_words,
+                                    uint64_t start, uint64_t size) {
+  uint64_t mask = 0;
+  for (int i = from; i < n_words; i++) {
+    uint64_t offset = (uint64_t)(uintptr_t)words[i] - start;
+    mask |= (uint64_t)(offset < size) << i;
+  }
+  return mask;
+}
+
+#ifdef RANGE_FILTER_X86
+
+// AVX2 only has a signed 64-bit comparison, so the sign bit of both sides is
+// flipped to compare them as unsigned
+__attribute__((target("avx2"))) static uint64_t
+range_filter_avx2(void *const *words, int n_words, uint64_t start,
+                  uint64_t size) {
+  const __m256i sign = _mm256_set1_epi64x((long long)(1ULL << 63));
+  const __m256i start_v = _mm256_set1_epi64x((long long)start);
+  const __m256i size_v = _mm256_xor_si256(_mm256_set1_epi64x((long long)size),
+                                          sign);
+  uint64_t mask = 0;
+  int i = 0;
+  for (; i + 4 <= n_words; i += 4) {
+    __m256i w = _mm256_loadu_si256((const __m256i *)(words + i));
+    __m256i offset = _mm256_xor_si256(_mm256_sub_epi64(w, start_v), sign);
+    __m256i hit = _mm256_cmpgt_epi64(size_v, offset);
+    mask |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(hit)) << i;
+  }
+  return mask | range_filter_scalar(words, i, n_words, start, size);
+}
+
+// SSE2 has no 64-bit comparison at all. For spaces below 4 GB an offset is in
+// range if its high half is zero and its low half is below size.
+static uint64_t range_filter_sse2(void *const *words, int n_words,
+                                  uint64_t start, uint64_t size) {
+  assert(size <= UINT32_MAX);
+  const __m128i sign = _mm_set1_epi32((int)0x80000000U);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i start_v = _mm_set1_epi64x((long long)start);
+  const __m128i size_v = _mm_xor_si128(_mm_set1_epi32((int)size), sign);
+  uint64_t mask = 0;
+  int i = 0;
+  for (; i + 2 <= n_words; i += 2) {
+    __m128i w = _mm_loadu_si128((const __m128i *)(words + i));
+    __m128i offset = _mm_sub_epi64(w, start_v);
+    __m128i high_zero = _mm_cmpeq_epi32(offset, zero);
+    __m128i low_below =
+        _mm_cmplt_epi32(_mm_xor_si128(offset, sign), size_v);
+    // Move the low half results into the high halves, whose sign bits are
+    // collected by movemask
+    __m128i hit = _mm_and_si128(
+        high_zero, _mm_shuffle_epi32(low_below, _MM_SHUFFLE(2, 2, 0, 0)));
+    mask |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(hit)) << i;
+  }
+  return mask | range_filter_scalar(words, i, n_words, start, size);
+}
+
+#endif // RANGE_FILTER_X86
+
+uint64_t range_filter(void *const *words, int n_words, const uint8_t *start,
+                      size_t size) {
+  assert(n_words <= RANGE_FILTER_MAX_WORDS);
+  uint64_t start_u = (uint64_t)(uintptr_t)start;
+#ifdef RANGE_FILTER_X86
+  // Most objects have only a few fields, which are not worth a vector
+  if (n_words < RANGE_FILTER_MIN_VECTOR_WORDS) {
+    return range_filter_scalar(words, 0, n_words, start_u, size);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return range_filter_avx2(words, n_words, start_u, size);
+  }
+  if (size <= UINT32_MAX) {
+    return range_filter_sse2(words, n_words, start_u, size);
+  }
+#endif
+  return range_filter_scalar(words, 0, n_words, start_u, size);
+}
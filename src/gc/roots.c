@@ -7,6 +7,7 @@
 #include "gc/gen0.h"
 #include "gc/gen1.h"
 #include "gc/parameters.h"
+#include "gc/range_filter.h"
 #include "gc/roots.h"
 
 #include "gc/debug.h"
@@ -14,62 +15,153 @@
 #include "gc/utils.h"
 #include "runtime_extras.h"
 
-int var_roots_next_index = 0;
-void **var_roots[MAX_VAR_ROOTS];
+void initialize_var_roots(void) {
+  var_roots_first.prev = NULLPTR;
+  var_roots_first.next = NULLPTR;
+  var_roots_top = &var_roots_first;
+  var_roots_top_index = 0;
+}
+
+static void free_var_roots_segments(struct var_roots_segment *segment) {
+  while (segment != NULLPTR) {
+    struct var_roots_segment *next = segment->next;
+    free(segment);
+    segment = next;
+  }
+}
+
+void destroy_var_roots(void) {
+  free_var_roots_segments(var_roots_first.next);
+  var_roots_first.next = NULLPTR;
+  var_roots_top = &var_roots_first;
+  var_roots_top_index = 0;
+  var_roots_next_index = 0;
+}
 
-int roots_from_gen0_to_gen1_next_index = 0;
-void **roots_from_gen0_to_gen1[MAX_ROOTS_FROM_GEN0_TO_GEN1];
+static void push_var_roots_segment(void) {
+  struct var_roots_segment *next = var_roots_top->next;
+  if (next == NULLPTR) {
+    next = malloc(sizeof(struct var_roots_segment));
+    if (next == NULLPTR) {
+      printf("Out of memory: could not allocate a segment of roots\n");
+      exit(1);
+    }
+    next->prev = var_roots_top;
+    next->next = NULLPTR;
+    var_roots_top->next = next;
+    GC_DEBUG_PRINTF("push_var_roots_segment(): new segment %p\n",
+                    (void *)next);
+  }
+  var_roots_top = next;
+  var_roots_top_index = 0;
+}
 
-int roots_from_gen1_to_gen0_next_index = 0;
-void **roots_from_gen1_to_gen0[MAX_ROOTS_FROM_GEN0_TO_GEN1];
+static void pop_var_roots_segment(void) {
+  // The emptied segment is kept, the one above it is released
+  free_var_roots_segments(var_roots_top->next);
+  var_roots_top->next = NULLPTR;
+  var_roots_top = var_roots_top->prev;
+  var_roots_top_index = VAR_ROOTS_SEGMENT_SIZE;
+}
 
 void push_var_root(void **ptr) {
   GC_DEBUG_PRINTF("push_var_root(): Pushed root %p\n", (void *)ptr);
-  if (var_roots_next_index >= MAX_VAR_ROOTS) {
-    printf("Out of space for roots: could not push root %p\n", (void *)ptr);
-    exit(1);
+  if (var_roots_top_index == VAR_ROOTS_SEGMENT_SIZE) {
+    push_var_roots_segment();
   }
   stats_record_push_root();
-  var_roots[var_roots_next_index++] = ptr;
+  var_roots_top->roots[var_roots_top_index++] = ptr;
+  var_roots_next_index++;
 }
 
 void pop_var_root(__attribute__((unused)) void **ptr) {
   GC_DEBUG_PRINTF("pop_var_root(): Popped root %p\n", (void *)ptr);
   assert(var_roots_next_index > 0);
+  var_roots_top_index--;
   var_roots_next_index--;
+  if (var_roots_top_index == 0 && var_roots_top->prev != NULLPTR) {
+    pop_var_roots_segment();
+  }
 }
 
-void scan_space_for_roots(void **roots[], int *next_root_index,
+#ifdef STELLA_GC_COMPRESSED_REFS
+// Compressed fields are compared with the compressed bounds of the target
+// space, there is nothing to decode
+void scan_space_for_roots(gc_ref *roots[], int *next_root_index,
                           uint8_t *space_start, uint8_t *space_end,
-                          bool (*check_belongs_to_target_space)(uint8_t *)) {
+                          uint8_t *target_space, size_t target_space_size) {
   *next_root_index = 0;
+  gc_ref target_start = gc_ref_encode(target_space);
+  gc_ref target_size = (gc_ref)(target_space_size >> GC_REF_SHIFT);
   uint8_t *cur_ptr = space_start;
   while (cur_ptr < space_end) {
     stella_object *cur_obj = (stella_object *)cur_ptr;
     cur_ptr += gc_size_of_object(cur_obj);
-    if (is_forward_ptr(cur_obj)) {
-      void **root = &(cur_obj->object_fields[0]);
-      if (check_belongs_to_target_space((uint8_t *)*root)) {
-        roots[*next_root_index] = root;
+    gc_ref *fields = cur_obj->object_fields;
+    int n_fields = get_fields_count(cur_obj);
+    for (int i = 0; i < n_fields; i++) {
+      if ((gc_ref)(fields[i] - target_start) < target_size) {
+        roots[*next_root_index] = &fields[i];
         *next_root_index = *next_root_index + 1;
       }
     }
-    for (int i = 0; i < get_fields_count(cur_obj); i++) {
-      void **root = &(cur_obj->object_fields[i]);
-      if (check_belongs_to_target_space((uint8_t *)*root)) {
-        roots[*next_root_index] = root;
+  }
+  assert(cur_ptr == space_end);
+}
+#else
+static uint64_t low_bits(int count) {
+  return count >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1);
+}
+
+// The space is tested in windows of RANGE_FILTER_MAX_WORDS words (headers
+// included), and each object only looks at the bits of its own fields. So only
+// the fields pointing into the target space are visited one by one.
+void scan_space_for_roots(gc_ref *roots[], int *next_root_index,
+                          uint8_t *space_start, uint8_t *space_end,
+                          uint8_t *target_space, size_t target_space_size) {
+  *next_root_index = 0;
+  void **window = (void **)space_start;
+  int window_size = 0;
+  uint64_t window_mask = 0;
+  uint8_t *cur_ptr = space_start;
+  while (cur_ptr < space_end) {
+    stella_object *cur_obj = (stella_object *)cur_ptr;
+    cur_ptr += gc_size_of_object(cur_obj);
+    gc_ref *fields = cur_obj->object_fields;
+    int n_fields = get_fields_count(cur_obj);
+    int i = 0;
+    while (i < n_fields) {
+      if (fields + i >= window + window_size) {
+        window = fields + i;
+        long words_left = (void **)space_end - window;
+        window_size = words_left < RANGE_FILTER_MAX_WORDS
+                          ? (int)words_left
+                          : RANGE_FILTER_MAX_WORDS;
+        window_mask =
+            range_filter(window, window_size, target_space, target_space_size);
+      }
+      int offset = (int)(fields + i - window);
+      int count = n_fields - i < window_size - offset ? n_fields - i
+                                                      : window_size - offset;
+      uint64_t hits = (window_mask >> offset) & low_bits(count);
+      while (hits != 0) {
+        roots[*next_root_index] = &fields[i + __builtin_ctzll(hits)];
         *next_root_index = *next_root_index + 1;
+        hits &= hits - 1;
       }
+      i += count;
     }
   }
   assert(cur_ptr == space_end);
 }
+#endif
 
 // Roots from Gen0 to Gen1
 void scan_gen0_for_roots_to_gen1(void) {
   scan_space_for_roots(roots_from_gen0_to_gen1,
                        &roots_from_gen0_to_gen1_next_index, gen0_space,
-                       gen0_alloc_ptr, points_to_fromspace);
+                       gen0_alloc_ptr, gen1_fromspace,
+                       GEN1_SPACE_SIZE);
   GC_DEBUG_PRINTF("scan_gen0_for_roots_to_gen1(): Scanned Gen0 "
                   "for roots and "
                   "found %d roots to Gen1\n",
@@ -78,9 +170,13 @@ void scan_gen0_for_roots_to_gen1(void) {
 
 // Roots from Gen1 to Gen0
 void scan_gen1_for_roots_to_gen0(void) {
+  // During a Gen0 collection objects past gen0_scan_ptr are promoted ones,
+  // and their fields are forwarded by the Cheney scan anyway
+  uint8_t *scan_end =
+      gen0_scan_ptr != NULLPTR ? gen0_scan_ptr : gen1_alloc_ptr;
   scan_space_for_roots(roots_from_gen1_to_gen0,
                        &roots_from_gen1_to_gen0_next_index, gen1_fromspace,
-                       gen1_alloc_ptr, points_to_gen0_space);
+                       scan_end, gen0_space, gen0_space_size);
   GC_DEBUG_PRINTF("scan_gen1_for_roots_to_gen0(): Scanned Gen1 "
                   "for roots and "
                   "found %d roots to Gen0\n",
@@ -0,0 +1,198 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gc/scheduler.h"
+
+#include "gc/debug.h"
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/heap.h"
+#include "gc/nursery.h"
+#include "gc/parameters.h"
+
+// Weight of the last Gen0 collection in the promotion rate
+#define PROMOTION_RATE_EWMA_WEIGHT 0.3
+
+// Promotion is predicted to be this many times larger than the average
+#define PROMOTION_HEADROOM 1.5
+
+// Weight of the last collection in the costs per byte
+#define COST_EWMA_WEIGHT 0.3
+
+// Cost of a collection per byte in use until one of the kind is measured
+#define DEFAULT_NS_PER_BYTE 1.0
+
+// An idle collection is only worth it if the space is used at least this
+// much, otherwise it barely delays the next collection
+#define IDLE_MINOR_MIN_OCCUPANCY 0.25
+
+// Same for a major collection, which can at most free what Gen1 grew by since
+// the last one: it is only worth it once Gen1 has taken this much of the room
+// left by the last one. Live data filling Gen1 does not count.
+#define IDLE_MAJOR_MIN_GROWTH 0.5
+
+// A nursery in Gen1 to-space shrinks with every promotion. A major collection
+// is done instead of a minor one when the next nursery would be smaller.
+#define APPEL_MIN_NURSERY_SIZE (GEN0_SPACE_SIZE / 4)
+
+// Fraction of used Gen0 bytes promoted to Gen1. Until the first collection
+// everything is assumed to survive.
+#define promotion_rate_ewma (gc_current_heap->scheduler.promotion_rate_ewma)
+#define minor_ns_per_byte_ewma                                                 \
+  (gc_current_heap->scheduler.minor_ns_per_byte_ewma)
+#define major_ns_per_byte_ewma                                                 \
+  (gc_current_heap->scheduler.major_ns_per_byte_ewma)
+#define idle_n_collects (gc_current_heap->scheduler.idle_n_collects)
+
+void scheduler_record_promotion(size_t used_bytes, size_t promoted_bytes) {
+  if (used_bytes == 0) {
+    return;
+  }
+  double promotion_rate = (double)promoted_bytes / (double)used_bytes;
+  promotion_rate_ewma = PROMOTION_RATE_EWMA_WEIGHT * promotion_rate +
+                        (1 - PROMOTION_RATE_EWMA_WEIGHT) * promotion_rate_ewma;
+}
+
+static size_t predict_promoted_bytes(size_t used_bytes) {
+  double predicted = promotion_rate_ewma * PROMOTION_HEADROOM * used_bytes;
+  // Gen0 can not promote more than it contains
+  if (predicted > (double)used_bytes) {
+    return used_bytes;
+  }
+  return (size_t)predicted;
+}
+
+static size_t gen0_used_bytes(void) {
+  return gen0_alloc_ptr - gen0_space;
+}
+
+static size_t gen1_used_bytes(void) { return gen1_alloc_ptr - gen1_fromspace; }
+
+static void record_cost(double *ns_per_byte_ewma, uint64_t ns,
+                        size_t used_bytes) {
+  if (used_bytes == 0) {
+    return;
+  }
+  double ns_per_byte = (double)ns / (double)used_bytes;
+  *ns_per_byte_ewma = *ns_per_byte_ewma == 0
+                          ? ns_per_byte
+                          : COST_EWMA_WEIGHT * ns_per_byte +
+                                (1 - COST_EWMA_WEIGHT) * *ns_per_byte_ewma;
+}
+
+static uint64_t predict_ns(double ns_per_byte_ewma, size_t used_bytes) {
+  double ns_per_byte =
+      ns_per_byte_ewma != 0 ? ns_per_byte_ewma : DEFAULT_NS_PER_BYTE;
+  return (uint64_t)(ns_per_byte * (double)used_bytes);
+}
+
+static void collect_minor(void) {
+  gen2_poll_marking();
+  size_t used_bytes = gen0_used_bytes();
+  uint64_t start_ns = nursery_clock_ns();
+  gen0_collect();
+  record_cost(&minor_ns_per_byte_ewma, nursery_clock_ns() - start_ns,
+              used_bytes);
+}
+
+// Full-heap collection, or a Gen1 collection if there is no Gen0
+static void collect_major(void) {
+  gen2_poll_marking();
+  size_t used_bytes = gen0_used_bytes() + gen1_used_bytes();
+  uint64_t start_ns = nursery_clock_ns();
+  if (gen0_gc_initialized) {
+    gen1_collect_full();
+  } else {
+    gen1_collect();
+  }
+  record_cost(&major_ns_per_byte_ewma, nursery_clock_ns() - start_ns,
+              used_bytes);
+}
+
+// Whether Gen1 has too little room for the survivors of a minor collection,
+// so that a major collection has to run instead
+static bool minor_overflows_gen1(void) {
+  size_t used_bytes = gen0_alloc_ptr - gen0_space;
+  size_t gen1_free_bytes = GEN1_SPACE_SIZE - (gen1_alloc_ptr - gen1_fromspace);
+  size_t predicted_bytes = predict_promoted_bytes(used_bytes);
+  GC_DEBUG_PRINTF("minor_overflows_gen1(): Gen0 used %#zx bytes, predicted "
+                  "promotion %#zx bytes, Gen1 free %#zx bytes\n",
+                  used_bytes, predicted_bytes, gen1_free_bytes);
+  return predicted_bytes > gen1_free_bytes ||
+         (gen0_in_tospace &&
+          gen1_free_bytes < predicted_bytes + APPEL_MIN_NURSERY_SIZE);
+}
+
+void scheduler_collect(void) {
+  if (minor_overflows_gen1()) {
+    collect_major();
+  } else {
+    collect_minor();
+  }
+}
+
+void scheduler_collect_generation(int generation) {
+  assert(generation >= 0);
+  if (generation == 0 && gen0_gc_initialized) {
+    scheduler_collect();
+    return;
+  }
+  if (generation >= 2 && gen2_enabled) {
+    gen2_request_collection();
+  }
+  collect_major();
+}
+
+// Bytes promoted to (or allocated in) Gen1 since its last collection, and the
+// room that collection left
+static size_t gen1_grown_bytes(void) {
+  size_t used_bytes = gen1_used_bytes();
+  return used_bytes > gen1_residency_bytes ? used_bytes - gen1_residency_bytes
+                                           : 0;
+}
+
+static size_t gen1_room_bytes(void) {
+  return GEN1_SPACE_SIZE - gen1_residency_bytes;
+}
+
+int scheduler_idle_hint(uint64_t budget_ns) {
+  size_t gen0_used = gen0_used_bytes();
+  size_t gen1_used = gen1_used_bytes();
+  size_t gen1_grown = gen1_grown_bytes();
+  uint64_t major_ns = predict_ns(major_ns_per_byte_ewma, gen0_used + gen1_used);
+  uint64_t minor_ns = predict_ns(minor_ns_per_byte_ewma, gen0_used);
+  GC_DEBUG_PRINTF("scheduler_idle_hint(%llu): Gen0 used %#zx bytes (minor "
+                  "%llu ns), Gen1 used %#zx bytes, %#zx since its last "
+                  "collection (major %llu ns)\n",
+                  (unsigned long long)budget_ns, gen0_used,
+                  (unsigned long long)minor_ns, gen1_used, gen1_grown,
+                  (unsigned long long)major_ns);
+  // A major collection empties Gen0 as well, so it is preferred when Gen1
+  // fills up
+  if (gen1_grown > 0 &&
+      gen1_grown >= IDLE_MAJOR_MIN_GROWTH * gen1_room_bytes() &&
+      major_ns <= budget_ns) {
+    idle_n_collects++;
+    collect_major();
+    return 1;
+  }
+  if (gen0_gc_initialized &&
+      gen0_used >= IDLE_MINOR_MIN_OCCUPANCY * gen0_limit_size) {
+    // The kind is chosen before the budget is checked, as emptying Gen0 may
+    // take a major collection
+    bool major = minor_overflows_gen1();
+    if ((major ? major_ns : minor_ns) <= budget_ns) {
+      idle_n_collects++;
+      if (major) {
+        collect_major();
+        return 1;
+      }
+      collect_minor();
+      return 0;
+    }
+  }
+  return -1;
+}
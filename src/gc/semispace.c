@@ -0,0 +1,61 @@
+#include <stdlib.h>
+
+#include "gc/collector.h"
+
+#include "gc/gen1.h"
+#include "gc/lifetime.h"
+#include "gc/roots.h"
+#include "gc/scheduler.h"
+#include "gc/stats.h"
+
+// A single semispace collector: Gen0 is never initialized, so Gen1 has no
+// roots from Gen0 and objects are allocated directly in from-space.
+
+void semispace_initialize(void) { gen1_initialize(); }
+
+void *semispace_alloc(size_t size_in_bytes) {
+  if (GC_LIFETIME_COLLECTION_DUE()) {
+    gen1_collect();
+  }
+  void *obj = gen1_alloc(size_in_bytes);
+  GC_LIFETIME_RECORD_BIRTH(obj, size_in_bytes);
+  return obj;
+}
+
+size_t semispace_alloc_many(size_t object_size, size_t count, void **block) {
+  if (GC_LIFETIME_COLLECTION_DUE()) {
+    gen1_collect();
+  }
+  size_t n_objects = gen1_alloc_many(object_size, count, block);
+  for (size_t i = 0; i < n_objects; i++) {
+    GC_LIFETIME_RECORD_BIRTH((uint8_t *)*block + i * object_size, object_size);
+  }
+  return n_objects;
+}
+
+void semispace_read_barrier(__attribute__((unused)) void *object,
+                            __attribute__((unused)) int field_index) {}
+
+void semispace_write_barrier(__attribute__((unused)) void *object,
+                             __attribute__((unused)) int field_index,
+                             __attribute__((unused)) void *contents) {}
+
+void semispace_push_root(void **root) { push_var_root(root); }
+
+void semispace_pop_root(void **root) { pop_var_root(root); }
+
+void semispace_collect(int generation) {
+  scheduler_collect_generation(generation);
+}
+
+int semispace_idle_hint(uint64_t budget_ns) {
+  return scheduler_idle_hint(budget_ns);
+}
+
+void semispace_print_stats(void) { print_stats(); }
+
+void semispace_print_state(void) { generational_print_state(); }
+
+void semispace_destroy(void) { gen1_destroy(); }
+
+GC_DEFINE_COLLECTOR(semispace);
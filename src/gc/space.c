@@ -0,0 +1,188 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gc.h>
+
+#include "gc/space.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+
+static size_t page_round_up(size_t size) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+static uint8_t *align_up(uint8_t *ptr, size_t alignment) {
+  return (uint8_t *)(((uintptr_t)ptr + alignment - 1) & ~(alignment - 1));
+}
+
+#ifdef STELLA_GC_COMPRESSED_REFS
+
+#ifndef MAP_FIXED_NOREPLACE
+// Without the flag the address is only a hint, the result is checked anyway
+#define MAP_FIXED_NOREPLACE 0
+#endif
+
+// The region starts this far above the executable, which leaves room for the
+// program break
+#define COMPRESSED_REGION_OFFSET ((uintptr_t)4 * GIGABYTE)
+#define COMPRESSED_REGION_SIZE (GC_REF_RANGE - COMPRESSED_REGION_OFFSET)
+
+#define MAX_FREE_SPACES 64
+
+struct free_space {
+  uint8_t *start;
+  size_t size;
+};
+
+// The region is reserved on the first allocation and never released. Spaces
+// are bump-allocated from it, and freed spaces are reused by spaces of the
+// same size (all heaps have spaces of the same sizes).
+static uint8_t *region_start = NULLPTR;
+static uint8_t *region_alloc_ptr = NULLPTR;
+static struct free_space free_spaces[MAX_FREE_SPACES];
+static int n_free_spaces = 0;
+static atomic_flag region_lock = ATOMIC_FLAG_INIT;
+
+static void lock_region(void) {
+  while (atomic_flag_test_and_set_explicit(&region_lock,
+                                           memory_order_acquire)) {
+  }
+}
+
+static void unlock_region(void) {
+  atomic_flag_clear_explicit(&region_lock, memory_order_release);
+}
+
+static void reserve_region(void) {
+  void *preferred = (void *)(GC_REF_BASE + COMPRESSED_REGION_OFFSET);
+  void *start = mmap(preferred, COMPRESSED_REGION_SIZE, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+                         MAP_FIXED_NOREPLACE,
+                     -1, 0);
+  if (start != preferred) {
+    printf("Could not reserve the heap region for compressed references at "
+           "%p\n",
+           preferred);
+    exit(1);
+  }
+  region_start = start;
+  region_alloc_ptr = start;
+  GC_DEBUG_PRINTF("reserve_region(): reserved %p..%p\n", start,
+                  (void *)(region_start + COMPRESSED_REGION_SIZE));
+}
+
+static uint8_t *take_free_space(size_t size, size_t alignment) {
+  for (int i = 0; i < n_free_spaces; i++) {
+    if (free_spaces[i].size == size &&
+        align_up(free_spaces[i].start, alignment) == free_spaces[i].start) {
+      uint8_t *space = free_spaces[i].start;
+      free_spaces[i] = free_spaces[--n_free_spaces];
+      return space;
+    }
+  }
+  return NULLPTR;
+}
+
+uint8_t *space_alloc_aligned(size_t size, size_t alignment) {
+  size = page_round_up(size);
+  lock_region();
+  if (region_start == NULLPTR) {
+    reserve_region();
+  }
+  uint8_t *space = take_free_space(size, alignment);
+  // The skipped gap is lost
+  uint8_t *aligned_ptr = align_up(region_alloc_ptr, alignment);
+  uint8_t *region_end = region_start + COMPRESSED_REGION_SIZE;
+  if (space == NULLPTR && aligned_ptr <= region_end &&
+      size <= (size_t)(region_end - aligned_ptr)) {
+    space = aligned_ptr;
+    region_alloc_ptr = aligned_ptr + size;
+  }
+  unlock_region();
+  if (space == NULLPTR ||
+      mprotect(space, size, PROT_READ | PROT_WRITE) != 0) {
+    printf("Out of memory: could not allocate a space of %zx bytes in the "
+           "heap region\n",
+           size);
+    exit(1);
+  }
+  GC_DEBUG_PRINTF("space_alloc_aligned(%#zx, %#zx): %p\n", size, alignment,
+                  (void *)space);
+  return space;
+}
+
+uint8_t *space_alloc(size_t size) {
+  return space_alloc_aligned(size, (size_t)sysconf(_SC_PAGESIZE));
+}
+
+void space_free(uint8_t *space, size_t size) {
+  if (space == NULLPTR) {
+    return;
+  }
+  size = page_round_up(size);
+  // Give the memory back, the addresses stay reserved
+  mmap(space, size, PROT_NONE,
+       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  lock_region();
+  if (n_free_spaces < MAX_FREE_SPACES) {
+    free_spaces[n_free_spaces++] =
+        (struct free_space){.start = space, .size = size};
+  }
+  unlock_region();
+}
+
+void space_free_aligned(uint8_t *space, size_t size) {
+  space_free(space, size);
+}
+
+#else
+
+uint8_t *space_alloc(size_t size) {
+  uint8_t *space = malloc(size);
+  if (space == NULLPTR) {
+    printf("Out of memory: could not allocate a space of %zx bytes\n", size);
+    exit(1);
+  }
+  return space;
+}
+
+void space_free(uint8_t *space, __attribute__((unused)) size_t size) {
+  free(space);
+}
+
+uint8_t *space_alloc_aligned(size_t size, size_t alignment) {
+  size = page_round_up(size);
+  // Over-allocate and unmap what is outside of the aligned space
+  size_t mapped_size = size + page_round_up(alignment);
+  uint8_t *mapped = mmap(NULLPTR, mapped_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapped == MAP_FAILED) {
+    printf("Out of memory: could not map a space of %zx bytes\n", size);
+    exit(1);
+  }
+  uint8_t *space = align_up(mapped, alignment);
+  if (space > mapped) {
+    munmap(mapped, space - mapped);
+  }
+  if (space + size < mapped + mapped_size) {
+    munmap(space + size, mapped + mapped_size - (space + size));
+  }
+  GC_DEBUG_PRINTF("space_alloc_aligned(%#zx, %#zx): %p\n", size, alignment,
+                  (void *)space);
+  return space;
+}
+
+void space_free_aligned(uint8_t *space, size_t size) {
+  if (space != NULLPTR) {
+    munmap(space, page_round_up(size));
+  }
+}
+
+#endif
@@ -6,19 +6,32 @@
 
 #include "gc/stats.h"
 
+#include "gc/dedup.h"
 #include "gc/gen0.h"
 #include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/heap.h"
+#include "gc/lifetime.h"
+#include "gc/nursery.h"
 #include "gc/parameters.h"
+#include "gc/perf.h"
+#include "gc/pin.h"
+#include "gc/profile.h"
 #include "gc/roots.h"
 
-size_t total_allocated_bytes = 0;
-uint64_t total_allocated_objects = 0;
-uint64_t max_n_gc_roots = 0;
-uint64_t max_gen0_allocated_memory = 0;
-uint64_t max_gen1_allocated_memory = 0;
-uint64_t max_allocated_memory = 0;
-uint64_t gen0_n_collects = 0;
-uint64_t gen1_n_collects = 0;
+#define total_allocated_bytes (gc_current_heap->stats.allocated_bytes)
+#define total_allocated_objects (gc_current_heap->stats.allocated_objects)
+#define max_n_gc_roots (gc_current_heap->stats.max_n_roots)
+#define max_gen0_allocated_memory                                              \
+  (gc_current_heap->stats.max_gen0_allocated_memory)
+#define max_gen1_allocated_memory                                              \
+  (gc_current_heap->stats.max_gen1_allocated_memory)
+#define max_allocated_memory (gc_current_heap->stats.max_allocated_memory)
+#define gen0_n_collects (gc_current_heap->stats.gen0_n_collects)
+#define gen1_n_collects (gc_current_heap->stats.gen1_n_collects)
+#define full_n_collects (gc_current_heap->stats.full_n_collects)
+#define nested_n_collects (gc_current_heap->stats.nested_n_collects)
+#define total_copied_bytes (gc_current_heap->stats.copied_bytes)
 
 void stats_record_push_root(void) {
   uint64_t next_n_roots = var_roots_next_index + 1;
@@ -27,8 +40,8 @@ void stats_record_push_root(void) {
   }
 }
 
-static void add_allocation_to_total(size_t size_in_bytes) {
-  total_allocated_objects += 1;
+static void add_allocation_to_total(size_t size_in_bytes, size_t n_objects) {
+  total_allocated_objects += n_objects;
   total_allocated_bytes += size_in_bytes;
 }
 
@@ -49,7 +62,11 @@ void stats_record_max_residency(void) {
 }
 
 void stats_record_allocation(size_t size_in_bytes) {
-  add_allocation_to_total(size_in_bytes);
+  add_allocation_to_total(size_in_bytes, 1);
+}
+
+void stats_record_bulk_allocation(size_t object_size, size_t n_objects) {
+  add_allocation_to_total(object_size * n_objects, n_objects);
 }
 
 void stats_record_collect(int gen_n) {
@@ -61,22 +78,108 @@ void stats_record_collect(int gen_n) {
   }
 }
 
+void stats_record_full_collect(void) { full_n_collects++; }
+
+void stats_record_nested_collect(void) { nested_n_collects++; }
+
+void stats_record_copied_bytes(size_t size_in_bytes) {
+  total_copied_bytes += size_in_bytes;
+}
+
 void print_stats(void) {
   printf("MAX_ALLOC_SIZE:                  %zu bytes\n",
          (size_t)MAX_ALLOC_SIZE);
-  printf("    Gen0 space size:             %zu bytes\n", GEN0_SPACE_SIZE);
+  if (gen0_gc_initialized && gen0_in_tospace) {
+    printf("    Gen0 space size:             %zu bytes now, in Gen1 to-space\n",
+           gen0_space_size);
+  } else {
+    printf("    Gen0 space size:             %zu bytes\n", GEN0_SPACE_SIZE);
+  }
   printf("    Gen1 space size:             %zu bytes\n", GEN1_SPACE_SIZE);
   printf("Total memory allocation:         %'zu bytes (%llu objects)\n",
-         total_allocated_bytes, total_allocated_objects);
+         total_allocated_bytes, (unsigned long long)total_allocated_objects);
   printf("Maximum residency:               %'llu bytes\n",
-         max_allocated_memory);
+         (unsigned long long)max_allocated_memory);
   printf("    Gen0:                        %'llu bytes\n",
-         max_gen0_allocated_memory);
+         (unsigned long long)max_gen0_allocated_memory);
   printf("    Gen1:                        %'llu bytes\n",
-         max_gen1_allocated_memory);
+         (unsigned long long)max_gen1_allocated_memory);
   printf("Total number of GC cycles:       %'llu times\n",
-         gen0_n_collects + gen1_n_collects);
-  printf("    Gen0 cycles:                 %'llu times\n", gen0_n_collects);
-  printf("    Gen1 cycles:                 %'llu times\n", gen1_n_collects);
-  printf("Maximum number of roots:         %'llu\n", max_n_gc_roots);
+         (unsigned long long)(gen0_n_collects + gen1_n_collects +
+                              full_n_collects));
+  printf("    Gen0 cycles:                 %'llu times\n",
+         (unsigned long long)gen0_n_collects);
+  printf("    Gen1 cycles:                 %'llu times\n",
+         (unsigned long long)gen1_n_collects);
+  printf("        nested in Gen0 cycles:   %'llu times\n",
+         (unsigned long long)nested_n_collects);
+  printf("    Full-heap cycles:            %'llu times\n",
+         (unsigned long long)full_n_collects);
+  if (gc_current_heap->scheduler.idle_n_collects > 0) {
+    printf("    Started at idle time:        %'llu times\n",
+           (unsigned long long)gc_current_heap->scheduler.idle_n_collects);
+  }
+  printf("Total memory copied:             %'llu bytes\n",
+         (unsigned long long)total_copied_bytes);
+  printf("Maximum number of roots:         %'llu\n",
+         (unsigned long long)max_n_gc_roots);
+  if (nursery_is_adaptive) {
+    print_nursery_stats();
+  }
+  if (gen2_enabled) {
+    print_gen2_stats();
+  }
+  if (dedup_enabled) {
+    print_dedup_stats();
+  }
+  if (gc_current_heap->pin.max_n_objects > 0) {
+    print_pin_stats();
+  }
+#ifdef STELLA_GC_PERF_COUNTERS
+  print_perf_stats();
+#endif
+#ifdef STELLA_GC_LIFETIME_TRACING
+  print_lifetime_stats();
+#endif
+#ifdef STELLA_GC_PROFILING
+  print_profile_stats();
+#endif
+}
+
+void stats_snapshot(struct gc_stats_snapshot *snapshot) {
+  // A heap has one collector, and epsilon keeps its own allocation counters
+  snapshot->allocated_bytes =
+      total_allocated_bytes + gc_current_heap->epsilon.allocated_bytes;
+  snapshot->allocated_objects =
+      total_allocated_objects + gc_current_heap->epsilon.allocated_objects;
+  snapshot->max_residency_bytes =
+      max_allocated_memory + gc_current_heap->epsilon.allocated_bytes;
+  snapshot->max_gen0_residency_bytes = max_gen0_allocated_memory;
+  snapshot->max_gen1_residency_bytes = max_gen1_allocated_memory;
+  snapshot->gen0_collects = gen0_n_collects;
+  snapshot->gen1_collects = gen1_n_collects;
+  snapshot->nested_collects = nested_n_collects;
+  snapshot->full_collects = full_n_collects;
+  snapshot->copied_bytes = total_copied_bytes;
+  snapshot->idle_collects = gc_current_heap->scheduler.idle_n_collects;
+  snapshot->roots = (uint64_t)var_roots_next_index;
+  snapshot->max_roots = max_n_gc_roots;
+  snapshot->gen0_used_bytes = (uint64_t)(gen0_alloc_ptr - gen0_space);
+  snapshot->gen0_limit_bytes = gen0_gc_initialized ? gen0_limit_size : 0;
+  snapshot->gen0_size_bytes = gen0_gc_initialized ? gen0_space_size : 0;
+  snapshot->gen1_used_bytes = (uint64_t)(gen1_alloc_ptr - gen1_fromspace);
+  snapshot->gen1_size_bytes = gen1_gc_initialized ? GEN1_SPACE_SIZE : 0;
+  snapshot->epsilon_chunks = gc_current_heap->epsilon.n_chunks;
+  snapshot->nursery_max_pause_ns = gc_current_heap->nursery.max_pause_ns;
+  snapshot->nursery_total_pause_ns = gc_current_heap->nursery.total_pause_ns;
+  snapshot->nursery_pauses_over_target =
+      gc_current_heap->nursery.n_pauses_over_target;
+  snapshot->dedup_objects = gc_current_heap->dedup.n_objects;
+  snapshot->dedup_bytes = gc_current_heap->dedup.n_bytes;
+  snapshot->dedup_ns = gc_current_heap->dedup.total_ns;
+  snapshot->pinned_objects = gc_current_heap->pin.n_objects;
+  snapshot->pinned_filled_bytes = gc_current_heap->pin.filled_bytes;
+  snapshot->gen2_collects = gc_current_heap->gen2.n_collects;
+  snapshot->gen2_used_bytes = gc_current_heap->gen2.used_bytes;
+  snapshot->tenured_bytes = gc_current_heap->gen2.tenured_bytes;
 }
@@ -0,0 +1,401 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gc/trace.h"
+
+#include "constants.h"
+#include "gc/debug.h"
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/heap.h"
+#include "gc/parameters.h"
+#include "gc/roots.h"
+#include "runtime.h"
+#include "runtime_extras.h"
+
+#define TRACE_OUTPUT_ENV_VAR "STELLA_GC_TRACE_OUTPUT"
+#define TRACE_BUFFER_SIZE (1 << 20)
+#define TRACE_INITIAL_CAPACITY 1024
+
+#define TRACE_MODE_OFF 0
+#define TRACE_MODE_RECORDING 1
+#define TRACE_MODE_REPLAYING 2
+
+// The tag and the fields count
+#define TRACE_HEADER_MASK 0xff
+
+#define trace_initialized (gc_current_heap->trace.initialized)
+#define trace_mode (gc_current_heap->trace.mode)
+#define next_id (gc_current_heap->trace.next_id)
+#define region_ids (gc_current_heap->trace.region_ids)
+#define trace_output (gc_current_heap->trace.output)
+#define n_events (gc_current_heap->trace.n_events)
+#define root_ids (gc_current_heap->trace.root_ids)
+#define root_ids_capacity (gc_current_heap->trace.root_ids_capacity)
+#define n_recorded_roots (gc_current_heap->trace.n_recorded_roots)
+#define pending_block (gc_current_heap->trace.pending_block)
+#define pending_object_size (gc_current_heap->trace.pending_object_size)
+#define pending_count (gc_current_heap->trace.pending_count)
+#define replay_objects (gc_current_heap->trace.objects)
+#define replay_objects_capacity (gc_current_heap->trace.objects_capacity)
+
+// Only one heap of the process is recorded
+static atomic_flag trace_output_claimed = ATOMIC_FLAG_INIT;
+static gc_heap *recording_heap = NULLPTR;
+
+static void *trace_realloc(void *array, size_t size) {
+  void *result = realloc(array, size);
+  if (result == NULLPTR) {
+    printf("Out of memory: could not allocate trace tables\n");
+    exit(1);
+  }
+  return result;
+}
+
+static uint64_t *id_slot(void *obj) {
+  uintptr_t ptr = (uintptr_t)obj;
+  if (region_ids != NULLPTR && ptr - (uintptr_t)gen1_region < GC_REGION_SIZE) {
+    return &region_ids[(ptr - (uintptr_t)gen1_region) / sizeof(void *)];
+  }
+  return NULLPTR;
+}
+
+static uint64_t object_id(void *obj) {
+  if (obj == NULLPTR) {
+    return TRACE_NULL_ID;
+  }
+  uint64_t *slot = id_slot(obj);
+  return slot != NULLPTR && *slot != 0 ? *slot : TRACE_OUTSIDE_ID;
+}
+
+static void write_u64(uint64_t value) {
+  while (value >= 0x80) {
+    putc((int)(value & 0x7f) | 0x80, trace_output);
+    value >>= 7;
+  }
+  putc((int)value, trace_output);
+}
+
+static void write_event(enum trace_event event) {
+  putc(event, trace_output);
+  n_events++;
+}
+
+static void trace_at_exit(void);
+
+static void open_trace_output(void) {
+  const char *path = getenv(TRACE_OUTPUT_ENV_VAR);
+  if (path == NULLPTR || atomic_flag_test_and_set(&trace_output_claimed)) {
+    return;
+  }
+  trace_output = fopen(path, "wb");
+  if (trace_output == NULLPTR) {
+    fprintf(stderr, "Could not write allocation trace to %s\n", path);
+    return;
+  }
+  setvbuf(trace_output, NULLPTR, _IOFBF, TRACE_BUFFER_SIZE);
+  struct trace_header header = {.magic = TRACE_MAGIC,
+                                .version = TRACE_VERSION,
+                                .ref_size = sizeof(gc_ref),
+                                .reserved = 0};
+  fwrite(&header, sizeof(header), 1, trace_output);
+  recording_heap = gc_current_heap;
+  atexit(trace_at_exit);
+  trace_mode = TRACE_MODE_RECORDING;
+}
+
+static void trace_initialize(void) {
+  trace_initialized = true;
+  next_id = TRACE_FIRST_ID;
+  if (trace_mode != TRACE_MODE_REPLAYING) {
+    open_trace_output();
+  }
+  if (trace_mode == TRACE_MODE_OFF) {
+    return;
+  }
+  if (gen1_gc_initialized) {
+    region_ids = calloc(GC_REGION_SIZE / sizeof(void *), sizeof(uint64_t));
+  }
+  if (gen1_gc_initialized && region_ids == NULLPTR) {
+    printf("Out of memory: could not allocate trace tables\n");
+    exit(1);
+  }
+  GC_DEBUG_PRINTF("trace_initialize(): mode=%d\n", trace_mode);
+}
+
+// Contents of the objects of the last allocation, initialized by now
+static void record_pending_objects(void) {
+  for (size_t i = 0; i < pending_count; i++) {
+    stella_object *obj =
+        (stella_object *)(pending_block + i * pending_object_size);
+    write_event(TRACE_INIT);
+    write_u64(obj->object_header & TRACE_HEADER_MASK);
+    int n_fields = get_fields_count(obj);
+    for (int field = 0; field < n_fields; field++) {
+      write_u64(object_id(get_field(obj, field)));
+    }
+  }
+  pending_count = 0;
+}
+
+static void ensure_root_ids_capacity(size_t n_roots) {
+  if (n_roots <= root_ids_capacity) {
+    return;
+  }
+  size_t capacity =
+      root_ids_capacity == 0 ? TRACE_INITIAL_CAPACITY : root_ids_capacity;
+  while (capacity < n_roots) {
+    capacity *= 2;
+  }
+  root_ids = trace_realloc(root_ids, capacity * sizeof(uint64_t));
+  root_ids_capacity = capacity;
+}
+
+// Local roots are assigned by the program without barriers, so they are
+// compared with their last recorded ids
+static void record_roots(void) {
+  assert(n_recorded_roots == (size_t)var_roots_next_index);
+  size_t index = 0;
+  FOR_EACH_VAR_ROOT(segment, i) {
+    uint64_t id = object_id(*segment->roots[i]);
+    if (root_ids[index] != id) {
+      root_ids[index] = id;
+      write_event(TRACE_SET_ROOT);
+      write_u64(index);
+      write_u64(id);
+    }
+    index++;
+  }
+}
+
+void trace_before_alloc(void) {
+  if (!trace_initialized) {
+    trace_initialize();
+  }
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  record_pending_objects();
+  record_roots();
+}
+
+static void assign_id(stella_object *obj) {
+  uint64_t id = next_id++;
+  uint64_t *slot = id_slot(obj);
+  if (slot != NULLPTR) {
+    *slot = id;
+  }
+  if (trace_mode != TRACE_MODE_REPLAYING) {
+    return;
+  }
+  if (id >= replay_objects_capacity) {
+    size_t capacity = replay_objects_capacity == 0 ? TRACE_INITIAL_CAPACITY
+                                                   : replay_objects_capacity;
+    while (capacity <= id) {
+      capacity *= 2;
+    }
+    replay_objects =
+        trace_realloc(replay_objects, capacity * sizeof(stella_object *));
+    replay_objects_capacity = capacity;
+  }
+  replay_objects[id] = obj;
+}
+
+static void record_new_objects(void *block, size_t object_size,
+                               size_t count) {
+  if (trace_mode == TRACE_MODE_RECORDING) {
+    pending_block = block;
+    pending_object_size = object_size;
+    pending_count = count;
+  }
+  for (size_t i = 0; i < count; i++) {
+    assign_id((stella_object *)((uint8_t *)block + i * object_size));
+  }
+}
+
+void trace_record_alloc(void *obj, size_t size_in_bytes) {
+  if (trace_mode == TRACE_MODE_OFF) {
+    return;
+  }
+  if (trace_mode == TRACE_MODE_RECORDING) {
+    write_event(TRACE_ALLOC);
+    write_u64(size_in_bytes);
+  }
+  record_new_objects(obj, size_in_bytes, 1);
+}
+
+// Blocks of a single object are recorded as such as well, and so is the
+// requested count, because gc_alloc_many decides by both when to collect
+void trace_record_alloc_many(void *block, size_t object_size,
+                             size_t requested_count, size_t count) {
+  if (trace_mode == TRACE_MODE_OFF) {
+    return;
+  }
+  if (trace_mode == TRACE_MODE_RECORDING) {
+    write_event(TRACE_ALLOC_MANY);
+    write_u64(object_size);
+    write_u64(requested_count);
+    write_u64(count);
+  }
+  record_new_objects(block, object_size, count);
+}
+
+void trace_record_write(void *object, int field_index, void *contents) {
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  write_event(TRACE_WRITE);
+  write_u64(object_id(object));
+  write_u64((uint64_t)field_index);
+  write_u64(object_id(contents));
+}
+
+void trace_record_push_root(void **root) {
+  if (!trace_initialized) {
+    trace_initialize();
+  }
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  uint64_t id = object_id(*root);
+  ensure_root_ids_capacity(n_recorded_roots + 1);
+  root_ids[n_recorded_roots++] = id;
+  write_event(TRACE_PUSH_ROOT);
+  write_u64(id);
+}
+
+void trace_record_pop_root(void) {
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  assert(n_recorded_roots > 0);
+  n_recorded_roots--;
+  write_event(TRACE_POP_ROOT);
+}
+
+void trace_record_collect(int generation) {
+  trace_before_alloc();
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  write_event(TRACE_COLLECT);
+  write_u64((uint64_t)generation);
+}
+
+void trace_record_idle_hint(uint64_t budget_us) {
+  trace_before_alloc();
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  write_event(TRACE_IDLE_HINT);
+  write_u64(budget_us);
+}
+
+void trace_record_pin(void *object) {
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  write_event(TRACE_PIN);
+  write_u64(object_id(object));
+}
+
+void trace_record_unpin(void *object) {
+  if (trace_mode != TRACE_MODE_RECORDING) {
+    return;
+  }
+  write_event(TRACE_UNPIN);
+  write_u64(object_id(object));
+}
+
+void trace_record_move(void *obj, void *new_location) {
+  if (trace_mode == TRACE_MODE_OFF) {
+    return;
+  }
+  uint64_t *slot = id_slot(obj);
+  uint64_t *new_slot = id_slot(new_location);
+  if (slot == NULLPTR || new_slot == NULLPTR) {
+    return;
+  }
+  *new_slot = *slot;
+  if (trace_mode == TRACE_MODE_REPLAYING && *slot != 0) {
+    replay_objects[*slot] = new_location;
+  }
+  *slot = 0;
+}
+
+void trace_record_merge(void *obj, void *canonical) {
+  if (trace_mode == TRACE_MODE_OFF) {
+    return;
+  }
+  uint64_t *slot = id_slot(obj);
+  if (slot == NULLPTR) {
+    return;
+  }
+  if (trace_mode == TRACE_MODE_REPLAYING && *slot != 0) {
+    replay_objects[*slot] = canonical;
+  }
+  *slot = 0;
+}
+
+void trace_replay_start(void) {
+  assert(!trace_initialized);
+  trace_mode = TRACE_MODE_REPLAYING;
+}
+
+stella_object *trace_replay_object(uint64_t id) {
+  if (id == TRACE_NULL_ID) {
+    return NULLPTR;
+  }
+  if (id == TRACE_OUTSIDE_ID) {
+    return &the_UNIT;
+  }
+  assert(id < next_id);
+  return replay_objects[id];
+}
+
+void trace_replay_drop_ids(void *block, size_t object_size, size_t count) {
+  assert(trace_mode == TRACE_MODE_REPLAYING && count < next_id);
+  for (size_t i = 0; i < count; i++) {
+    uint64_t *slot = id_slot((uint8_t *)block + i * object_size);
+    if (slot != NULLPTR) {
+      *slot = 0;
+    }
+  }
+  next_id -= count;
+}
+
+void trace_destroy(void) {
+  if (trace_output != NULLPTR) {
+    record_pending_objects();
+    fclose(trace_output);
+    trace_output = NULLPTR;
+    recording_heap = NULLPTR;
+    GC_DEBUG_PRINTF("trace_destroy(): recorded %llu events\n",
+                    (unsigned long long)n_events);
+  }
+  free(region_ids);
+  free(root_ids);
+  free(replay_objects);
+  region_ids = NULLPTR;
+  root_ids = NULLPTR;
+  replay_objects = NULLPTR;
+  root_ids_capacity = 0;
+  replay_objects_capacity = 0;
+  n_recorded_roots = 0;
+  trace_mode = TRACE_MODE_OFF;
+  trace_initialized = false;
+}
+
+// The recorded heap may not be the current one at exit
+static void trace_at_exit(void) {
+  if (recording_heap == NULLPTR) {
+    return;
+  }
+  gc_heap *previous = gc_heap_select(recording_heap);
+  trace_destroy();
+  gc_heap_select(previous);
+}
@@ -9,6 +9,7 @@
 #include "gc/debug.h"
 #include "gc/gen0.h"
 #include "gc/gen1.h"
+#include "gc/kernels.h"
 #include "gc/parameters.h"
 #include "gc/stats.h"
 #include "gc/utils.h"
@@ -17,7 +18,7 @@
 // Size of stella object
 size_t gc_size_of_object(stella_object *obj) {
   int fields_count = STELLA_OBJECT_HEADER_FIELD_COUNT(obj->object_header);
-  return (1 + fields_count) * sizeof(void *);
+  return STELLA_OBJECT_SIZE(fields_count);
 }
 
 // ------------------------------------
@@ -27,24 +28,6 @@ bool points_to_some_space(uint8_t *space, uint8_t *ptr, size_t space_size) {
   return (space <= ptr) && (ptr < (space + space_size));
 }
 
-bool points_to_gen0_space(uint8_t *ptr) {
-  return points_to_some_space(gen0_space, ptr, GEN0_SPACE_SIZE);
-}
-
-bool points_to_fromspace(uint8_t *ptr) {
-  return points_to_some_space(gen1_fromspace, ptr, GEN1_SPACE_SIZE);
-}
-
-bool points_to_tospace(uint8_t *ptr) {
-  return points_to_some_space(gen1_tospace, ptr, GEN1_SPACE_SIZE);
-}
-
-bool is_managed_by_gc(stella_object *obj) {
-  uint8_t *ptr = (uint8_t *)obj;
-  return points_to_gen0_space(ptr) || points_to_tospace(ptr) ||
-         points_to_fromspace(ptr);
-}
-
 bool is_enough_space_left_for_object(uint8_t *space_start, size_t space_size,
                                      uint8_t *dest, size_t object_size) {
   assert(space_start <= dest);
@@ -60,6 +43,9 @@ void *try_alloc(uint8_t *space_start, size_t space_size, uint8_t **alloc_ptr,
     stats_record_allocation(size_in_bytes);
     uint8_t *result = *alloc_ptr;
     *alloc_ptr = (*alloc_ptr) + size_in_bytes;
+    // The runtime only sets the tag and the fields count of new objects, and
+    // the collector keeps marks in the other bits of the header
+    ((stella_object *)result)->object_header = 0;
     GC_DEBUG_PRINTF("try_alloc: allocated object of size %#zx at %p, new "
                     "alloc_ptr=%p\n",
                     size_in_bytes, (void *)result, (void *)*alloc_ptr);
@@ -72,6 +58,35 @@ void *try_alloc(uint8_t *space_start, size_t space_size, uint8_t **alloc_ptr,
   }
 }
 
+size_t try_alloc_many(uint8_t *space_start, size_t space_size,
+                      uint8_t **alloc_ptr, size_t object_size, size_t count,
+                      void **block) {
+  assert(object_size > 0);
+  size_t free_bytes = space_start + space_size > *alloc_ptr
+                          ? (size_t)(space_start + space_size - *alloc_ptr)
+                          : 0;
+  size_t n_objects = free_bytes / object_size;
+  if (n_objects > count) {
+    n_objects = count;
+  }
+  if (n_objects == 0) {
+    GC_DEBUG_PRINTF("try_alloc_many: not enough space for %#zx bytes\n",
+                    object_size);
+    return 0;
+  }
+  stats_record_bulk_allocation(object_size, n_objects);
+  *block = *alloc_ptr;
+  *alloc_ptr = (*alloc_ptr) + n_objects * object_size;
+  for (size_t i = 0; i < n_objects; i++) {
+    ((stella_object *)((uint8_t *)*block + i * object_size))->object_header = 0;
+  }
+  GC_DEBUG_PRINTF("try_alloc_many: allocated %zu objects of size %#zx at %p, "
+                  "new alloc_ptr=%p\n",
+                  n_objects, object_size, *block, (void *)*alloc_ptr);
+  stats_record_max_residency();
+  return n_objects;
+}
+
 // ------------------------------------
 // --- Copy Objects
 
@@ -89,10 +104,22 @@ void assert_objects_equal(stella_object *obj1, stella_object *obj2) {
   }
 }
 
+// Copy routines for each field count, the size of memcpy is a constant so it
+// compiles to a few moves
+#define DEFINE_COPY_KERNEL(n)                                                  \
+  static void copy_object_##n(stella_object *obj, void *dest) {                \
+    memcpy(dest, obj, STELLA_OBJECT_SIZE(n));                                  \
+  }
+GC_FOR_EACH_FIELDS_COUNT(DEFINE_COPY_KERNEL)
+
+#define COPY_KERNEL(n) copy_object_##n,
+static void (*const copy_object_kernels[GC_MAX_FIELDS_COUNT + 1])(
+    stella_object *, void *) = {GC_FOR_EACH_FIELDS_COUNT(COPY_KERNEL)};
+
 size_t copy_object(stella_object *obj, void *dest) {
-  size_t size = gc_size_of_object(obj);
-  memcpy(dest, obj, size);
+  int fields_count = get_fields_count(obj);
+  copy_object_kernels[fields_count](obj, dest);
   // Verify
   assert_objects_equal(obj, (stella_object *)dest);
-  return size;
+  return STELLA_OBJECT_SIZE(fields_count);
 }
@@ -25,56 +25,46 @@ uint8_t get_fields_count(stella_object *obj) {
   return STELLA_OBJECT_HEADER_FIELD_COUNT(obj->object_header);
 }
 
-void print_stella_tag(stella_object *obj) {
-  int tag = STELLA_OBJECT_HEADER_TAG(obj->object_header);
+const char *stella_tag_name(uint8_t tag) {
   switch (tag) {
   case TAG_ZERO:
-    printf("TAG_ZERO");
-    break;
+    return "TAG_ZERO";
   case TAG_SUCC:
-    printf("TAG_SUCC");
-    break;
+    return "TAG_SUCC";
   case TAG_FALSE:
-    printf("TAG_FALSE");
-    break;
+    return "TAG_FALSE";
   case TAG_TRUE:
-    printf("TAG_TRUE");
-    break;
+    return "TAG_TRUE";
   case TAG_FN:
-    printf("TAG_FN");
-    break;
+    return "TAG_FN";
   case TAG_REF:
-    printf("TAG_REF");
-    break;
+    return "TAG_REF";
   case TAG_UNIT:
-    printf("TAG_UNIT");
-    break;
+    return "TAG_UNIT";
   case TAG_TUPLE:
-    printf("TAG_TUPLE");
-    break;
+    return "TAG_TUPLE";
   case TAG_INL:
-    printf("TAG_INL");
-    break;
+    return "TAG_INL";
   case TAG_INR:
-    printf("TAG_INR");
-    break;
+    return "TAG_INR";
   case TAG_EMPTY:
-    printf("TAG_EMPTY");
-    break;
+    return "TAG_EMPTY";
   case TAG_CONS:
-    printf("TAG_CONS");
-    break;
+    return "TAG_CONS";
   default:
-    printf("???");
-    break;
-  };
+    return "???";
+  }
+}
+
+void print_stella_tag(stella_object *obj) {
+  printf("%s", stella_tag_name(get_tag(obj)));
 }
 
 void print_stella_object_fields(stella_object *obj) {
   uint8_t n_fields = get_fields_count(obj);
   printf("[");
   for (int i = 0; i < n_fields; i++) {
-    printf("%p", obj->object_fields[i]);
+    printf("%p", gc_ref_decode(obj->object_fields[i]));
     if (i < n_fields - 1) {
       printf(", ");
     }
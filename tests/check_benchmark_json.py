@@ -0,0 +1,117 @@
+from dataclasses import dataclass
+from pathlib import Path
+import argparse
+import json
+import subprocess
+import sys
+import tempfile
+
+
+class CheckError(Exception):
+    pass
+
+
+@dataclass(frozen=True)
+class Args:
+    benchmark: Path
+    library: str
+    repetitions: int
+
+
+# Benchmarks run by bench_primitives with any heap size, by their parameter
+REQUIRED_BENCHMARKS = [
+    ("alloc", 0),
+    ("alloc", 1),
+    ("alloc", 2),
+    ("alloc", 4),
+    ("alloc", 8),
+    ("push_pop_root", -1),
+    ("minor_gc", 0),
+]
+
+
+def read_args() -> Args:
+    parser = argparse.ArgumentParser("check_benchmark_json")
+    parser.add_argument("--bench", dest="benchmark", type=Path)
+    parser.add_argument("--library", dest="library", type=str)
+    parser.add_argument("--repetitions", dest="repetitions", type=int, default=3)
+    args = parser.parse_args(sys.argv[1:])
+    if not args.benchmark.is_file():
+        exit(f"Error: This is not a regular file: {args.benchmark}")
+    return Args(
+        benchmark=args.benchmark,
+        library=args.library,
+        repetitions=args.repetitions,
+    )
+
+
+def run_benchmark(args: Args, json_path: str) -> str:
+    process = subprocess.run(
+        [args.benchmark, str(args.repetitions), json_path],
+        capture_output=True,
+        text=True,
+    )
+    if process.returncode != 0:
+        raise CheckError(
+            f"Benchmark {args.benchmark.name} exited with error:\n"
+            "---STDOUT---\n"
+            f"{process.stdout}\n"
+            "---STDERR---\n"
+            f"{process.stderr}\n"
+        )
+    return process.stdout
+
+
+def check_summary(summary: dict) -> None:
+    name = f"{summary['name']}({summary['parameter']})"
+    if not summary["unit"].startswith("ns/"):
+        raise CheckError(f"{name}: unexpected unit '{summary['unit']}'")
+    if summary["min"] < 0 or summary["stddev"] < 0:
+        raise CheckError(f"{name}: negative time or deviation")
+    for statistic in ("median", "mean"):
+        if not summary["min"] <= summary[statistic] <= summary["max"]:
+            raise CheckError(f"{name}: {statistic} is not between min and max")
+
+
+def check_results(args: Args, results: dict) -> None:
+    if results["library"] != args.library:
+        raise CheckError(f"Unexpected library '{results['library']}'")
+    if results["repetitions"] != args.repetitions:
+        raise CheckError(f"Unexpected repetitions {results['repetitions']}")
+    if results["warmup_repetitions"] < 1:
+        raise CheckError("No warmup repetitions")
+    keys = [(s["name"], s["parameter"]) for s in results["benchmarks"]]
+    if len(set(keys)) != len(keys):
+        raise CheckError("A benchmark is reported twice")
+    for key in REQUIRED_BENCHMARKS:
+        if key not in keys:
+            raise CheckError(f"Missing benchmark {key[0]}({key[1]})")
+    for summary in results["benchmarks"]:
+        check_summary(summary)
+
+
+def check_benchmark(args: Args) -> None:
+    # With a file the table is printed as well
+    with tempfile.TemporaryDirectory() as directory:
+        json_path = Path(directory) / "results.json"
+        table = run_benchmark(args, str(json_path))
+        if f"Library:  {args.library}\n" not in table:
+            raise CheckError("The table does not name the library")
+        with open(json_path, "r") as file:
+            check_results(args, json.load(file))
+    # JSON on stdout replaces the table
+    check_results(args, json.loads(run_benchmark(args, "-")))
+
+
+def main() -> None:
+    args = read_args()
+    try:
+        check_benchmark(args)
+    except (CheckError, json.JSONDecodeError) as e:
+        exit("Error: " + str(e))
+    except KeyError as e:
+        exit(f"Error: Missing field {e} in the results")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#include "test.h"
+
+// alloc_stella_objects and the root stack: blocks of objects allocated at once
+// survive like any other object, and roots spread over many segments of the
+// root stack are all updated
+
+#define N_ROOTS (3 * VAR_ROOTS_SEGMENT_SIZE + 5)
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// A list of length cells of [0, 0, ...], built from blocks of cons cells
+static stella_object *build_block_list(int length) {
+  stella_object *list = &the_EMPTY;
+  gc_push_root((void **)&list);
+  int n_cells = 0;
+  while (n_cells < length) {
+    stella_object *block;
+    int count = alloc_stella_objects(TAG_CONS, 2, length - n_cells, &block);
+    CHECK(count >= 1 && count <= length - n_cells);
+    for (int i = 0; i < count; i++) {
+      stella_object *cell =
+          (stella_object *)((char *)block + i * STELLA_OBJECT_SIZE(2));
+      CHECK(STELLA_OBJECT_HEADER_TAG(cell->object_header) == TAG_CONS);
+      STELLA_OBJECT_INIT_FIELD(cell, 0, &the_ZERO);
+      STELLA_OBJECT_INIT_FIELD(cell, 1, list);
+      list = cell;
+    }
+    n_cells += count;
+  }
+  gc_pop_root((void **)&list);
+  return list;
+}
+
+static bool block_list_is(stella_object *list, int length) {
+  for (int i = 0; i < length; i++) {
+    if (STELLA_OBJECT_HEADER_TAG(list->object_header) != TAG_CONS ||
+        STELLA_OBJECT_READ_FIELD(list, 0) != &the_ZERO) {
+      return false;
+    }
+    list = STELLA_OBJECT_READ_FIELD(list, 1);
+  }
+  return list == &the_EMPTY;
+}
+
+static void test_blocks(void) {
+  int length = (int)(GEN0_SPACE_SIZE / 4 / STELLA_OBJECT_SIZE(2));
+  stella_object *list = build_block_list(length);
+  gc_push_root((void **)&list);
+  stella_object *number = nat_to_stella_object(length);
+  gc_push_root((void **)&number);
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+    CHECK(block_list_is(list, length));
+    CHECK(stella_object_to_nat(number) == length);
+  }
+  gc_pop_root((void **)&number);
+  gc_pop_root((void **)&list);
+}
+
+static stella_object *roots[N_ROOTS];
+
+// Every stride-th root holds a heap object, the others a static one, so that
+// the objects fit into the smallest heap
+static void check_roots(int n_roots, int stride) {
+  for (int i = 0; i < n_roots; i++) {
+    CHECK(stella_object_to_nat(roots[i]) == (i % stride == 0 ? i % 7 + 1 : 0));
+  }
+}
+
+static void push_roots(int from, int to, int stride) {
+  for (int i = from; i < to; i++) {
+    roots[i] = &the_ZERO;
+    gc_push_root((void **)&roots[i]);
+    if (i % stride == 0) {
+      roots[i] = nat_to_stella_object(i % 7 + 1);
+    }
+  }
+}
+
+static void test_many_roots(void) {
+  int n_heap_objects = (int)(GEN0_SPACE_SIZE / 4 / STELLA_OBJECT_SIZE(1) / 7);
+  int stride = n_heap_objects < 1 ? N_ROOTS : N_ROOTS / n_heap_objects + 1;
+  push_roots(0, N_ROOTS, stride);
+  collect_all();
+  check_roots(N_ROOTS, stride);
+  // Segments emptied by pops are used again by the next pushes
+  for (int i = N_ROOTS - 1; i >= N_ROOTS / 2; i--) {
+    gc_pop_root((void **)&roots[i]);
+  }
+  collect_all();
+  check_roots(N_ROOTS / 2, stride);
+  push_roots(N_ROOTS / 2, N_ROOTS, stride);
+  collect_all();
+  check_roots(N_ROOTS, stride);
+  for (int i = N_ROOTS - 1; i >= 0; i--) {
+    gc_pop_root((void **)&roots[i]);
+  }
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_blocks();
+  test_many_roots();
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include "test.h"
+
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+
+// STELLA_GC_APPEL_NURSERY: the nursery takes the free part of Gen1, in its
+// idle to-space, so it is larger than a fixed Gen0 while Gen1 is empty and
+// shrinks as Gen1 fills, without ever leaving Gen1 too little room for its
+// survivors. A major collection gives the room back.
+
+#define N_LISTS 4
+
+static size_t gen1_free_bytes(void) {
+  return GEN1_SPACE_SIZE - (size_t)(gen1_alloc_ptr - gen1_fromspace);
+}
+
+// The nursery is the free part of from-space, placed in to-space
+static void check_nursery(void) {
+  CHECK(gen0_space == gen1_tospace);
+  CHECK(gen0_space_size <= gen1_free_bytes());
+  CHECK(gen0_space_size + sizeof(void *) > gen1_free_bytes());
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // The first allocation initializes the heap
+  test_churn(STELLA_OBJECT_SIZE(1));
+  CHECK(gen0_in_tospace);
+  check_nursery();
+  CHECK(gen0_space_size > GEN0_SPACE_SIZE);
+
+  // Lists promoted to Gen1 shrink the nursery
+  stella_object *lists[N_LISTS] = {NULL, NULL, NULL, NULL};
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+    lists[k] = test_list(TEST_LIST_LENGTH, k);
+    size_t before = gen0_space_size;
+    gc_collect(0);
+    check_nursery();
+    CHECK(gen0_space_size < before);
+  }
+
+  // Garbage promoted with them is freed by the major collections which keep
+  // the nursery from getting too small
+  for (int round = 0; round < 100; round++) {
+    test_churn(GEN0_SPACE_SIZE / 2);
+    check_nursery();
+    for (int k = 0; k < N_LISTS; k++) {
+      CHECK(test_list_is(lists[k], TEST_LIST_LENGTH, k));
+    }
+  }
+
+  // Once the lists die, a major collection gives the whole space back
+  for (int k = 0; k < N_LISTS; k++) {
+    lists[k] = NULL;
+  }
+  gc_collect(1);
+  check_nursery();
+  CHECK(gen0_space_size + sizeof(void *) > GEN1_SPACE_SIZE);
+  for (int k = N_LISTS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <stdint.h>
+
+#include "test.h"
+
+#include "gc/gen2.h"
+
+// STELLA_GC_BARRIERS: with range and call barriers, writes into Gen2 objects
+// reach the write barrier, which remembers them, while writes into younger
+// objects do not need it. Without barriers nothing is remembered and Gen2 is
+// scanned instead. Reads return the field in every mode.
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+static size_t n_remembered(void) {
+  return gc_current_heap->gen2.n_remembered;
+}
+
+// The range only covers Gen2, and is empty without it
+static void test_range(void) {
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+  if (gen2_enabled) {
+    uintptr_t start = (uintptr_t)gen2_space - gc_barrier_range_start;
+    CHECK(start < gc_barrier_range_size &&
+          start + GEN2_SPACE_SIZE <= gc_barrier_range_size);
+  } else {
+    CHECK(gc_barrier_range_size == 0);
+  }
+#endif
+}
+
+static void test_writes(void) {
+  stella_object *old = alloc_stella_object(TAG_REF, 1);
+  STELLA_OBJECT_INIT_FIELD(old, 0, &the_EMPTY);
+  gc_push_root((void **)&old);
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+  }
+  CHECK(gen2_enabled == points_to_gen2(old));
+  stella_object *young = alloc_stella_object(TAG_REF, 1);
+  STELLA_OBJECT_INIT_FIELD(young, 0, &the_EMPTY);
+  gc_push_root((void **)&young);
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  size_t before = n_remembered();
+  STELLA_OBJECT_WRITE_FIELD(young, 0, list);
+  CHECK(n_remembered() == before);
+  STELLA_OBJECT_WRITE_FIELD(old, 0, list);
+  bool remembers = gen2_enabled && STELLA_GC_BARRIERS != GC_BARRIERS_NONE;
+  CHECK(n_remembered() == before + (remembers ? 1 : 0));
+  // A second write into the same object is remembered once
+  STELLA_OBJECT_WRITE_FIELD(old, 0, list);
+  CHECK(n_remembered() == before + (remembers ? 1 : 0));
+  CHECK(STELLA_OBJECT_READ_FIELD(old, 0) == list);
+  CHECK(STELLA_OBJECT_READ_FIELD(young, 0) == list);
+  // The list survives minor collections through the old cell alone
+  young = NULL;
+  for (int i = 0; i < 3; i++) {
+    test_churn(GEN0_SPACE_SIZE);
+    gc_collect(0);
+    CHECK(test_list_is(STELLA_OBJECT_READ_FIELD(old, 0), TEST_LIST_LENGTH, 0));
+  }
+  gc_pop_root((void **)&young);
+  gc_pop_root((void **)&old);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // The first allocation initializes the heap
+  test_churn(STELLA_OBJECT_SIZE(1));
+  test_range();
+  test_writes();
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include "test.h"
+
+// gc_collect and gc_idle_hint: explicit collections of every generation keep
+// the live objects intact, and idle hints collect once the heap is used
+// enough
+
+// Long enough for any collection of the tests
+#define IDLE_BUDGET_US 1000000
+
+#define N_LISTS 3
+
+static stella_object *lists[N_LISTS];
+static int seeds[N_LISTS];
+
+static void check_lists(void) {
+  for (int k = 0; k < N_LISTS; k++) {
+    CHECK(test_list_is(lists[k], TEST_LIST_LENGTH, seeds[k]));
+  }
+}
+
+static void test_collect(void) {
+  for (int k = 0; k < N_LISTS; k++) {
+    lists[k] = test_list(TEST_LIST_LENGTH, k);
+    seeds[k] = k;
+  }
+  for (int generation = 0; generation <= 2; generation++) {
+    test_churn(GEN0_SPACE_SIZE / 2);
+    gc_collect(generation);
+    check_lists();
+  }
+  // A list dropped before a collection is replaced after it
+  for (int round = N_LISTS; round < 30; round++) {
+    int k = round % N_LISTS;
+    lists[k] = NULL;
+    gc_collect(round % 3);
+    lists[k] = test_list(TEST_LIST_LENGTH, round);
+    seeds[k] = round;
+    check_lists();
+  }
+}
+
+// Nothing is worth collecting right after a major collection, then the heap
+// fills up until an idle hint collects
+static void test_idle_hint(void) {
+  gc_collect(1);
+  CHECK(gc_idle_hint(IDLE_BUDGET_US) == -1);
+  int generation = -1;
+  size_t allocated = 0;
+  while (generation == -1 && allocated < 4 * GEN1_SPACE_SIZE) {
+    test_churn(STELLA_OBJECT_SIZE(1));
+    allocated += STELLA_OBJECT_SIZE(1);
+    generation = gc_idle_hint(IDLE_BUDGET_US);
+  }
+  CHECK(generation == 0 || generation == 1);
+  check_lists();
+}
+
+// Live data filling most of Gen1 is no reason for an idle collection. Half of
+// the elements of a list are static, so it takes 65% to 80% of Gen1.
+static void test_idle_hint_live_data(void) {
+  int length = (int)(GEN1_SPACE_SIZE * 8 / 10 / TEST_CELL_SIZE);
+  stella_object *list = test_list(length, 0);
+  gc_push_root((void **)&list);
+  gc_collect(1);
+  for (int i = 0; i < 10; i++) {
+    CHECK(gc_idle_hint(IDLE_BUDGET_US) == -1);
+  }
+  CHECK(test_list_is(list, length, 0));
+  gc_pop_root((void **)&list);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+  }
+  test_collect();
+  test_idle_hint();
+  for (int k = N_LISTS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+  test_idle_hint_live_data();
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include "test.h"
+
+// STELLA_GC_DEDUP: Gen1 collections merge equal immutable objects, and leave
+// reference cells, objects on cycles and pinned objects apart
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+static stella_object *test_pair(stella_object *first, stella_object *second) {
+  gc_push_root((void **)&first);
+  gc_push_root((void **)&second);
+  stella_object *pair = alloc_stella_object(TAG_TUPLE, 2);
+  STELLA_OBJECT_INIT_FIELD(pair, 0, first);
+  STELLA_OBJECT_INIT_FIELD(pair, 1, second);
+  gc_pop_root((void **)&second);
+  gc_pop_root((void **)&first);
+  return pair;
+}
+
+// Two pairs pointing to each other
+static stella_object *test_cycle(void) {
+  stella_object *pair = test_pair(&the_ZERO, &the_ZERO);
+  gc_push_root((void **)&pair);
+  stella_object *other = test_pair(&the_ZERO, pair);
+  STELLA_OBJECT_WRITE_FIELD(pair, 1, other);
+  gc_pop_root((void **)&pair);
+  return pair;
+}
+
+static bool test_cycle_is_intact(stella_object *pair) {
+  stella_object *other = STELLA_OBJECT_READ_FIELD(pair, 1);
+  return other != pair && STELLA_OBJECT_READ_FIELD(other, 1) == pair &&
+         STELLA_OBJECT_READ_FIELD(pair, 0) == &the_ZERO &&
+         STELLA_OBJECT_READ_FIELD(other, 0) == &the_ZERO;
+}
+
+// Equal lists become one, and lists which differ do not
+static void test_equal_lists(void) {
+  stella_object *lists[3] = {NULL, NULL, NULL};
+  for (int k = 0; k < 3; k++) {
+    gc_push_root((void **)&lists[k]);
+  }
+  lists[0] = test_list(TEST_LIST_LENGTH, 0);
+  lists[1] = test_list(TEST_LIST_LENGTH, 0);
+  lists[2] = test_list(TEST_LIST_LENGTH, 1);
+  CHECK(lists[0] != lists[1]);
+  collect_all();
+  CHECK(lists[0] == lists[1]);
+  CHECK(lists[0] != lists[2]);
+  CHECK(test_list_is(lists[0], TEST_LIST_LENGTH, 0));
+  CHECK(test_list_is(lists[2], TEST_LIST_LENGTH, 1));
+  // The merged list keeps serving both roots
+  lists[1] = NULL;
+  collect_all();
+  CHECK(test_list_is(lists[0], TEST_LIST_LENGTH, 0));
+  for (int k = 2; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+}
+
+// Reference cells with equal contents may be written apart afterwards
+static void test_reference_cells(void) {
+  stella_object *cells[2] = {NULL, NULL};
+  for (int k = 0; k < 2; k++) {
+    gc_push_root((void **)&cells[k]);
+    cells[k] = alloc_stella_object(TAG_REF, 1);
+    STELLA_OBJECT_INIT_FIELD(cells[k], 0, &the_ZERO);
+  }
+  collect_all();
+  CHECK(cells[0] != cells[1]);
+  stella_object *one = nat_to_stella_object(1);
+  STELLA_OBJECT_WRITE_FIELD(cells[0], 0, one);
+  collect_all();
+  CHECK(stella_object_to_nat(STELLA_OBJECT_READ_FIELD(cells[0], 0)) == 1);
+  CHECK(STELLA_OBJECT_READ_FIELD(cells[1], 0) == &the_ZERO);
+  for (int k = 1; k >= 0; k--) {
+    gc_pop_root((void **)&cells[k]);
+  }
+}
+
+// Equal cycles are not merged
+static void test_cycles(void) {
+  stella_object *cycles[2] = {NULL, NULL};
+  for (int k = 0; k < 2; k++) {
+    gc_push_root((void **)&cycles[k]);
+    cycles[k] = test_cycle();
+  }
+  collect_all();
+  CHECK(cycles[0] != cycles[1]);
+  CHECK(test_cycle_is_intact(cycles[0]));
+  CHECK(test_cycle_is_intact(cycles[1]));
+  for (int k = 1; k >= 0; k--) {
+    gc_pop_root((void **)&cycles[k]);
+  }
+}
+
+// A pinned list stays where it is, even when it equals another one
+static void test_pinned(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  stella_object *pinned = test_list(TEST_LIST_LENGTH, 0);
+  gc_pin(pinned);
+  collect_all();
+  CHECK(list != pinned);
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  CHECK(test_list_is(pinned, TEST_LIST_LENGTH, 0));
+  gc_unpin(pinned);
+  gc_pop_root((void **)&list);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_equal_lists();
+  test_reference_cells();
+  test_cycles();
+  test_pinned();
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#include "gc/export.h"
+
+// STELLA_GC_EXPORT and STELLA_GC_EXPORT_PAGE: the page follows the counters
+// of the heap after every collection, and SIGUSR1 writes a line to the export
+
+#define N_COLLECTIONS 10
+
+static char export_path[64];
+static char page_path[64];
+static const struct gc_export_page *page;
+
+// Reads the page as an external agent would
+static void read_page(struct gc_export_page *copy) {
+  uint64_t sequence;
+  do {
+    sequence = atomic_load(&page->sequence);
+    copy->magic = page->magic;
+    copy->version = page->version;
+    copy->n_updates = page->n_updates;
+    copy->stats = page->stats;
+  } while (sequence % 2 != 0 || atomic_load(&page->sequence) != sequence);
+}
+
+static void map_page(void) {
+  int fd = open(page_path, O_RDONLY);
+  CHECK(fd >= 0);
+  void *mapping =
+      mmap(NULL, sizeof(struct gc_export_page), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(mapping != MAP_FAILED);
+  page = mapping;
+}
+
+// Every collection updates the page with the counters of the heap
+static void test_page(void) {
+  struct gc_export_page before;
+  read_page(&before);
+  CHECK(before.magic == GC_EXPORT_PAGE_MAGIC);
+  CHECK(before.version == GC_EXPORT_PAGE_VERSION);
+  size_t n_objects = GEN0_SPACE_SIZE / 2 / STELLA_OBJECT_SIZE(1);
+  for (int i = 0; i < N_COLLECTIONS; i++) {
+    test_churn(GEN0_SPACE_SIZE / 2);
+    gc_collect(i % 2);
+  }
+  struct gc_export_page after;
+  read_page(&after);
+  CHECK(after.n_updates >= before.n_updates + N_COLLECTIONS);
+  CHECK(after.stats.allocated_objects >=
+        before.stats.allocated_objects + N_COLLECTIONS * n_objects);
+  CHECK(after.stats.gen0_collects + after.stats.gen1_collects +
+            after.stats.full_collects >=
+        before.stats.gen0_collects + before.stats.gen1_collects +
+            before.stats.full_collects + N_COLLECTIONS);
+}
+
+// SIGUSR1 writes a line and updates the page
+static void test_signal(void) {
+  struct gc_export_page before;
+  read_page(&before);
+  CHECK(raise(SIGUSR1) == 0);
+  struct gc_export_page after;
+  read_page(&after);
+  CHECK(after.n_updates == before.n_updates + 1);
+
+  FILE *export = fopen(export_path, "r");
+  CHECK(export != NULL);
+  char line[4096];
+  CHECK(fgets(line, sizeof(line), export) != NULL);
+  fclose(export);
+  CHECK(strncmp(line, "{\"event\":\"signal\",", 18) == 0);
+  CHECK(strstr(line, "\"allocated_objects\":") != NULL);
+  CHECK(line[strlen(line) - 1] == '\n');
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // Configurations of the test run side by side in the same directory
+  snprintf(export_path, sizeof(export_path), "export-%ld.jsonl",
+           (long)getpid());
+  snprintf(page_path, sizeof(page_path), "export-%ld.page", (long)getpid());
+  setenv("STELLA_GC_EXPORT", export_path, 1);
+  setenv("STELLA_GC_EXPORT_PAGE", page_path, 1);
+  // The first allocation initializes the heap, and the export with it
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  map_page();
+  test_page();
+  test_signal();
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  gc_pop_root((void **)&list);
+  unlink(export_path);
+  unlink(page_path);
+  return 0;
+}
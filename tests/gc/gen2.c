@@ -0,0 +1,90 @@
+#include "test.h"
+
+// STELLA_GC_TENURE_AGE (and STELLA_GC_CONCURRENT_MARK): tenured objects stay
+// where they are, Gen2 objects keep the younger objects written into them
+// alive, and Gen2 collections free the rest for later tenured objects
+
+#define N_CELLS 4
+#define N_ROUNDS 1000
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// Survivors of a few Gen1 collections are tenured and never move again
+static void test_tenured_objects_stay(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+  }
+  stella_object *tenured = list;
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+    gc_collect(2);
+    CHECK(list == tenured);
+    CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  }
+  gc_pop_root((void **)&list);
+}
+
+static stella_object *cells[N_CELLS];
+static int seeds[N_CELLS];
+
+static void check_cells(void) {
+  for (int k = 0; k < N_CELLS; k++) {
+    CHECK(test_list_is(STELLA_OBJECT_READ_FIELD(cells[k], 0),
+                       TEST_LIST_LENGTH, seeds[k]));
+  }
+}
+
+// Tenured reference cells get young lists and swap them, while the lists
+// they drop fill Gen2 many times over
+static void test_tenured_cells(void) {
+  for (int k = 0; k < N_CELLS; k++) {
+    gc_push_root((void **)&cells[k]);
+    cells[k] = alloc_stella_object(TAG_REF, 1);
+    STELLA_OBJECT_INIT_FIELD(cells[k], 0, &the_EMPTY);
+    stella_object *list = test_list(TEST_LIST_LENGTH, k);
+    STELLA_OBJECT_WRITE_FIELD(cells[k], 0, list);
+    seeds[k] = k;
+  }
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+  }
+  check_cells();
+  for (int round = N_CELLS; round < N_ROUNDS; round++) {
+    int k = round % N_CELLS;
+    stella_object *list = test_list(TEST_LIST_LENGTH, round);
+    STELLA_OBJECT_WRITE_FIELD(cells[k], 0, list);
+    seeds[k] = round;
+    // Swapping two fields hides a list from a concurrent marker which has not
+    // seen it yet, unless the write barrier logs it
+    int j = (k + 1) % N_CELLS;
+    stella_object *first = STELLA_OBJECT_READ_FIELD(cells[k], 0);
+    stella_object *second = STELLA_OBJECT_READ_FIELD(cells[j], 0);
+    STELLA_OBJECT_WRITE_FIELD(cells[k], 0, second);
+    STELLA_OBJECT_WRITE_FIELD(cells[j], 0, first);
+    int seed = seeds[k];
+    seeds[k] = seeds[j];
+    seeds[j] = seed;
+    test_churn(GEN0_SPACE_SIZE);
+    check_cells();
+  }
+  gc_collect(2);
+  check_cells();
+  for (int k = N_CELLS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&cells[k]);
+  }
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_tenured_objects_stay();
+  test_tenured_cells();
+  return 0;
+}
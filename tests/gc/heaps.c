@@ -0,0 +1,130 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include "test.h"
+
+#include "gc/gen2.h"
+
+// gc_heap_create, gc_heap_select and gc_heap_destroy: heaps collect
+// independently, on one thread or on threads of their own
+
+#define N_THREADS 4
+#define N_ROUNDS 3
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// Collections of one heap leave the objects of another where they are
+static void test_switching_heaps(void) {
+  gc_heap *first = gc_heap_create();
+  gc_heap *second = gc_heap_create();
+  CHECK(first != NULL && second != NULL);
+
+  gc_heap *previous = gc_heap_select(first);
+  stella_object *first_list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&first_list);
+  stella_object *first_address = first_list;
+
+  gc_heap_select(second);
+  CHECK(gc_heap_current() == second);
+  stella_object *second_list = test_list(TEST_LIST_LENGTH, 1);
+  gc_push_root((void **)&second_list);
+  collect_all();
+  CHECK(test_list_is(second_list, TEST_LIST_LENGTH, 1));
+  CHECK(first_list == first_address);
+
+  gc_heap_select(first);
+  collect_all();
+  CHECK(test_list_is(first_list, TEST_LIST_LENGTH, 0));
+
+  // Destroying the current heap selects the default one
+  gc_heap_select(second);
+  gc_heap_destroy(second);
+  CHECK(gc_heap_current() != second);
+  gc_heap_select(first);
+  collect_all();
+  CHECK(test_list_is(first_list, TEST_LIST_LENGTH, 0));
+  gc_pop_root((void **)&first_list);
+  gc_heap_destroy(first);
+  gc_heap_select(previous);
+}
+
+static void *thread_main(void *arg) {
+  int seed = (int)(intptr_t)arg;
+  for (int round = 0; round < N_ROUNDS; round++) {
+    gc_heap *heap = gc_heap_create();
+    gc_heap_select(heap);
+    stella_object *list = test_list(TEST_LIST_LENGTH, seed + round);
+    gc_push_root((void **)&list);
+    for (int i = 0; i < 10; i++) {
+      collect_all();
+      CHECK(test_list_is(list, TEST_LIST_LENGTH, seed + round));
+    }
+    gc_pop_root((void **)&list);
+    gc_heap_destroy(heap);
+  }
+  return NULL;
+}
+
+// Threads collect their heaps while the default heap is collected as well
+static void test_threads(void) {
+  pthread_t threads[N_THREADS];
+  for (int i = 0; i < N_THREADS; i++) {
+    CHECK(pthread_create(&threads[i], NULL, thread_main,
+                         (void *)(intptr_t)(i * N_ROUNDS)) == 0);
+  }
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  for (int i = 0; i < 10; i++) {
+    collect_all();
+    CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  }
+  gc_pop_root((void **)&list);
+  for (int i = 0; i < N_THREADS; i++) {
+    CHECK(pthread_join(threads[i], NULL) == 0);
+  }
+}
+
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+// Whether the range of the write barrier covers Gen2 of the current heap
+static bool barrier_range_covers_gen2(void) {
+  uintptr_t start = (uintptr_t)gen2_space - gc_barrier_range_start;
+  return start < gc_barrier_range_size &&
+         start + GEN2_SPACE_SIZE <= gc_barrier_range_size;
+}
+
+// The range covers Gen2 of every heap, and shrinks back once a heap is
+// destroyed
+static void test_barrier_range(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  uintptr_t start = gc_barrier_range_start;
+  size_t size = gc_barrier_range_size;
+  CHECK(start == (uintptr_t)gen2_space && size == GEN2_SPACE_SIZE);
+  gc_heap *heap = gc_heap_create();
+  CHECK(heap != NULL);
+  gc_heap *previous = gc_heap_select(heap);
+  test_churn(GEN0_SPACE_SIZE);
+  CHECK(barrier_range_covers_gen2());
+  gc_heap_select(previous);
+  CHECK(barrier_range_covers_gen2());
+  gc_heap_destroy(heap);
+  CHECK(gc_barrier_range_start == start && gc_barrier_range_size == size);
+}
+#endif
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_switching_heaps();
+  test_threads();
+#if STELLA_GC_BARRIERS == GC_BARRIERS_RANGE
+  if (gen2_enabled) {
+    test_barrier_range();
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// gc_save_image and gc_load_image: a loaded image holds the saved graph with
+// its sharing, NULL fields, static objects and closures, wherever it is mapped
+
+#define N_FIELDS 5
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+static stella_object *test_closure_body(stella_object *closure,
+                                        stella_object *argument) {
+  (void)closure;
+  return argument;
+}
+
+typedef stella_object *(*test_closure_code)(stella_object *, stella_object *);
+
+// {list, list, NULL, closure, 0}
+static stella_object *build_graph(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  stella_object *closure = alloc_stella_object(TAG_FN, 1);
+  STELLA_OBJECT_INIT_FIELD(closure, 0, (stella_object *)test_closure_body);
+  gc_push_root((void **)&closure);
+  stella_object *tuple = alloc_stella_object(TAG_TUPLE, N_FIELDS);
+  STELLA_OBJECT_INIT_FIELD(tuple, 0, list);
+  STELLA_OBJECT_INIT_FIELD(tuple, 1, list);
+  STELLA_OBJECT_INIT_FIELD(tuple, 2, NULL);
+  STELLA_OBJECT_INIT_FIELD(tuple, 3, closure);
+  STELLA_OBJECT_INIT_FIELD(tuple, 4, &the_ZERO);
+  gc_pop_root((void **)&closure);
+  gc_pop_root((void **)&list);
+  return tuple;
+}
+
+static bool graph_is_intact(stella_object *tuple) {
+  stella_object *closure = STELLA_OBJECT_READ_FIELD(tuple, 3);
+  test_closure_code code =
+      (test_closure_code)STELLA_OBJECT_READ_FIELD(closure, 0);
+  return STELLA_OBJECT_HEADER_TAG(tuple->object_header) == TAG_TUPLE &&
+         test_list_is(STELLA_OBJECT_READ_FIELD(tuple, 0), TEST_LIST_LENGTH,
+                      0) &&
+         STELLA_OBJECT_READ_FIELD(tuple, 1) ==
+             STELLA_OBJECT_READ_FIELD(tuple, 0) &&
+         STELLA_OBJECT_READ_FIELD(tuple, 2) == NULL &&
+         STELLA_OBJECT_HEADER_TAG(closure->object_header) == TAG_FN &&
+         code(closure, &the_UNIT) == &the_UNIT &&
+         STELLA_OBJECT_READ_FIELD(tuple, 4) == &the_ZERO;
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  const char *collector = getenv("STELLA_GC");
+  if (collector != NULL && strcmp(collector, "epsilon") == 0) {
+    return TEST_SKIPPED;
+  }
+#ifdef STELLA_GC_COMPRESSED_REFS
+  return TEST_SKIPPED;
+#endif
+  // Configurations of the test run side by side in the same directory
+  char path[64];
+  snprintf(path, sizeof(path), "image-%ld.img", (long)getpid());
+
+  stella_object *graph = build_graph();
+  gc_push_root((void **)&graph);
+  collect_all();
+  CHECK(graph_is_intact(graph));
+  CHECK(gc_save_image(path, graph) == 0);
+  gc_pop_root((void **)&graph);
+
+  // The second image can not be mapped where the first one is, so it is
+  // relocated
+  stella_object *first = gc_load_image(path);
+  stella_object *second = gc_load_image(path);
+  unlink(path);
+  CHECK(first != NULL && second != NULL);
+  CHECK(first != second);
+  CHECK(graph_is_intact(first));
+  CHECK(graph_is_intact(second));
+
+  // Heap objects may point into images, which collections leave alone
+  stella_object *list = test_cons(first, &the_EMPTY);
+  gc_push_root((void **)&list);
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+    CHECK(STELLA_OBJECT_READ_FIELD(list, 0) == first);
+    CHECK(graph_is_intact(first));
+    CHECK(graph_is_intact(second));
+  }
+  gc_pop_root((void **)&list);
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "test.h"
+
+#include "gc/kernels.h"
+
+// Copy and scan routines per field count: tuples of every field count keep
+// their header and every field through collections, whether a field points
+// to a young object, a static one or back to the tuple
+
+#define N_COLLECTIONS 3
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// Field i is a fresh succ(0) if i % 3 == 0, zero if i % 3 == 1 and the tuple
+// itself otherwise
+static stella_object *build_tuple(int n_fields) {
+  stella_object *cells[GC_MAX_FIELDS_COUNT];
+  for (int i = 0; i < n_fields; i++) {
+    cells[i] = NULL;
+    gc_push_root((void **)&cells[i]);
+    if (i % 3 == 0) {
+      cells[i] = alloc_stella_object(TAG_SUCC, 1);
+      STELLA_OBJECT_INIT_FIELD(cells[i], 0, &the_ZERO);
+    }
+  }
+  stella_object *tuple = alloc_stella_object(TAG_TUPLE, n_fields);
+  for (int i = 0; i < n_fields; i++) {
+    stella_object *field =
+        i % 3 == 0 ? cells[i] : i % 3 == 1 ? &the_ZERO : tuple;
+    STELLA_OBJECT_INIT_FIELD(tuple, i, field);
+  }
+  for (int i = n_fields - 1; i >= 0; i--) {
+    gc_pop_root((void **)&cells[i]);
+  }
+  return tuple;
+}
+
+static bool tuple_is_intact(stella_object *tuple, int n_fields) {
+  if (STELLA_OBJECT_HEADER_TAG(tuple->object_header) != TAG_TUPLE ||
+      STELLA_OBJECT_HEADER_FIELD_COUNT(tuple->object_header) != n_fields) {
+    return false;
+  }
+  for (int i = 0; i < n_fields; i++) {
+    stella_object *field = STELLA_OBJECT_READ_FIELD(tuple, i);
+    if (i % 3 == 0) {
+      if (STELLA_OBJECT_HEADER_TAG(field->object_header) != TAG_SUCC ||
+          STELLA_OBJECT_READ_FIELD(field, 0) != &the_ZERO) {
+        return false;
+      }
+      // Every cell is copied once
+      for (int j = 0; j < i; j += 3) {
+        if (STELLA_OBJECT_READ_FIELD(tuple, j) == field) {
+          return false;
+        }
+      }
+    } else if (field != (i % 3 == 1 ? &the_ZERO : tuple)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  for (int n_fields = 1; n_fields <= GC_MAX_FIELDS_COUNT; n_fields++) {
+    stella_object *tuple = build_tuple(n_fields);
+    gc_push_root((void **)&tuple);
+    CHECK(tuple_is_intact(tuple, n_fields));
+    for (int i = 0; i < N_COLLECTIONS; i++) {
+      collect_all();
+      CHECK(tuple_is_intact(tuple, n_fields));
+    }
+    gc_pop_root((void **)&tuple);
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// STELLA_GC_LIFETIME_TRACING: the report written when a heap is destroyed
+// accounts for every object born in it, and finds garbage dead young and a
+// list which lived through a lot of allocation dead old
+
+// Bytes allocated while the list is alive
+#define LONG_LIFE_BYTES (8 * GEN0_SPACE_SIZE)
+
+static char output_path[64];
+
+struct lifetime_report {
+  unsigned long long n_born;
+  unsigned long long n_dead;
+  unsigned long long n_alive;
+  // Dead cons cells, and how many of them died younger than LONG_LIFE_BYTES
+  unsigned long long n_dead_cons;
+  unsigned long long n_young_dead_cons;
+  // Dead succ cells younger than twice Gen0
+  unsigned long long n_young_dead_succ;
+};
+
+static void read_report(const char *path, struct lifetime_report *report) {
+  memset(report, 0, sizeof(*report));
+  FILE *file = fopen(path, "r");
+  CHECK(file != NULL);
+  char line[256];
+  bool has_objects = false;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (sscanf(line, "# Objects: %llu born, %llu dead, %llu still alive",
+               &report->n_born, &report->n_dead, &report->n_alive) == 3) {
+      has_objects = true;
+      continue;
+    }
+    char tag[32];
+    unsigned long long age_from, age_to, objects, bytes;
+    if (sscanf(line, "%31[^,],%llu,%llu,%llu,%llu", tag, &age_from, &age_to,
+               &objects, &bytes) != 5) {
+      continue;
+    }
+    if (strcmp(tag, "TAG_CONS") == 0) {
+      report->n_dead_cons += objects;
+      if (age_from < LONG_LIFE_BYTES / 2) {
+        report->n_young_dead_cons += objects;
+      }
+    } else if (strcmp(tag, "TAG_SUCC") == 0 &&
+               age_to <= 2 * GEN0_SPACE_SIZE) {
+      report->n_young_dead_succ += objects;
+    }
+  }
+  fclose(file);
+  CHECK(has_objects);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // Configurations of the test run side by side in the same directory
+  snprintf(output_path, sizeof(output_path), "lifetime-%ld.csv",
+           (long)getpid());
+  setenv("STELLA_GC_LIFETIME_OUTPUT", output_path, 1);
+  gc_heap *heap = gc_heap_create();
+  CHECK(heap != NULL);
+  gc_heap *previous = gc_heap_select(heap);
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  test_churn(LONG_LIFE_BYTES);
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  list = NULL;
+  gc_collect(0);
+  gc_collect(1);
+  gc_pop_root((void **)&list);
+  gc_heap_destroy(heap);
+  gc_heap_select(previous);
+
+  // The first heap created writes its report to the path with .1 appended
+  char report_path[80];
+  snprintf(report_path, sizeof(report_path), "%s.1", output_path);
+  struct lifetime_report report;
+  read_report(report_path, &report);
+  unlink(report_path);
+  CHECK(report.n_born == report.n_dead + report.n_alive);
+  CHECK(report.n_born >= (unsigned long long)TEST_LIST_LENGTH +
+                             LONG_LIFE_BYTES / STELLA_OBJECT_SIZE(1));
+  CHECK(report.n_dead_cons == (unsigned long long)TEST_LIST_LENGTH);
+  CHECK(report.n_young_dead_cons == 0);
+  CHECK(report.n_young_dead_succ >=
+        LONG_LIFE_BYTES / STELLA_OBJECT_SIZE(1) / 2);
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "test.h"
+
+#include "gc/gen0.h"
+#include "gc/nursery.h"
+
+// STELLA_GC_PAUSE_TARGET_US: the nursery shrinks while Gen0 pauses exceed the
+// target and grows back once they meet it, by at most a factor of two per
+// collection, and allocation stops at its limit. The pauses are fed to the
+// model directly, so that the test does not depend on the speed of the host.
+
+#define N_PAUSES 20
+
+static uint64_t pause_target_ns(void) {
+  return gc_current_heap->nursery.pause_target_ns;
+}
+
+// Records pauses of the given length for a full nursery of which everything
+// survives
+static void record_pauses(uint64_t pause_ns, uint64_t fixed_ns) {
+  for (int i = 0; i < N_PAUSES; i++) {
+    size_t previous = gen0_limit_size;
+    nursery_record_collect(pause_ns, fixed_ns, gen0_limit_size,
+                           gen0_limit_size);
+    CHECK(gen0_limit_size > 0 && gen0_limit_size <= gen0_space_size);
+    CHECK(gen0_limit_size % sizeof(void *) == 0);
+    CHECK(2 * (gen0_limit_size + sizeof(void *)) >= previous);
+    CHECK(gen0_limit_size <= previous * 2);
+  }
+}
+
+// Long pauses shrink the nursery down to its minimum, but not to nothing
+static void test_shrink(void) {
+  record_pauses(10 * pause_target_ns(), 0);
+  CHECK(gen0_limit_size <= gen0_space_size / 8);
+  CHECK(gen0_limit_size + sizeof(void *) >= GEN0_SPACE_SIZE / 16);
+}
+
+// Allocation collects at the limit of the nursery rather than at the end of
+// its space
+static void test_limit(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  size_t n_objects = gen0_space_size / STELLA_OBJECT_SIZE(1);
+  for (size_t i = 0; i < n_objects; i++) {
+    test_churn(STELLA_OBJECT_SIZE(1));
+    // An object larger than the limit still fits into the space
+    size_t limit = gen0_limit_size > STELLA_OBJECT_SIZE(1)
+                       ? gen0_limit_size
+                       : STELLA_OBJECT_SIZE(1);
+    CHECK((size_t)(gen0_alloc_ptr - gen0_space) <= limit);
+  }
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  gc_pop_root((void **)&list);
+}
+
+// Short pauses grow it back to the whole space
+static void test_grow(void) {
+  record_pauses(pause_target_ns() / 10, 0);
+  CHECK(gen0_limit_size == gen0_space_size / sizeof(void *) * sizeof(void *));
+}
+
+// A target which the fixed part of the pause exceeds can not be met by
+// shrinking, so the whole space is used to collect less often
+static void test_unreachable_target(void) {
+  record_pauses(10 * pause_target_ns(), 0);
+  record_pauses(2 * pause_target_ns(), 2 * pause_target_ns());
+  CHECK(gen0_limit_size == gen0_space_size / sizeof(void *) * sizeof(void *));
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // The first allocation initializes the heap
+  test_churn(STELLA_OBJECT_SIZE(1));
+  CHECK(nursery_is_adaptive);
+  test_shrink();
+  test_limit();
+  test_shrink();
+  test_grow();
+  test_unreachable_target();
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// STELLA_GC_PERF_COUNTERS: every phase of a collection is timed, with hardware
+// counters where the kernel allows them, and print_gc_alloc_stats reports how
+// many times each phase ran
+
+#define N_COLLECTIONS 10
+
+static char stats_path[64];
+
+// Writes the statistics into stats_path instead of stdout
+static void write_stats(void) {
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int fd = open(stats_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  CHECK(saved >= 0 && fd >= 0);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+  print_gc_alloc_stats();
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+// Times the phase of the label ran, or -1 if it is not reported
+static long long phase_times(const char *label) {
+  FILE *stats = fopen(stats_path, "r");
+  CHECK(stats != NULL);
+  long long times = -1;
+  char line[256];
+  while (fgets(line, sizeof(line), stats) != NULL) {
+    char *start = strstr(line, label);
+    char *count = strchr(line, '(');
+    if (start != NULL && count != NULL) {
+      times = atoll(count + 1);
+      break;
+    }
+  }
+  fclose(stats);
+  return times;
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // Configurations of the test run side by side in the same directory
+  snprintf(stats_path, sizeof(stats_path), "perf-%ld.txt", (long)getpid());
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  gc_push_root((void **)&list);
+  for (int i = 0; i < N_COLLECTIONS; i++) {
+    test_churn(GEN0_SPACE_SIZE / 2);
+    gc_collect(0);
+    gc_collect(1);
+    CHECK(test_list_is(list, TEST_LIST_LENGTH, 0));
+  }
+  gc_pop_root((void **)&list);
+  write_stats();
+  // Full-heap collections count as Gen1 ones
+  CHECK(phase_times("Gen0 root forwarding:") >= N_COLLECTIONS);
+  CHECK(phase_times("Gen0 Cheney scan:") >= N_COLLECTIONS);
+  CHECK(phase_times("Gen1 root forwarding:") >= N_COLLECTIONS);
+  CHECK(phase_times("Gen1 flip:") >= N_COLLECTIONS);
+  // Every phase which began has ended
+  CHECK(phase_times("Gen0 flip:") == phase_times("Gen0 root forwarding:"));
+  unlink(stats_path);
+  return 0;
+}
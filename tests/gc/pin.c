@@ -0,0 +1,93 @@
+#include "test.h"
+
+// gc_pin and gc_unpin: pinned objects stay where they are and keep what they
+// point to alive without a root, and pins nest
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// A pinned list is a root by itself
+static void test_pin_keeps_alive(void) {
+  stella_object *pinned = test_list(TEST_LIST_LENGTH, 0);
+  gc_pin(pinned);
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+    CHECK(test_list_is(pinned, TEST_LIST_LENGTH, 0));
+  }
+  gc_unpin(pinned);
+}
+
+// Pins nest: the object moves only once the last pin is released
+static void test_nested_pins(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 1);
+  gc_push_root((void **)&list);
+  stella_object *pinned = list;
+  gc_pin(pinned);
+  gc_pin(pinned);
+  collect_all();
+  CHECK(list == pinned);
+  gc_unpin(pinned);
+  collect_all();
+  CHECK(list == pinned);
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 1));
+  gc_unpin(pinned);
+  collect_all();
+  CHECK(test_list_is(list, TEST_LIST_LENGTH, 1));
+  gc_pop_root((void **)&list);
+}
+
+// An object unpinned right after the collection which kept it in place lies
+// past the Gen0 allocation pointer, and is promoted with its fields
+static void test_unpin_after_collection(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 2);
+  gc_push_root((void **)&list);
+  for (int i = 0; i < 3; i++) {
+    stella_object *pinned = list;
+    gc_pin(pinned);
+    gc_collect(0);
+    CHECK(list == pinned);
+    gc_unpin(pinned);
+    gc_collect(1);
+    CHECK(test_list_is(list, TEST_LIST_LENGTH, 2));
+    collect_all();
+    CHECK(test_list_is(list, TEST_LIST_LENGTH, 2));
+  }
+  gc_pop_root((void **)&list);
+}
+
+// Objects allocated around pinned ones survive collections as well
+static void test_allocation_around_pins(void) {
+  stella_object *lists[3] = {NULL, NULL, NULL};
+  for (int k = 0; k < 3; k++) {
+    gc_push_root((void **)&lists[k]);
+  }
+  stella_object *pinned = nat_to_stella_object(1);
+  gc_pin(pinned);
+  for (int round = 0; round < 20; round++) {
+    int k = round % 3;
+    lists[k] = test_list(TEST_LIST_LENGTH, round);
+    test_churn(GEN0_SPACE_SIZE / 2);
+    for (int j = 0; j <= k; j++) {
+      CHECK(test_list_is(lists[j], TEST_LIST_LENGTH, round - k + j));
+    }
+    CHECK(stella_object_to_nat(pinned) == 1);
+  }
+  gc_unpin(pinned);
+  for (int k = 2; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_pin_keeps_alive();
+  test_nested_pins();
+  test_unpin_after_collection();
+  test_allocation_around_pins();
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// STELLA_GC_PROFILING: the profile written when a heap is destroyed is in the
+// heap_v2 format of pprof, its totals add up, and samples of garbage are no
+// longer in use while samples of the live lists still are
+
+#define N_LISTS 3
+// Sampling rate in bytes, so that every list is sampled several times
+#define PROFILE_RATE 16
+
+static char output_path[64];
+
+struct profile_counts {
+  unsigned long long inuse_count;
+  unsigned long long inuse_bytes;
+  unsigned long long alloc_count;
+  unsigned long long alloc_bytes;
+};
+
+static void add_counts(struct profile_counts *total,
+                       const struct profile_counts *counts) {
+  total->inuse_count += counts->inuse_count;
+  total->inuse_bytes += counts->inuse_bytes;
+  total->alloc_count += counts->alloc_count;
+  total->alloc_bytes += counts->alloc_bytes;
+}
+
+static void check_profile(const char *path) {
+  FILE *file = fopen(path, "r");
+  CHECK(file != NULL);
+  char line[4096];
+  struct profile_counts header;
+  unsigned long long rate;
+  CHECK(fgets(line, sizeof(line), file) != NULL);
+  CHECK(sscanf(line, "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu",
+               &header.inuse_count, &header.inuse_bytes, &header.alloc_count,
+               &header.alloc_bytes, &rate) == 5);
+  CHECK(rate == PROFILE_RATE);
+  struct profile_counts total = {0, 0, 0, 0};
+  int n_stacks = 0;
+  int n_dead_stacks = 0;
+  bool has_maps = false;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (strcmp(line, "MAPPED_LIBRARIES:\n") == 0) {
+      has_maps = true;
+      break;
+    }
+    struct profile_counts counts;
+    int n_read;
+    if (sscanf(line, "%llu: %llu [%llu: %llu] @%n", &counts.inuse_count,
+               &counts.inuse_bytes, &counts.alloc_count, &counts.alloc_bytes,
+               &n_read) != 4) {
+      continue;
+    }
+    // Every stack has at least the caller of the allocation
+    CHECK(strstr(line + n_read, " 0x") == line + n_read);
+    CHECK(counts.inuse_count <= counts.alloc_count);
+    add_counts(&total, &counts);
+    n_stacks++;
+    if (counts.inuse_count == 0) {
+      n_dead_stacks++;
+    }
+  }
+  fclose(file);
+  CHECK(has_maps);
+  CHECK(n_stacks > 0);
+  CHECK(total.inuse_count == header.inuse_count &&
+        total.inuse_bytes == header.inuse_bytes &&
+        total.alloc_count == header.alloc_count &&
+        total.alloc_bytes == header.alloc_bytes);
+  CHECK(header.inuse_count > 0);
+  CHECK(header.inuse_count < header.alloc_count);
+  // Garbage is allocated from a call site of its own
+  CHECK(n_dead_stacks > 0);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // Configurations of the test run side by side in the same directory
+  snprintf(output_path, sizeof(output_path), "profile-%ld.heap",
+           (long)getpid());
+  setenv("STELLA_GC_PROFILE_OUTPUT", output_path, 1);
+  char rate[16];
+  snprintf(rate, sizeof(rate), "%d", PROFILE_RATE);
+  setenv("STELLA_GC_PROFILE_RATE", rate, 1);
+  gc_heap *heap = gc_heap_create();
+  CHECK(heap != NULL);
+  gc_heap *previous = gc_heap_select(heap);
+  stella_object *lists[N_LISTS] = {NULL, NULL, NULL};
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+    lists[k] = test_list(TEST_LIST_LENGTH, k);
+  }
+  test_churn(8 * GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+  for (int k = 0; k < N_LISTS; k++) {
+    CHECK(test_list_is(lists[k], TEST_LIST_LENGTH, k));
+  }
+  // The profile is written before the roots are dropped
+  gc_heap_destroy(heap);
+  gc_heap_select(previous);
+
+  // The first heap created writes its profile to the path with .1 appended
+  char profile_path[80];
+  snprintf(profile_path, sizeof(profile_path), "%s.1", output_path);
+  check_profile(profile_path);
+  unlink(profile_path);
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test.h"
+
+// gc_publish and gc_release_published: published copies never move, survive
+// the collections of every heap, and their regions are reused after release
+
+#define N_CYCLES 200
+
+static void collect_all(void) {
+  test_churn(GEN0_SPACE_SIZE);
+  gc_collect(0);
+  gc_collect(1);
+}
+
+// The copy holds the same contents and outlives the original
+static void test_copy(void) {
+  stella_object *list = test_list(TEST_LIST_LENGTH, 0);
+  stella_object *published = gc_publish(list);
+  CHECK(published != NULL);
+  CHECK(published != list);
+  CHECK(test_list_is(published, TEST_LIST_LENGTH, 0));
+  for (int i = 0; i < 3; i++) {
+    collect_all();
+    CHECK(test_list_is(published, TEST_LIST_LENGTH, 0));
+  }
+  gc_release_published(published);
+}
+
+// A heap can point to published objects, which stay where they are
+static void test_shared_by_heaps(void) {
+  stella_object *published = gc_publish(test_list(TEST_LIST_LENGTH, 1));
+  CHECK(published != NULL);
+  gc_heap *other = gc_heap_create();
+  gc_heap *previous = gc_heap_select(other);
+  stella_object *list = test_cons(&the_ZERO, published);
+  gc_push_root((void **)&list);
+  collect_all();
+  CHECK(STELLA_OBJECT_READ_FIELD(list, 1) == published);
+  CHECK(test_list_is(STELLA_OBJECT_READ_FIELD(list, 1), TEST_LIST_LENGTH, 1));
+  gc_pop_root((void **)&list);
+  gc_heap_select(previous);
+  gc_heap_destroy(other);
+  CHECK(test_list_is(published, TEST_LIST_LENGTH, 1));
+  gc_release_published(published);
+}
+
+// Released regions leave room for new ones, however many come and go
+static void test_publish_release_cycles(void) {
+  for (int i = 0; i < N_CYCLES; i++) {
+    stella_object *published = gc_publish(test_list(TEST_LIST_LENGTH, i));
+    CHECK(published != NULL);
+    CHECK(test_list_is(published, TEST_LIST_LENGTH, i));
+    gc_release_published(published);
+  }
+}
+
+// Reference cells could be written, so graphs with them are not published
+static void test_reference_cells_rejected(void) {
+  stella_object *cell = alloc_stella_object(TAG_REF, 1);
+  STELLA_OBJECT_INIT_FIELD(cell, 0, &the_ZERO);
+  stella_object *list = test_cons(cell, &the_EMPTY);
+  CHECK(gc_publish(list) == NULL);
+}
+
+// A write into a published object stops the program, in the write barrier or
+// with a fault on the read-only page, so it is done by a child process
+static void test_writes_stop_the_program(void) {
+  stella_object *published = gc_publish(test_list(TEST_LIST_LENGTH, 0));
+  CHECK(published != NULL);
+  fflush(stdout);
+  pid_t child = fork();
+  CHECK(child >= 0);
+  if (child == 0) {
+    STELLA_OBJECT_WRITE_FIELD(published, 1, &the_EMPTY);
+    _exit(0);
+  }
+  int status;
+  CHECK(waitpid(child, &status, 0) == child);
+  CHECK(!WIFEXITED(status) || WEXITSTATUS(status) != 0);
+  CHECK(test_list_is(published, TEST_LIST_LENGTH, 0));
+  gc_release_published(published);
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  test_copy();
+  test_shared_by_heaps();
+  test_publish_release_cycles();
+  test_reference_cells_rejected();
+  test_writes_stop_the_program();
+  return 0;
+}
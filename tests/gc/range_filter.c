@@ -0,0 +1,80 @@
+#include <stdint.h>
+
+#include "test.h"
+
+#include "gc/range_filter.h"
+
+// range_filter: the vector kernels the CPU supports agree with a plain loop
+// for every window size and alignment, around both bounds of the range and
+// for words anywhere else in the address space
+
+#define N_WINDOWS 2000
+
+static uint64_t expected_mask(void *const *words, int n_words,
+                              const uint8_t *start, size_t size) {
+  uint64_t mask = 0;
+  for (int i = 0; i < n_words; i++) {
+    uintptr_t word = (uintptr_t)words[i];
+    if (word >= (uintptr_t)start && word < (uintptr_t)start + size) {
+      mask |= (uint64_t)1 << i;
+    }
+  }
+  return mask;
+}
+
+static uint64_t random_state = 0x2545f4914f6cdd1dULL;
+
+static uint64_t random_next(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+// Words on and next to the bounds, NULL, and words far below and above,
+// which only an unsigned comparison tells apart
+static void *random_word(const uint8_t *start, size_t size) {
+  uintptr_t base = (uintptr_t)start;
+  switch (random_next() % 8) {
+  case 0:
+    return (void *)(base - 1);
+  case 1:
+    return (void *)base;
+  case 2:
+    return (void *)(base + size - 1);
+  case 3:
+    return (void *)(base + size);
+  case 4:
+    return NULL;
+  case 5:
+    return (void *)(uintptr_t)random_next();
+  default:
+    return (void *)(base + random_next() % size);
+  }
+}
+
+int main(void) {
+  // One more word than a window, so that windows start at every alignment
+  static void *words[RANGE_FILTER_MAX_WORDS + 1];
+  static uint8_t space[4096];
+  for (int window = 0; window < N_WINDOWS; window++) {
+    size_t size = 1 + random_next() % sizeof(space);
+    const uint8_t *start = space + random_next() % (sizeof(space) - size + 1);
+    for (int i = 0; i <= RANGE_FILTER_MAX_WORDS; i++) {
+      words[i] = random_word(start, size);
+    }
+    int offset = window % 2;
+    for (int n_words = 0; n_words <= RANGE_FILTER_MAX_WORDS; n_words++) {
+      CHECK(range_filter(words + offset, n_words, start, size) ==
+            expected_mask(words + offset, n_words, start, size));
+    }
+  }
+  // Ranges that reach the top of the address space
+  const uint8_t *high = (const uint8_t *)(UINTPTR_MAX - 4095);
+  for (int i = 0; i < RANGE_FILTER_MAX_WORDS; i++) {
+    words[i] = random_word(high, 4095);
+  }
+  CHECK(range_filter(words, RANGE_FILTER_MAX_WORDS, high, 4095) ==
+        expected_mask(words, RANGE_FILTER_MAX_WORDS, high, 4095));
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include <stdint.h>
+
+#include "test.h"
+
+#include "gc/gen0.h"
+#include "gc/gen1.h"
+#include "gc/gen2.h"
+#include "gc/utils.h"
+
+// The region of a heap: it is aligned to GC_SLOT_SIZE and holds the
+// semispaces in the first and the third slot, a fixed Gen0 in the second and
+// Gen2 in the last one, so the inline checkers of gc/utils.h answer the same
+// as plain range checks, for objects of the heap, static objects and the
+// addresses at the edges of every slot, before and after the semispaces swap
+
+#define N_LISTS 3
+
+static bool in_range(const void *ptr, const uint8_t *start, size_t size) {
+  return (uintptr_t)ptr >= (uintptr_t)start &&
+         (uintptr_t)ptr < (uintptr_t)start + size;
+}
+
+static void check_address(uint8_t *ptr) {
+  CHECK(points_to_fromspace(ptr) ==
+        in_range(ptr, gen1_fromspace, GC_SLOT_SIZE));
+  CHECK(points_to_tospace(ptr) == in_range(ptr, gen1_tospace, GC_SLOT_SIZE));
+  CHECK(points_to_gen0_space(ptr) ==
+        in_range(ptr, gen0_space, gen0_space_size));
+  CHECK(is_managed_by_gc((stella_object *)ptr) ==
+        in_range(ptr, gen1_region, GC_REGION_SIZE));
+}
+
+static void check_layout(void) {
+  CHECK((uintptr_t)gen1_region % GC_SLOT_SIZE == 0);
+  CHECK(GC_SLOT_SIZE >= GEN1_SPACE_SIZE && GC_SLOT_SIZE / 2 < GEN1_SPACE_SIZE);
+  // The semispaces swap places, but keep their slots
+  CHECK((gen1_fromspace == gen1_region &&
+         gen1_tospace == gen1_region + 2 * GC_SLOT_SIZE) ||
+        (gen1_tospace == gen1_region &&
+         gen1_fromspace == gen1_region + 2 * GC_SLOT_SIZE));
+  if (gen0_gc_initialized) {
+    if (gen0_in_tospace) {
+      CHECK(in_range(gen0_space, gen1_tospace, GC_SLOT_SIZE));
+    } else {
+      CHECK(gen0_space == gen1_region + GC_SLOT_SIZE);
+    }
+  }
+  if (gen2_enabled) {
+    CHECK(gen2_space == gen1_region + 3 * GC_SLOT_SIZE);
+  }
+}
+
+static void check_region(stella_object **lists) {
+  check_layout();
+  for (int slot = 0; slot < 4; slot++) {
+    uint8_t *start = gen1_region + (size_t)slot * GC_SLOT_SIZE;
+    check_address(start);
+    check_address(start + GC_SLOT_SIZE - sizeof(void *));
+  }
+  check_address(gen1_region - sizeof(void *));
+  check_address(gen1_region + GC_REGION_SIZE);
+  if (gen0_gc_initialized) {
+    check_address(gen0_space + gen0_space_size - sizeof(void *));
+    check_address(gen0_space + gen0_space_size);
+  }
+  check_address((uint8_t *)&the_ZERO);
+  CHECK(!is_managed_by_gc(&the_ZERO));
+  for (int k = 0; k < N_LISTS; k++) {
+    int length = 0;
+    for (stella_object *cell = lists[k];
+         STELLA_OBJECT_HEADER_TAG(cell->object_header) == TAG_CONS;
+         cell = STELLA_OBJECT_READ_FIELD(cell, 1)) {
+      check_address((uint8_t *)cell);
+      CHECK(is_managed_by_gc(cell));
+      length++;
+    }
+    CHECK(length == TEST_LIST_LENGTH);
+  }
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  stella_object *lists[N_LISTS] = {NULL, NULL, NULL};
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+    lists[k] = test_list(TEST_LIST_LENGTH, k);
+  }
+  // Young lists, then lists promoted to Gen1 and on into Gen2, through both
+  // placements of the semispaces
+  check_region(lists);
+  for (int round = 0; round < 4; round++) {
+    test_churn(GEN0_SPACE_SIZE);
+    gc_collect(0);
+    check_region(lists);
+    gc_collect(1);
+    check_region(lists);
+  }
+  for (int k = 0; k < N_LISTS; k++) {
+    CHECK(test_list_is(lists[k], TEST_LIST_LENGTH, k));
+  }
+  for (int k = N_LISTS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#include "gc/export.h"
+
+// Collection scheduling: a Gen0 collection whose survivors may not fit into
+// Gen1 is replaced by a full-heap collection beforehand, so that no Gen1
+// collection has to be nested in a Gen0 collection. The counters are read
+// from the page of STELLA_GC_EXPORT_PAGE.
+
+#define N_LISTS 3
+#define N_ROUNDS 500
+
+static char page_path[64];
+
+static void read_stats(struct gc_stats_snapshot *stats) {
+  int fd = open(page_path, O_RDONLY);
+  CHECK(fd >= 0);
+  const struct gc_export_page *page =
+      mmap(NULL, sizeof(struct gc_export_page), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(page != MAP_FAILED);
+  uint64_t sequence;
+  do {
+    sequence = atomic_load(&page->sequence);
+    *stats = page->stats;
+  } while (sequence % 2 != 0 || atomic_load(&page->sequence) != sequence);
+  munmap((void *)page, sizeof(struct gc_export_page));
+}
+
+// Under steady pressure lists survive a few collections while garbage comes
+// and goes, and the promotion of every Gen0 collection is well predicted
+static void test_steady_pressure(void) {
+  stella_object *lists[N_LISTS] = {NULL, NULL, NULL};
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+  }
+  struct gc_stats_snapshot before;
+  read_stats(&before);
+  for (int round = 0; round < N_ROUNDS; round++) {
+    lists[round % N_LISTS] = test_list(TEST_LIST_LENGTH, round);
+    test_churn(GEN0_SPACE_SIZE / 2);
+    for (int j = 0; j < N_LISTS && j <= round; j++) {
+      int seed = round - (round - j) % N_LISTS;
+      CHECK(test_list_is(lists[j], TEST_LIST_LENGTH, seed));
+    }
+  }
+  struct gc_stats_snapshot after;
+  read_stats(&after);
+  CHECK(after.gen0_collects > before.gen0_collects);
+  CHECK(after.gen1_collects + after.full_collects >
+        before.gen1_collects + before.full_collects);
+  CHECK(after.nested_collects == before.nested_collects);
+  for (int k = N_LISTS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+}
+
+// When the survivors of Gen0 collections vary, promotion may exceed the
+// prediction and Gen1 be collected in the middle of a Gen0 collection. The
+// survivors stay intact either way.
+static void test_varying_pressure(void) {
+  stella_object *lists[N_LISTS] = {NULL, NULL, NULL};
+  int seeds[N_LISTS] = {0, 0, 0};
+  for (int k = 0; k < N_LISTS; k++) {
+    gc_push_root((void **)&lists[k]);
+  }
+  for (int round = 0; round < N_ROUNDS; round++) {
+    lists[round % N_LISTS] =
+        test_list(round % 7 == 0 ? 1 : TEST_LIST_LENGTH, round);
+    seeds[round % N_LISTS] = round;
+    test_churn((size_t)(round % 5) * GEN0_SPACE_SIZE / 4);
+    for (int k = 0; k < N_LISTS && k <= round; k++) {
+      int length = seeds[k] % 7 == 0 ? 1 : TEST_LIST_LENGTH;
+      CHECK(test_list_is(lists[k], length, seeds[k]));
+    }
+  }
+  for (int k = N_LISTS - 1; k >= 0; k--) {
+    gc_pop_root((void **)&lists[k]);
+  }
+}
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  // Configurations of the test run side by side in the same directory
+  snprintf(page_path, sizeof(page_path), "scheduler-%ld.page",
+           (long)getpid());
+  setenv("STELLA_GC_EXPORT_PAGE", page_path, 1);
+  test_steady_pressure();
+  test_varying_pressure();
+  unlink(page_path);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gc.h>
+#include <runtime.h>
+
+#include "gc/parameters.h"
+
+// Behavior tests of the collector. They run against the configuration of the
+// build (MAX_ALLOC_SIZE, barriers, compressed references) and the collector
+// and policies selected by the environment of the test (see CMakeLists.txt),
+// and check the contents of the objects they build after collections.
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+// Exit code of a test which does not apply to this build (SKIP_RETURN_CODE)
+#define TEST_SKIPPED 77
+
+#define TEST_CELL_SIZE (STELLA_OBJECT_SIZE(2) + STELLA_OBJECT_SIZE(1))
+
+// Lists of the tests take about a quarter of Gen0, and at least two cells
+#define TEST_MAX_LIST_LENGTH 1000
+#define TEST_LIST_LENGTH                                                       \
+  (GEN0_SPACE_SIZE / 4 / TEST_CELL_SIZE < 2                                    \
+       ? 2                                                                     \
+       : GEN0_SPACE_SIZE / 4 / TEST_CELL_SIZE < TEST_MAX_LIST_LENGTH           \
+             ? (int)(GEN0_SPACE_SIZE / 4 / TEST_CELL_SIZE)                     \
+             : TEST_MAX_LIST_LENGTH)
+
+// The tests keep up to four lists alive at a time, in Gen1 (and in Gen2, which
+// is as large). Builds with a smaller heap (MAX_ALLOC_SIZE below about 512
+// bytes) skip them.
+#define TEST_HEAP_TOO_SMALL                                                    \
+  (4 * TEST_LIST_LENGTH * TEST_CELL_SIZE > GEN1_SPACE_SIZE)
+
+static inline stella_object *test_cons(stella_object *head,
+                                       stella_object *tail) {
+  gc_push_root((void **)&head);
+  gc_push_root((void **)&tail);
+  stella_object *cell = alloc_stella_object(TAG_CONS, 2);
+  STELLA_OBJECT_INIT_FIELD(cell, 0, head);
+  STELLA_OBJECT_INIT_FIELD(cell, 1, tail);
+  gc_pop_root((void **)&tail);
+  gc_pop_root((void **)&head);
+  return cell;
+}
+
+// [seed % 2, (seed + 1) % 2, ...] of the given length: the elements are zero
+// or a fresh succ(0), so that the lists hold objects of two sizes
+static inline stella_object *test_list(int length, int seed) {
+  stella_object *list = &the_EMPTY;
+  stella_object *head = NULL;
+  gc_push_root((void **)&list);
+  gc_push_root((void **)&head);
+  for (int i = length - 1; i >= 0; i--) {
+    head = nat_to_stella_object((seed + i) % 2);
+    list = test_cons(head, list);
+  }
+  gc_pop_root((void **)&head);
+  gc_pop_root((void **)&list);
+  return list;
+}
+
+static inline bool test_list_is(stella_object *list, int length, int seed) {
+  for (int i = 0; i < length; i++) {
+    if (STELLA_OBJECT_HEADER_TAG(list->object_header) != TAG_CONS ||
+        stella_object_to_nat(STELLA_OBJECT_READ_FIELD(list, 0)) !=
+            (seed + i) % 2) {
+      return false;
+    }
+    list = STELLA_OBJECT_READ_FIELD(list, 1);
+  }
+  return STELLA_OBJECT_HEADER_TAG(list->object_header) == TAG_EMPTY;
+}
+
+// Allocates about bytes of garbage, which makes collections run
+static inline void test_churn(size_t bytes) {
+  for (size_t i = 0; i < bytes / STELLA_OBJECT_SIZE(1); i++) {
+    stella_object *cell = alloc_stella_object(TAG_SUCC, 1);
+    STELLA_OBJECT_INIT_FIELD(cell, 0, &the_ZERO);
+  }
+}
+
+#endif // TEST_H
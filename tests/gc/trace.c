@@ -0,0 +1,44 @@
+#include "test.h"
+
+// STELLA_GC_TRACE_OUTPUT: recording a trace leaves the program as it was, and
+// the trace it writes is replayed by stella_gc_replay (see CMakeLists.txt)
+
+#define N_ROUNDS 20
+// Numbers are blocks of succ cells allocated at once
+#define TEST_NAT (int)(GEN0_SPACE_SIZE / 4 / STELLA_OBJECT_SIZE(1))
+
+int main(void) {
+  if (TEST_HEAP_TOO_SMALL) {
+    return TEST_SKIPPED;
+  }
+  if (getenv("STELLA_GC_TRACE_OUTPUT") == NULL) {
+    return TEST_SKIPPED;
+  }
+  stella_object *cell = alloc_stella_object(TAG_REF, 1);
+  STELLA_OBJECT_INIT_FIELD(cell, 0, &the_EMPTY);
+  gc_push_root((void **)&cell);
+  stella_object *pinned = nat_to_stella_object(TEST_NAT);
+  gc_pin(pinned);
+  int seed = 0;
+  for (int round = 0; round < N_ROUNDS; round++) {
+    if (round % 4 == 0) {
+      stella_object *list = test_list(TEST_LIST_LENGTH, round);
+      STELLA_OBJECT_WRITE_FIELD(cell, 0, list);
+      seed = round;
+    }
+    stella_object *number = nat_to_stella_object(TEST_NAT);
+    CHECK(stella_object_to_nat(number) == TEST_NAT);
+    test_churn(GEN0_SPACE_SIZE / 2);
+    if (round % 3 == 0) {
+      gc_collect(round % 2);
+    } else {
+      gc_idle_hint(0);
+    }
+    CHECK(test_list_is(STELLA_OBJECT_READ_FIELD(cell, 0), TEST_LIST_LENGTH,
+                       seed));
+    CHECK(stella_object_to_nat(pinned) == TEST_NAT);
+  }
+  gc_unpin(pinned);
+  gc_pop_root((void **)&cell);
+  return 0;
+}
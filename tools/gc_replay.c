@@ -0,0 +1,409 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gc.h>
+#include <runtime.h>
+
+#include "gc/heap.h"
+#include "gc/kernels.h"
+#include "gc/trace.h"
+
+// Replays an allocation trace recorded with STELLA_GC_TRACE_OUTPUT against
+// this build of the collector: its MAX_ALLOC_SIZE and barriers, and the
+// collector and policies selected by the environment (STELLA_GC,
+// STELLA_GC_PAUSE_TARGET_US, STELLA_GC_DEDUP, ...). The same trace always
+// makes the same requests, so configurations can be compared offline.
+//
+// Usage: stella_gc_replay <trace>
+
+#define PAUSES_INITIAL_CAPACITY 1024
+
+struct trace_reader {
+  uint8_t *data;
+  size_t size;
+  size_t position;
+};
+
+struct replay {
+  // Local roots of the program, registered with gc_push_root
+  stella_object **roots;
+  size_t n_roots;
+  // Ids of the next new object and of the next object to initialize
+  uint64_t next_new_id;
+  uint64_t next_init_id;
+  uint64_t n_events;
+  // Durations of the calls which collected
+  uint64_t *pauses;
+  size_t n_pauses;
+  size_t pauses_capacity;
+};
+
+static uint64_t clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void *replay_realloc(void *array, size_t size) {
+  void *result = realloc(array, size);
+  if (result == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  return result;
+}
+
+static void read_trace(struct trace_reader *reader, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open trace %s\n", path);
+    exit(1);
+  }
+  size_t capacity = 1 << 20;
+  reader->data = replay_realloc(NULL, capacity);
+  reader->size = 0;
+  reader->position = 0;
+  size_t n;
+  while ((n = fread(reader->data + reader->size, 1, capacity - reader->size,
+                    file)) > 0) {
+    reader->size += n;
+    if (reader->size == capacity) {
+      capacity *= 2;
+      reader->data = replay_realloc(reader->data, capacity);
+    }
+  }
+  fclose(file);
+  struct trace_header header;
+  if (reader->size < sizeof(header)) {
+    fprintf(stderr, "%s is not an allocation trace\n", path);
+    exit(1);
+  }
+  memcpy(&header, reader->data, sizeof(header));
+  if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+    fprintf(stderr, "%s is not an allocation trace of version %u\n", path,
+            TRACE_VERSION);
+    exit(1);
+  }
+  if (header.ref_size != sizeof(gc_ref)) {
+    fprintf(stderr,
+            "%s was recorded with %u-byte references, this build has %zu\n",
+            path, header.ref_size, sizeof(gc_ref));
+    exit(1);
+  }
+  reader->position = sizeof(header);
+}
+
+static uint64_t read_u64(struct trace_reader *reader) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (reader->position < reader->size) {
+    uint8_t byte = reader->data[reader->position++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+    shift += 7;
+  }
+  fprintf(stderr, "Truncated allocation trace\n");
+  exit(1);
+}
+
+static int header_fields_count(uint64_t header) {
+  return STELLA_OBJECT_HEADER_FIELD_COUNT((int)header);
+}
+
+// Deepest stack of local roots, found by a first pass over the events, so
+// that registered roots never move
+static size_t max_roots_depth(struct trace_reader *reader) {
+  size_t start = reader->position;
+  size_t depth = 0;
+  size_t max_depth = 0;
+  while (reader->position < reader->size) {
+    switch (reader->data[reader->position++]) {
+    case TRACE_ALLOC:
+    case TRACE_COLLECT:
+    case TRACE_IDLE_HINT:
+    case TRACE_PIN:
+    case TRACE_UNPIN:
+      read_u64(reader);
+      break;
+    case TRACE_SET_ROOT:
+      read_u64(reader);
+      read_u64(reader);
+      break;
+    case TRACE_INIT: {
+      int n_fields = header_fields_count(read_u64(reader));
+      for (int i = 0; i < n_fields; i++) {
+        read_u64(reader);
+      }
+      break;
+    }
+    case TRACE_ALLOC_MANY:
+    case TRACE_WRITE:
+      read_u64(reader);
+      read_u64(reader);
+      read_u64(reader);
+      break;
+    case TRACE_PUSH_ROOT:
+      read_u64(reader);
+      if (++depth > max_depth) {
+        max_depth = depth;
+      }
+      break;
+    case TRACE_POP_ROOT:
+      depth--;
+      break;
+    default:
+      fprintf(stderr, "Unknown event %u in allocation trace\n",
+              reader->data[reader->position - 1]);
+      exit(1);
+    }
+  }
+  reader->position = start;
+  return max_depth;
+}
+
+static uint64_t n_collections(void) {
+  return gc_current_heap->stats.gen0_n_collects +
+         gc_current_heap->stats.gen1_n_collects +
+         gc_current_heap->stats.full_n_collects;
+}
+
+static void record_pause(struct replay *replay, uint64_t start_ns,
+                         uint64_t collections_before) {
+  uint64_t end_ns = clock_ns();
+  if (n_collections() == collections_before) {
+    return;
+  }
+  if (replay->n_pauses == replay->pauses_capacity) {
+    replay->pauses_capacity = replay->pauses_capacity == 0
+                                  ? PAUSES_INITIAL_CAPACITY
+                                  : 2 * replay->pauses_capacity;
+    replay->pauses = replay_realloc(
+        replay->pauses, replay->pauses_capacity * sizeof(uint64_t));
+  }
+  replay->pauses[replay->n_pauses++] = end_ns - start_ns;
+}
+
+// New objects get NULL fields filling their size until their contents are
+// replayed, so that the heap stays walkable
+static void init_placeholder(stella_object *obj, size_t size_in_bytes) {
+  int n_fields = (int)((size_in_bytes - sizeof(int)) / sizeof(gc_ref));
+  if (n_fields > GC_MAX_FIELDS_COUNT) {
+    n_fields = GC_MAX_FIELDS_COUNT;
+  }
+  STELLA_OBJECT_INIT_TAG(obj, TAG_TUPLE);
+  STELLA_OBJECT_INIT_FIELDS_COUNT(obj, n_fields);
+  for (int i = 0; i < n_fields; i++) {
+    STELLA_OBJECT_INIT_FIELD(obj, i, NULL);
+  }
+}
+
+static void replay_alloc(struct replay *replay, size_t size_in_bytes) {
+  uint64_t collections_before = n_collections();
+  uint64_t start_ns = clock_ns();
+  stella_object *obj = gc_alloc(size_in_bytes);
+  record_pause(replay, start_ns, collections_before);
+  init_placeholder(obj, size_in_bytes);
+  replay->next_init_id = replay->next_new_id++;
+}
+
+// The block is requested as by the program, and it gets as many objects as
+// in the trace. Objects of a block which did not fit at once are kept as roots
+// until the rest of the block is allocated, because their contents come later.
+// Objects beyond those of the trace, if the replayed configuration has more
+// room, are left as garbage.
+static void replay_alloc_many(struct replay *replay, size_t object_size,
+                              size_t requested_count, size_t count) {
+  replay->next_init_id = replay->next_new_id;
+  stella_object **allocated = NULL;
+  size_t n_allocated = 0;
+  size_t n_requested = requested_count;
+  while (n_allocated < count) {
+    void *block;
+    uint64_t collections_before = n_collections();
+    uint64_t start_ns = clock_ns();
+    size_t n_objects = gc_alloc_many(object_size, n_requested, &block);
+    record_pause(replay, start_ns, collections_before);
+    for (size_t i = 0; i < n_objects; i++) {
+      init_placeholder((stella_object *)((uint8_t *)block + i * object_size),
+                       object_size);
+    }
+    if (n_objects > count - n_allocated) {
+      size_t n_extra = n_objects - (count - n_allocated);
+      n_objects -= n_extra;
+      trace_replay_drop_ids((uint8_t *)block + n_objects * object_size,
+                            object_size, n_extra);
+    }
+    n_requested = count - n_allocated - n_objects;
+    replay->next_new_id += n_objects;
+    if (n_allocated == 0 && n_objects == count) {
+      return;
+    }
+    if (allocated == NULL) {
+      allocated = replay_realloc(NULL, count * sizeof(stella_object *));
+    }
+    for (size_t i = 0; i < n_objects; i++) {
+      allocated[n_allocated] =
+          (stella_object *)((uint8_t *)block + i * object_size);
+      gc_push_root((void **)&allocated[n_allocated++]);
+    }
+  }
+  while (n_allocated > 0) {
+    gc_pop_root((void **)&allocated[--n_allocated]);
+  }
+  free(allocated);
+}
+
+static void replay_init(struct replay *replay, struct trace_reader *reader) {
+  stella_object *obj = trace_replay_object(replay->next_init_id++);
+  uint64_t header = read_u64(reader);
+  int n_fields = header_fields_count(header);
+  STELLA_OBJECT_INIT_TAG(obj, STELLA_OBJECT_HEADER_TAG((int)header));
+  STELLA_OBJECT_INIT_FIELDS_COUNT(obj, n_fields);
+  for (int i = 0; i < n_fields; i++) {
+    STELLA_OBJECT_INIT_FIELD(obj, i, trace_replay_object(read_u64(reader)));
+  }
+}
+
+static void replay_event(struct replay *replay, struct trace_reader *reader) {
+  uint8_t event = reader->data[reader->position++];
+  replay->n_events++;
+  switch (event) {
+  case TRACE_ALLOC:
+    replay_alloc(replay, read_u64(reader));
+    break;
+  case TRACE_ALLOC_MANY: {
+    size_t object_size = read_u64(reader);
+    size_t requested_count = read_u64(reader);
+    replay_alloc_many(replay, object_size, requested_count, read_u64(reader));
+    break;
+  }
+  case TRACE_INIT:
+    replay_init(replay, reader);
+    break;
+  case TRACE_WRITE: {
+    stella_object *obj = trace_replay_object(read_u64(reader));
+    int field_index = (int)read_u64(reader);
+    stella_object *value = trace_replay_object(read_u64(reader));
+    STELLA_OBJECT_WRITE_FIELD(obj, field_index, value);
+    break;
+  }
+  case TRACE_PUSH_ROOT:
+    replay->roots[replay->n_roots] = trace_replay_object(read_u64(reader));
+    gc_push_root((void **)&replay->roots[replay->n_roots++]);
+    break;
+  case TRACE_POP_ROOT:
+    gc_pop_root((void **)&replay->roots[--replay->n_roots]);
+    break;
+  case TRACE_SET_ROOT: {
+    size_t index = read_u64(reader);
+    replay->roots[index] = trace_replay_object(read_u64(reader));
+    break;
+  }
+  case TRACE_COLLECT: {
+    int generation = (int)read_u64(reader);
+    uint64_t collections_before = n_collections();
+    uint64_t start_ns = clock_ns();
+    gc_collect(generation);
+    record_pause(replay, start_ns, collections_before);
+    break;
+  }
+  case TRACE_IDLE_HINT: {
+    uint64_t budget_us = read_u64(reader);
+    uint64_t collections_before = n_collections();
+    uint64_t start_ns = clock_ns();
+    gc_idle_hint(budget_us);
+    record_pause(replay, start_ns, collections_before);
+    break;
+  }
+  case TRACE_PIN:
+    gc_pin(trace_replay_object(read_u64(reader)));
+    break;
+  case TRACE_UNPIN:
+    gc_unpin(trace_replay_object(read_u64(reader)));
+    break;
+  default:
+    fprintf(stderr, "Unknown event %u in allocation trace\n", event);
+    exit(1);
+  }
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const struct replay *replay, double fraction) {
+  if (replay->n_pauses == 0) {
+    return 0;
+  }
+  size_t index = (size_t)(fraction * (double)(replay->n_pauses - 1) + 0.5);
+  return replay->pauses[index];
+}
+
+static void print_report(struct replay *replay, const char *path,
+                         uint64_t elapsed_ns) {
+  qsort(replay->pauses, replay->n_pauses, sizeof(uint64_t), compare_u64);
+  uint64_t total_ns = 0;
+  for (size_t i = 0; i < replay->n_pauses; i++) {
+    total_ns += replay->pauses[i];
+  }
+  printf("Replayed trace:                  %s\n", path);
+  printf("    Events:                      %llu\n",
+         (unsigned long long)replay->n_events);
+  printf("    Objects:                     %llu\n",
+         (unsigned long long)(replay->next_new_id - TRACE_FIRST_ID));
+  printf("    Time:                        %llu ns\n",
+         (unsigned long long)elapsed_ns);
+  printf("Pauses:                          %zu\n", replay->n_pauses);
+  printf("    Total:                       %llu ns\n",
+         (unsigned long long)total_ns);
+  printf("    Median:                      %llu ns\n",
+         (unsigned long long)percentile(replay, 0.5));
+  printf("    99th percentile:             %llu ns\n",
+         (unsigned long long)percentile(replay, 0.99));
+  printf("    Maximum:                     %llu ns\n",
+         (unsigned long long)percentile(replay, 1.0));
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <trace>\n", argv[0]);
+    return 1;
+  }
+  struct trace_reader reader;
+  read_trace(&reader, argv[1]);
+  struct replay replay = {.roots = NULL,
+                          .n_roots = 0,
+                          .next_new_id = TRACE_FIRST_ID,
+                          .next_init_id = TRACE_FIRST_ID,
+                          .n_events = 0,
+                          .pauses = NULL,
+                          .n_pauses = 0,
+                          .pauses_capacity = 0};
+  size_t max_depth = max_roots_depth(&reader);
+  replay.roots = replay_realloc(
+      NULL, (max_depth > 0 ? max_depth : 1) * sizeof(stella_object *));
+
+  trace_replay_start();
+  uint64_t start_ns = clock_ns();
+  while (reader.position < reader.size) {
+    replay_event(&replay, &reader);
+  }
+  uint64_t elapsed_ns = clock_ns() - start_ns;
+
+  print_report(&replay, argv[1], elapsed_ns);
+  print_gc_alloc_stats();
+  while (replay.n_roots > 0) {
+    gc_pop_root((void **)&replay.roots[--replay.n_roots]);
+  }
+  free(replay.roots);
+  free(replay.pauses);
+  free(reader.data);
+  return 0;
+}